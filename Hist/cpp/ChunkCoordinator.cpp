@@ -0,0 +1,218 @@
+#include "ChunkCoordinator.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+ChunkCoordinator::ChunkCoordinator(std::string socketPath, std::string sampKey, int nChunks, int maxAttempts)
+    : socketPath_(std::move(socketPath)),
+      sampKey_(std::move(sampKey)),
+      nChunks_(nChunks),
+      maxAttempts_(maxAttempts),
+      states_(nChunks > 0 ? nChunks : 0, State::Pending),
+      attempts_(nChunks > 0 ? nChunks : 0, 0) {
+    if (nChunks_ < 1) {
+        throw std::runtime_error("ChunkCoordinator: the number of chunks must be positive");
+    }
+    for (int n = 1; n <= nChunks_; ++n) {
+        pending_.push_back(n);
+    }
+
+    sockaddr_un addr{};
+    if (socketPath_.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("ChunkCoordinator: socket path too long: " + socketPath_);
+    }
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        throw std::runtime_error(std::string("ChunkCoordinator: socket: ") + std::strerror(errno));
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath_.c_str(), sizeof(addr.sun_path) - 1);
+    ::unlink(socketPath_.c_str()); // left over by a previous coordinator
+    if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listenFd_, 64) != 0) {
+        const std::string error = std::strerror(errno);
+        ::close(listenFd_);
+        throw std::runtime_error("ChunkCoordinator: cannot listen on " + socketPath_ + ": " + error);
+    }
+    std::cout << "+ ChunkCoordinator: " << nChunks_ << " chunks of " << sampKey_
+              << ", listening on " << socketPath_ << '\n';
+}
+
+ChunkCoordinator::~ChunkCoordinator() {
+    for (const auto& [fd, client] : clients_) {
+        ::close(fd);
+    }
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        ::unlink(socketPath_.c_str());
+    }
+}
+
+auto ChunkCoordinator::sendLine(int fd, const std::string& line) -> bool {
+    const std::string message = line + "\n";
+    std::size_t sent = 0;
+    while (sent < message.size()) {
+        // MSG_NOSIGNAL: a closed peer is an error, not a SIGPIPE
+        const ssize_t n = ::send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+auto ChunkCoordinator::readLine(int fd, std::string& buffer, std::string& line) -> bool {
+    while (true) {
+        const auto pos = buffer.find('\n');
+        if (pos != std::string::npos) {
+            line = buffer.substr(0, pos);
+            buffer.erase(0, pos + 1);
+            return true;
+        }
+        char chunk[256];
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buffer.append(chunk, static_cast<std::size_t>(n));
+    }
+}
+
+auto ChunkCoordinator::run() -> int {
+    while (nDone_ + nGivenUp_ < nChunks_) {
+        std::vector<pollfd> fds;
+        fds.push_back({listenFd_, POLLIN, 0});
+        for (const auto& [fd, client] : clients_) {
+            fds.push_back({fd, POLLIN, 0});
+        }
+        // Wake up at least once per heartbeat to notice silent workers
+        if (::poll(fds.data(), fds.size(), heartbeatSeconds * 1000) < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("ChunkCoordinator: poll: ") + std::strerror(errno));
+        }
+
+        if (fds[0].revents & POLLIN) {
+            const int fd = ::accept(listenFd_, nullptr, nullptr);
+            if (fd >= 0) clients_[fd] = Client{};
+        }
+        for (std::size_t i = 1; i < fds.size(); ++i) {
+            if (!fds[i].revents) continue;
+            const int fd = fds[i].fd;
+            char data[256];
+            const ssize_t n = ::recv(fd, data, sizeof(data), 0);
+            if (n <= 0) {
+                disconnect(fd);
+                continue;
+            }
+            Client& client = clients_.at(fd);
+            client.lastSeen = std::chrono::steady_clock::now();
+            client.buffer.append(data, static_cast<std::size_t>(n));
+            for (auto pos = client.buffer.find('\n'); pos != std::string::npos; pos = client.buffer.find('\n')) {
+                const std::string request = client.buffer.substr(0, pos);
+                client.buffer.erase(0, pos + 1);
+                if (!sendLine(fd, handle(fd, request))) {
+                    disconnect(fd);
+                    break;
+                }
+            }
+        }
+        dropSilentWorkers();
+    }
+
+    std::cout << "Chunks: " << nDone_ << " done, " << nGivenUp_ << " given up out of " << nChunks_ << '\n';
+    for (int n = 1; n <= nChunks_; ++n) {
+        if (states_[n - 1] == State::GivenUp) {
+            std::cerr << "Error: chunk " << n << "of" << nChunks_ << " failed " << attempts_[n - 1] << " times" << '\n';
+        }
+    }
+    return nGivenUp_;
+}
+
+auto ChunkCoordinator::handle(int fd, const std::string& request) -> std::string {
+    Client& client = clients_.at(fd);
+    std::istringstream iss(request);
+    std::string command;
+    iss >> command;
+
+    if (command == "HELLO") {
+        return "SAMPLE " + sampKey_ + " " + std::to_string(nChunks_);
+    }
+    if (command == "NEXT") {
+        if (!pending_.empty()) {
+            const int chunk = pending_.front();
+            pending_.pop_front();
+            states_[chunk - 1] = State::Running;
+            attempts_[chunk - 1]++;
+            client.chunk = chunk;
+            std::cout << "[ChunkCoordinator] Chunk " << chunk << "of" << nChunks_ << " to worker " << fd << '\n';
+            return "CHUNK " + std::to_string(chunk);
+        }
+        return (nDone_ + nGivenUp_ == nChunks_) ? "DONE" : "WAIT";
+    }
+    if (command == "ALIVE") {
+        return "OK"; // lastSeen is updated for any message
+    }
+    if (command == "FINISHED" || command == "FAILED") {
+        int chunk = -1;
+        iss >> chunk;
+        if (chunk != client.chunk || chunk < 1) {
+            return "ERROR not your chunk";
+        }
+        client.chunk = -1;
+        if (command == "FINISHED") {
+            states_[chunk - 1] = State::Done;
+            nDone_++;
+            std::cout << "[ChunkCoordinator] Chunk " << chunk << "of" << nChunks_ << " done ("
+                      << nDone_ << "/" << nChunks_ << ")" << '\n';
+        } else {
+            retry(chunk, "failed");
+        }
+        return "OK";
+    }
+    return "ERROR unknown request";
+}
+
+void ChunkCoordinator::retry(int chunk, const std::string& reason) {
+    if (attempts_[chunk - 1] < maxAttempts_) {
+        states_[chunk - 1] = State::Pending;
+        pending_.push_front(chunk);
+        std::cerr << "Warning: chunk " << chunk << "of" << nChunks_ << " " << reason << ", queued again" << '\n';
+    } else {
+        states_[chunk - 1] = State::GivenUp;
+        nGivenUp_++;
+        std::cerr << "Error: chunk " << chunk << "of" << nChunks_ << " " << reason << ", giving up" << '\n';
+    }
+}
+
+void ChunkCoordinator::disconnect(int fd) {
+    auto it = clients_.find(fd);
+    if (it == clients_.end()) return;
+    if (it->second.chunk > 0) {
+        retry(it->second.chunk, "lost with worker " + std::to_string(fd));
+    }
+    ::close(fd);
+    clients_.erase(it);
+}
+
+void ChunkCoordinator::dropSilentWorkers() {
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<int> silent;
+    for (const auto& [fd, client] : clients_) {
+        if (client.chunk > 0 && now - client.lastSeen > std::chrono::seconds(timeoutSeconds)) {
+            silent.push_back(fd);
+        }
+    }
+    for (const int fd : silent) {
+        // Closing the connection makes a late FINISHED of this worker fail
+        std::cerr << "Warning: worker " << fd << " silent for " << timeoutSeconds << " s" << '\n';
+        disconnect(fd);
+    }
+}
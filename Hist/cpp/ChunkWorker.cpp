@@ -0,0 +1,102 @@
+#include "ChunkWorker.h"
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ChunkCoordinator.h"
+#include "SliceDriver.h"
+
+ChunkWorker::ChunkWorker(const std::string& socketPath) : socketPath_(socketPath) {
+    sockaddr_un addr{};
+    if (socketPath_.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("ChunkWorker: socket path too long: " + socketPath_);
+    }
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+        throw std::runtime_error(std::string("ChunkWorker: socket: ") + std::strerror(errno));
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath_.c_str(), sizeof(addr.sun_path) - 1);
+    if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        const std::string error = std::strerror(errno);
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("ChunkWorker: cannot connect to " + socketPath_ + ": " + error);
+    }
+
+    std::istringstream reply(request("HELLO"));
+    std::string word;
+    reply >> word >> sampKey_ >> nChunks_;
+    if (word != "SAMPLE" || sampKey_.empty() || nChunks_ < 1) {
+        throw std::runtime_error("ChunkWorker: unexpected reply from " + socketPath_);
+    }
+    std::cout << "+ ChunkWorker: " << sampKey_ << " in " << nChunks_ << " chunks from " << socketPath_ << '\n';
+}
+
+ChunkWorker::~ChunkWorker() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+auto ChunkWorker::request(const std::string& line) -> std::string {
+    std::string reply;
+    if (!ChunkCoordinator::sendLine(fd_, line) || !ChunkCoordinator::readLine(fd_, buffer_, reply)) {
+        return "";
+    }
+    return reply;
+}
+
+auto ChunkWorker::run(const SliceDriver& driver, const std::string& outDir) -> int {
+    int nProcessed = 0;
+    while (true) {
+        const std::string reply = request("NEXT");
+        if (reply.empty() || reply == "DONE") break;
+        if (reply == "WAIT") {
+            // The last chunks are running elsewhere, and may come back if a worker dies
+            std::this_thread::sleep_for(std::chrono::seconds(2));
+            continue;
+        }
+        std::istringstream iss(reply);
+        std::string word;
+        int chunk = -1;
+        iss >> word >> chunk;
+        if (word != "CHUNK" || chunk < 1 || chunk > nChunks_) {
+            std::cerr << "Error: unexpected reply '" << reply << "' from " << socketPath_ << '\n';
+            break;
+        }
+        // Heartbeat while the chunk runs, so that the coordinator can tell a slow
+        // worker from a stopped one
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool isFinished = false;
+        std::thread heartbeat([&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            const auto interval = std::chrono::seconds(ChunkCoordinator::heartbeatSeconds);
+            while (!finished.wait_for(lock, interval, [&]() { return isFinished; })) {
+                request("ALIVE " + std::to_string(chunk));
+            }
+        });
+        const bool ok = driver.runSlice(chunk, outDir);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isFinished = true;
+        }
+        finished.notify_one();
+        heartbeat.join();
+        driver.saveFileIndex(); // the worker may be killed before the last chunk
+        if (ok) nProcessed++;
+        if (request((ok ? "FINISHED " : "FAILED ") + std::to_string(chunk)).empty()) break;
+    }
+    std::cout << "ChunkWorker: processed " << nProcessed << " chunks" << '\n';
+    return nProcessed;
+}
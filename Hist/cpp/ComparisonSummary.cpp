@@ -0,0 +1,92 @@
+#include "ComparisonSummary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+#include "TDirectory.h"
+#include "TTree.h"
+
+void ComparisonSummary::write(TDirectory* dir) const {
+    dir->cd();
+    auto* tree = new TTree("Summary", "Per-jet V/R and V-R of each baseKey, version and histogram directory");
+    Row row;
+    tree->Branch("view", &row.view);
+    tree->Branch("cell", &row.cell);
+    tree->Branch("baseKey", &row.baseKey);
+    tree->Branch("version", &row.version);
+    tree->Branch("reference", &row.reference);
+    tree->Branch("nJets", &row.nJets, "nJets/D");
+    tree->Branch("meanRatio", &row.meanRatio, "meanRatio/D");
+    tree->Branch("rmsRatio", &row.rmsRatio, "rmsRatio/D");
+    tree->Branch("meanDiff", &row.meanDiff, "meanDiff/D");
+    tree->Branch("rmsDiff", &row.rmsDiff, "rmsDiff/D");
+    tree->Branch("maxDevX", &row.maxDevX, "maxDevX/D");
+    tree->Branch("maxDevRatio", &row.maxDevRatio, "maxDevRatio/D");
+    tree->Branch("stats", &row.stats);
+    for (const auto& r : rows_) {
+        row = r;
+        tree->Fill();
+    }
+    std::cout << "[ComparisonSummary] " << rows_.size() << " rows in the Summary tree" << '\n';
+}
+
+void ComparisonSummary::setSums(Row& row, const double* sums) {
+    auto mean = [](const double* s) { return s[0] > 0 ? s[1] / s[0] : 0.0; };
+    auto rms = [&mean](const double* s) {
+        return s[0] > 0 ? std::sqrt(std::max(0.0, s[2] / s[0] - mean(s) * mean(s))) : 0.0;
+    };
+    row.nJets = sums[3];
+    row.meanRatio = mean(sums);
+    row.rmsRatio = rms(sums);
+    row.meanDiff = mean(sums + 3);
+    row.rmsDiff = rms(sums + 3);
+}
+
+auto ComparisonSummary::read(TTree* tree) -> std::vector<Row> {
+    std::vector<Row> rows;
+    if (!tree->GetBranch("stats")) {
+        std::cerr << "Warning: " << tree->GetName() << " has no stats branch (older output), not merged" << '\n';
+        return rows;
+    }
+    Row row;
+    std::vector<std::string*> addresses = {&row.view, &row.cell, &row.baseKey, &row.version,
+                                           &row.reference, &row.stats};
+    const char* names[] = {"view", "cell", "baseKey", "version", "reference", "stats"};
+    for (std::size_t b = 0; b < addresses.size(); ++b) {
+        tree->SetBranchAddress(names[b], &addresses[b]);
+    }
+    for (Long64_t i = 0; i < tree->GetEntries(); ++i) {
+        tree->GetEntry(i);
+        rows.push_back(row);
+    }
+    tree->ResetBranchAddresses();
+    return rows;
+}
+
+void ComparisonSummary::print() const {
+    // Per metadata group, baseKey and version, the profile bin farthest from V/R = 1 over
+    // all directories; the group is the part of the view before the view name
+    std::map<std::tuple<std::string, std::string, std::string>, const Row*> worst;
+    for (const auto& r : rows_) {
+        if (std::isnan(r.maxDevRatio)) continue;
+        const auto slash = r.view.rfind('/');
+        const std::string group = slash == std::string::npos ? std::string() : r.view.substr(0, slash);
+        auto& w = worst[{group, r.baseKey, r.version}];
+        if (!w || std::abs(r.maxDevRatio - 1.0) > std::abs(w->maxDevRatio - 1.0)) w = &r;
+    }
+    if (worst.empty()) return;
+    std::cout << "\nLargest deviation of <V/R> from 1 per metadata group, baseKey and version:" << '\n';
+    for (const auto& [key, r] : worst) {
+        const std::string& group = std::get<0>(key);
+        const std::string& baseKey = std::get<1>(key);
+        std::cout << "  " << std::left << std::setw(50) << (group.empty() ? baseKey : group + "/" + baseKey)
+                  << std::setw(16)
+                  << (r->version + "/" + r->reference) << std::right
+                  << std::setw(12) << r->maxDevRatio << "  at " << r->maxDevX
+                  << " in " << r->view << "/" << r->cell << '\n';
+    }
+}
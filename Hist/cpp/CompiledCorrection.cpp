@@ -0,0 +1,492 @@
+#include "CompiledCorrection.h"
+#include "Helper.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+CompiledCorrection::CompiledCorrection(const nlohmann::json& correctionJson) {
+    name_ = correctionJson.at("name").get<std::string>();
+    for (const auto& input : correctionJson.at("inputs")) {
+        inputNames_.push_back(input.at("name").get<std::string>());
+        inputTypes_.push_back(input.at("type").get<std::string>());
+    }
+    nlohmann::json genericFormulas = nlohmann::json::array();
+    if (correctionJson.contains("generic_formulas") && !correctionJson.at("generic_formulas").is_null()) {
+        genericFormulas = correctionJson.at("generic_formulas");
+    }
+    root_ = buildNode(correctionJson.at("data"), genericFormulas);
+    computeHashes();
+}
+
+void CompiledCorrection::computeHashes() {
+    std::string structure, values;
+    serialize(structure, values);
+    structureHash_ = Helper::fnv1aHash(structure);
+    contentHash_   = Helper::fnv1aHash(structure + values);
+}
+
+bool CompiledCorrection::sameStructure(const CompiledCorrection& other) const {
+    if (structureHash_ != other.structureHash_) return false;
+    std::string structure, values, otherStructure, otherValues;
+    serialize(structure, values);
+    other.serialize(otherStructure, otherValues);
+    return structure == otherStructure;
+}
+
+bool CompiledCorrection::sameContent(const CompiledCorrection& other) const {
+    if (contentHash_ != other.contentHash_) return false;
+    std::string structure, values, otherStructure, otherValues;
+    serialize(structure, values);
+    other.serialize(otherStructure, otherValues);
+    return structure == otherStructure && values == otherValues;
+}
+
+void CompiledCorrection::serialize(std::string& structure, std::string& values) const {
+    // Nodes are stored in build order, so equal serializations mean equal node indices
+    auto add = [](std::string& out, const auto& x) {
+        out.append(reinterpret_cast<const char*>(&x), sizeof(x));
+    };
+    auto addString = [&add](std::string& out, const std::string& x) {
+        add(out, x.size());
+        out += x;
+    };
+    add(structure, inputNames_.size());
+    for (std::size_t i = 0; i < inputNames_.size(); ++i) {
+        addString(structure, inputNames_[i]);
+        addString(structure, inputTypes_[i]);
+    }
+    add(structure, formulas_.size());
+    for (const FormulaExpr& formula : formulas_) {
+        addString(structure, formula.getExpression());
+    }
+    add(structure, root_);
+    add(structure, nodes_.size());
+    for (const Node& node : nodes_) {
+        add(structure, node.type);
+        add(structure, node.flow);
+        add(structure, node.flowChild);
+        add(structure, node.input);
+        add(structure, node.defaultChild);
+        add(structure, node.formula);
+        add(structure, node.axes.size());
+        for (const Axis& axis : node.axes) {
+            add(structure, axis.input);
+            add(structure, axis.uniform);
+            add(structure, axis.nBins);
+            add(structure, axis.low);
+            add(structure, axis.high);
+            for (double edge : axis.edges) add(structure, edge);
+        }
+        add(structure, node.intKeys.size());
+        for (int key : node.intKeys) add(structure, key);
+        add(structure, node.strKeys.size());
+        for (const std::string& key : node.strKeys) addString(structure, key);
+        add(structure, node.children.size());
+        for (int child : node.children) add(structure, child);
+        add(structure, node.variables.size());
+        for (int variable : node.variables) add(structure, variable);
+        add(structure, node.parameters.size());
+
+        add(values, node.value);
+        for (double parameter : node.parameters) add(values, parameter);
+    }
+}
+
+int CompiledCorrection::inputIndex(const std::string& inputName) const {
+    auto it = std::find(inputNames_.begin(), inputNames_.end(), inputName);
+    if (it == inputNames_.end()) {
+        throw std::runtime_error("CompiledCorrection: unknown input '" + inputName + "' in " + name_);
+    }
+    return static_cast<int>(it - inputNames_.begin());
+}
+
+int CompiledCorrection::formulaIndex(const std::string& expression) {
+    for (std::size_t i = 0; i < formulas_.size(); ++i) {
+        if (formulas_[i].getExpression() == expression) return static_cast<int>(i);
+    }
+    formulas_.emplace_back(expression);
+    return static_cast<int>(formulas_.size()) - 1;
+}
+
+auto CompiledCorrection::buildAxis(const std::string& inputName, const nlohmann::json& edges) const -> Axis {
+    Axis axis;
+    axis.input = inputIndex(inputName);
+    if (edges.is_object()) {
+        axis.uniform = true;
+        axis.nBins = edges.at("n").get<int>();
+        axis.low   = edges.at("low").get<double>();
+        axis.high  = edges.at("high").get<double>();
+    } else {
+        axis.edges = edges.get<std::vector<double>>();
+        axis.nBins = static_cast<int>(axis.edges.size()) - 1;
+    }
+    if (axis.nBins < 1) {
+        throw std::runtime_error("CompiledCorrection: binning without bins in " + name_);
+    }
+    return axis;
+}
+
+int CompiledCorrection::Axis::findBin(double value) const {
+    if (uniform) {
+        if (std::isnan(value) || value >= high) return nBins;
+        if (value < low) return -1;
+        return std::min(nBins - 1, static_cast<int>((value - low) / (high - low) * nBins));
+    }
+    auto it = std::upper_bound(edges.begin(), edges.end(), value);
+    if (it == edges.begin()) return -1;
+    if (it == edges.end()) return nBins;
+    return static_cast<int>(it - edges.begin()) - 1;
+}
+
+void CompiledCorrection::buildFlow(Node& node, const nlohmann::json& flow, const nlohmann::json& genericFormulas) {
+    if (flow.is_string()) {
+        const std::string behavior = flow.get<std::string>();
+        if (behavior == "clamp") node.flow = Flow::Clamp;
+        else if (behavior == "error") node.flow = Flow::Error;
+        else throw std::runtime_error("CompiledCorrection: unknown flow '" + behavior + "' in " + name_);
+    } else {
+        node.flow = Flow::Default;
+        node.flowChild = buildNode(flow, genericFormulas);
+    }
+}
+
+int CompiledCorrection::buildFormula(const std::string& expression, const nlohmann::json& variables,
+                                     const nlohmann::json& parameters) {
+    Node node;
+    node.type = NodeType::Formula;
+    node.formula = formulaIndex(expression);
+    for (const auto& variable : variables) {
+        node.variables.push_back(inputIndex(variable.get<std::string>()));
+    }
+    if (!parameters.is_null()) {
+        node.parameters = parameters.get<std::vector<double>>();
+    }
+    const FormulaExpr& formula = formulas_[node.formula];
+    if (formula.getNVariables() > static_cast<int>(node.variables.size()) ||
+        formula.getNParameters() > static_cast<int>(node.parameters.size())) {
+        throw std::runtime_error("CompiledCorrection: missing variables or parameters for '" + expression + "' in " + name_);
+    }
+    if (node.variables.size() > 4) {
+        throw std::runtime_error("CompiledCorrection: more than 4 formula variables in " + name_);
+    }
+    nodes_.push_back(std::move(node));
+    return static_cast<int>(nodes_.size()) - 1;
+}
+
+int CompiledCorrection::buildNode(const nlohmann::json& content, const nlohmann::json& genericFormulas) {
+    if (content.is_number()) {
+        Node node;
+        node.type = NodeType::Constant;
+        node.value = content.get<double>();
+        nodes_.push_back(std::move(node));
+        return static_cast<int>(nodes_.size()) - 1;
+    }
+
+    const std::string nodeType = content.at("nodetype").get<std::string>();
+    Node node;
+    if (nodeType == "binning") {
+        node.type = NodeType::Binning;
+        node.axes.push_back(buildAxis(content.at("input").get<std::string>(), content.at("edges")));
+        for (const auto& child : content.at("content")) {
+            node.children.push_back(buildNode(child, genericFormulas));
+        }
+        if (static_cast<int>(node.children.size()) != node.axes[0].nBins) {
+            throw std::runtime_error("CompiledCorrection: binning content size mismatch in " + name_);
+        }
+        buildFlow(node, content.at("flow"), genericFormulas);
+    }
+    else if (nodeType == "multibinning") {
+        node.type = NodeType::MultiBinning;
+        const auto& inputs = content.at("inputs");
+        const auto& edges = content.at("edges");
+        std::size_t nContent = 1;
+        for (std::size_t d = 0; d < inputs.size(); ++d) {
+            node.axes.push_back(buildAxis(inputs.at(d).get<std::string>(), edges.at(d)));
+            nContent *= node.axes.back().nBins;
+        }
+        for (const auto& child : content.at("content")) {
+            node.children.push_back(buildNode(child, genericFormulas));
+        }
+        if (node.children.size() != nContent) {
+            throw std::runtime_error("CompiledCorrection: multibinning content size mismatch in " + name_);
+        }
+        buildFlow(node, content.at("flow"), genericFormulas);
+    }
+    else if (nodeType == "category") {
+        node.type = NodeType::Category;
+        node.input = inputIndex(content.at("input").get<std::string>());
+        for (const auto& item : content.at("content")) {
+            const auto& key = item.at("key");
+            if (key.is_string()) node.strKeys.push_back(key.get<std::string>());
+            else node.intKeys.push_back(key.get<int>());
+            node.children.push_back(buildNode(item.at("value"), genericFormulas));
+        }
+        if (content.contains("default") && !content.at("default").is_null()) {
+            node.defaultChild = buildNode(content.at("default"), genericFormulas);
+        }
+    }
+    else if (nodeType == "formula") {
+        return buildFormula(content.at("expression").get<std::string>(), content.at("variables"),
+                            content.contains("parameters") ? content.at("parameters") : nlohmann::json());
+    }
+    else if (nodeType == "formularef") {
+        const auto& generic = genericFormulas.at(content.at("index").get<std::size_t>());
+        return buildFormula(generic.at("expression").get<std::string>(), generic.at("variables"),
+                            content.at("parameters"));
+    }
+    else {
+        throw std::runtime_error("CompiledCorrection: unsupported nodetype '" + nodeType + "' in " + name_);
+    }
+    nodes_.push_back(std::move(node));
+    return static_cast<int>(nodes_.size()) - 1;
+}
+
+double CompiledCorrection::evaluateFormula(const Node& node, const double* inputs) const {
+    double vars[4] = {0.0, 0.0, 0.0, 0.0};
+    for (std::size_t v = 0; v < node.variables.size(); ++v) {
+        vars[v] = inputs[node.variables[v]];
+    }
+    if (!nativeFunctions_.empty()) {
+        return nativeFunctions_[node.formula](vars, node.parameters.data());
+    }
+    return formulas_[node.formula].evaluate(vars, node.parameters.data());
+}
+
+int CompiledCorrection::findLeaf(const double* inputs) const {
+    int current = root_;
+    while (true) {
+        const Node& node = nodes_[current];
+        switch (node.type) {
+            case NodeType::Constant:
+            case NodeType::Formula:
+                return current;
+
+            case NodeType::Binning: {
+                const Axis& axis = node.axes[0];
+                int bin = axis.findBin(inputs[axis.input]);
+                if (bin < 0 || bin >= axis.nBins) {
+                    if (node.flow == Flow::Default) { current = node.flowChild; break; }
+                    if (node.flow == Flow::Error) {
+                        throw std::runtime_error("Index out of range for input '" + inputNames_[axis.input] + "' in " + name_);
+                    }
+                    bin = std::clamp(bin, 0, axis.nBins - 1);
+                }
+                current = node.children[bin];
+                break;
+            }
+
+            case NodeType::MultiBinning: {
+                // Content is flattened in C ordering (last axis fastest)
+                std::size_t index = 0;
+                bool useDefault = false;
+                for (const Axis& axis : node.axes) {
+                    int bin = axis.findBin(inputs[axis.input]);
+                    if (bin < 0 || bin >= axis.nBins) {
+                        if (node.flow == Flow::Default) { useDefault = true; break; }
+                        if (node.flow == Flow::Error) {
+                            throw std::runtime_error("Index out of range for input '" + inputNames_[axis.input] + "' in " + name_);
+                        }
+                        bin = std::clamp(bin, 0, axis.nBins - 1);
+                    }
+                    index = index * axis.nBins + bin;
+                }
+                current = useDefault ? node.flowChild : node.children[index];
+                break;
+            }
+
+            case NodeType::Category: {
+                if (!node.strKeys.empty()) {
+                    throw std::runtime_error("String input '" + inputNames_[node.input] + "' is not bound in " + name_);
+                }
+                const int key = static_cast<int>(inputs[node.input]);
+                auto it = std::find(node.intKeys.begin(), node.intKeys.end(), key);
+                if (it != node.intKeys.end()) {
+                    current = node.children[it - node.intKeys.begin()];
+                } else if (node.defaultChild >= 0) {
+                    current = node.defaultChild;
+                } else {
+                    throw std::runtime_error("Index not found for input '" + inputNames_[node.input] + "' in " + name_);
+                }
+                break;
+            }
+        }
+    }
+}
+
+double CompiledCorrection::evaluateLeaf(int leaf, const double* inputs) const {
+    const Node& node = nodes_[leaf];
+    return node.type == NodeType::Formula ? evaluateFormula(node, inputs) : node.value;
+}
+
+double CompiledCorrection::evaluate(const double* inputs) const {
+    return evaluateLeaf(findLeaf(inputs), inputs);
+}
+
+int CompiledCorrection::reduceNode(int index, const std::function<int(const Node&)>& select,
+                                   CompiledCorrection& out) const {
+    const Node& node = nodes_[index];
+    const int selected = select(node);
+    if (selected >= 0) {
+        return reduceNode(selected, select, out);
+    }
+    Node copy = node;
+    for (int& child : copy.children) {
+        child = reduceNode(child, select, out);
+    }
+    if (copy.flowChild >= 0)    copy.flowChild    = reduceNode(copy.flowChild, select, out);
+    if (copy.defaultChild >= 0) copy.defaultChild = reduceNode(copy.defaultChild, select, out);
+    out.nodes_.push_back(std::move(copy));
+    return static_cast<int>(out.nodes_.size()) - 1;
+}
+
+auto CompiledCorrection::reduce(const std::function<int(const Node&)>& select) const -> std::shared_ptr<CompiledCorrection> {
+    auto out = std::make_shared<CompiledCorrection>(*this);
+    out->nodes_.clear();
+    out->root_ = reduceNode(root_, select, *out);
+    out->computeHashes();
+    return out;
+}
+
+auto CompiledCorrection::bindString(std::size_t input, const std::string& value) const -> std::shared_ptr<CompiledCorrection> {
+    return reduce([&](const Node& node) {
+        if (node.type != NodeType::Category || node.input != static_cast<int>(input)) return -1;
+        auto it = std::find(node.strKeys.begin(), node.strKeys.end(), value);
+        if (it != node.strKeys.end()) return node.children[it - node.strKeys.begin()];
+        if (node.defaultChild >= 0) return node.defaultChild;
+        throw std::runtime_error("CompiledCorrection: no key '" + value + "' for input '" + inputNames_[input] + "' in " + name_);
+    });
+}
+
+auto CompiledCorrection::bindValue(std::size_t input, double value) const -> std::shared_ptr<CompiledCorrection> {
+    return reduce([&](const Node& node) {
+        if (node.type == NodeType::Binning && node.axes[0].input == static_cast<int>(input)) {
+            const Axis& axis = node.axes[0];
+            const int bin = axis.findBin(value);
+            if (bin >= 0 && bin < axis.nBins) return node.children[bin];
+            if (node.flow == Flow::Default) return node.flowChild;
+            if (node.flow == Flow::Clamp) return node.children[std::clamp(bin, 0, axis.nBins - 1)];
+            return -1; // error flow: left to the evaluation
+        }
+        if (node.type == NodeType::Category && node.input == static_cast<int>(input) && node.strKeys.empty()) {
+            auto it = std::find(node.intKeys.begin(), node.intKeys.end(), static_cast<int>(value));
+            if (it != node.intKeys.end()) return node.children[it - node.intKeys.begin()];
+            return node.defaultChild; // -1 (kept) if there is none
+        }
+        return -1;
+    });
+}
+
+bool CompiledCorrection::hasStringNodes() const {
+    return std::any_of(nodes_.begin(), nodes_.end(), [](const Node& node) {
+        return node.type == NodeType::Category && !node.strKeys.empty();
+    });
+}
+
+void CompiledCorrection::setNativeFunctions(const std::vector<FormulaFn>& functions) {
+    if (functions.size() != formulas_.size()) {
+        throw std::runtime_error("CompiledCorrection: expected " + std::to_string(formulas_.size()) +
+                                 " native functions for " + name_);
+    }
+    nativeFunctions_ = functions;
+}
+
+auto CompiledCorrection::getInputRange(std::size_t input) const -> std::pair<double, double> {
+    double low  =  std::numeric_limits<double>::infinity();
+    double high = -std::numeric_limits<double>::infinity();
+    for (const Node& node : nodes_) {
+        for (const Axis& axis : node.axes) {
+            if (axis.input != static_cast<int>(input)) continue;
+            low  = std::min(low,  axis.uniform ? axis.low  : axis.edges.front());
+            high = std::max(high, axis.uniform ? axis.high : axis.edges.back());
+        }
+        if (node.type == NodeType::Category && node.input == static_cast<int>(input) && !node.intKeys.empty()) {
+            low  = std::min(low,  static_cast<double>(*std::min_element(node.intKeys.begin(), node.intKeys.end())));
+            high = std::max(high, static_cast<double>(*std::max_element(node.intKeys.begin(), node.intKeys.end())));
+        }
+    }
+    return {low, high};
+}
+
+std::vector<double> CompiledCorrection::getInputEdges(std::size_t input) const {
+    std::vector<double> edges;
+    for (const Node& node : nodes_) {
+        for (const Axis& axis : node.axes) {
+            if (axis.input != static_cast<int>(input)) continue;
+            if (axis.uniform) {
+                for (int i = 0; i <= axis.nBins; ++i) {
+                    edges.push_back(axis.low + (axis.high - axis.low) * i / axis.nBins);
+                }
+            } else {
+                edges.insert(edges.end(), axis.edges.begin(), axis.edges.end());
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    return edges;
+}
+
+bool CompiledCorrection::isFormulaInput(std::size_t input) const {
+    return std::any_of(nodes_.begin(), nodes_.end(), [input](const Node& node) {
+        return node.type == NodeType::Formula &&
+               std::find(node.variables.begin(), node.variables.end(), static_cast<int>(input)) != node.variables.end();
+    });
+}
+
+bool CompiledCorrection::isCategoryInput(std::size_t input) const {
+    return std::any_of(nodes_.begin(), nodes_.end(), [input](const Node& node) {
+        return node.type == NodeType::Category && node.input == static_cast<int>(input);
+    });
+}
+
+bool CompiledCorrection::isSelectingInput(std::size_t input) const {
+    return std::any_of(nodes_.begin(), nodes_.end(), [input](const Node& node) {
+        return (node.type == NodeType::Binning && node.axes[0].input == static_cast<int>(input)) ||
+               (node.type == NodeType::Category && node.input == static_cast<int>(input));
+    });
+}
+
+bool CompiledCorrection::hasBranchFor(std::size_t input, double value) const {
+    bool selects = false;
+    for (const Node& node : nodes_) {
+        for (const Axis& axis : node.axes) {
+            if (axis.input != static_cast<int>(input)) continue;
+            selects = true;
+            const double low  = axis.uniform ? axis.low  : axis.edges.front();
+            const double high = axis.uniform ? axis.high : axis.edges.back();
+            if (value >= low && value < high) return true;
+        }
+        if (node.type == NodeType::Category && node.input == static_cast<int>(input)) {
+            selects = true;
+            const int key = static_cast<int>(std::lround(value));
+            if (std::find(node.intKeys.begin(), node.intKeys.end(), key) != node.intKeys.end()) return true;
+        }
+    }
+    return !selects;
+}
+
+bool CompiledCorrection::isUniformInput(std::size_t input) const {
+    return std::any_of(nodes_.begin(), nodes_.end(), [input](const Node& node) {
+        return std::any_of(node.axes.begin(), node.axes.end(), [input](const Axis& axis) {
+            return axis.uniform && axis.input == static_cast<int>(input);
+        });
+    });
+}
+
+std::pair<double, double> CompiledCorrection::typicalRange(const std::string& inputName, bool& logScale) {
+    std::string name = inputName;
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    logScale = false;
+    if (name.find("pt") != std::string::npos) {
+        logScale = true;
+        return {5.0, 6500.0};
+    }
+    if (name.find("eta")  != std::string::npos) return {-5.5, 5.5};
+    if (name.find("phi")  != std::string::npos) return {-3.2, 3.2};
+    if (name.find("rho")  != std::string::npos) return {0.0, 100.0};
+    if (name.find("area") != std::string::npos) return {0.0, 1.5};
+    if (name.find("run")  != std::string::npos) return {355000.0, 395000.0};
+    return {-10.0, 10.0};
+}
@@ -0,0 +1,238 @@
+#include "CorrectionImage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "Helper.h"
+#include "nlohmann/json.hpp"
+
+namespace {
+// Version 2 has the hash of each section in the table; version 1 images are rebuilt
+const char headerMagic[8] = {'C', 'O', 'R', 'R', 'I', 'M', 'G', '2'};
+const char footerMagic[8] = {'C', 'O', 'R', 'R', 'E', 'N', 'D', '2'};
+// tableOffset, nSections, hash and the magic
+constexpr std::size_t footerSize = 3 * sizeof(std::uint64_t) + sizeof(footerMagic);
+
+std::size_t padded(std::size_t nBytes) {
+    return (nBytes + 7) & ~static_cast<std::size_t>(7);
+}
+
+// task(i) for i in [0, n), on up to nThreads threads
+void runParallel(std::size_t n, int nThreads, const std::function<void(std::size_t)>& task) {
+    nThreads = std::max(1, std::min<int>(nThreads, static_cast<int>(n)));
+    std::atomic<std::size_t> next{0};
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < n; i = next++) {
+            task(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void writeU64(std::ofstream& out, std::uint64_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+} // namespace
+
+auto CorrectionImage::readFile(const std::string& path) -> std::string {
+    // gzread also reads files that are not compressed
+    gzFile in = gzopen(path.c_str(), "rb");
+    if (!in) {
+        throw std::runtime_error("CorrectionImage: cannot open " + path);
+    }
+    std::string text;
+    char buffer[1 << 16];
+    int n = 0;
+    while ((n = gzread(in, buffer, sizeof(buffer))) > 0) {
+        text.append(buffer, static_cast<std::size_t>(n));
+    }
+    const bool failed = n < 0;
+    gzclose(in);
+    if (failed) {
+        throw std::runtime_error("CorrectionImage: cannot read " + path);
+    }
+    return text;
+}
+
+auto CorrectionImage::hashSources(const std::vector<Source>& sources, int nThreads) -> std::uint64_t {
+    // The files as they are on disk (compressed or not): reading is cheaper than parsing
+    std::vector<std::uint64_t> fileHashes(sources.size(), 0);
+    runParallel(sources.size(), nThreads, [&](std::size_t i) {
+        std::ifstream in(sources[i].jsonFile, std::ios::binary);
+        std::stringstream content;
+        content << in.rdbuf();
+        fileHashes[i] = Helper::fnv1aHash(content.str());
+    });
+
+    std::string key;
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+        key += sources[i].jsonFile + '\n' + std::to_string(fileHashes[i]) + '\n';
+        for (const auto& tag : sources[i].tags) {
+            key += tag + '\n';
+        }
+    }
+    return Helper::fnv1aHash(key);
+}
+
+void CorrectionImage::build(const std::string& path, const std::vector<Source>& sources,
+                            std::uint64_t hash, int nThreads) {
+    // Each CorrectionSet with only the corrections of the tags; compound corrections are
+    // dropped, as they may refer to corrections that are not kept
+    std::vector<std::string> sections(sources.size());
+    std::vector<std::string> errors(sources.size());
+    runParallel(sources.size(), nThreads, [&](std::size_t i) {
+        try {
+            nlohmann::json cset = nlohmann::json::parse(readFile(sources[i].jsonFile));
+            nlohmann::json kept = nlohmann::json::array();
+            for (const auto& corr : cset.at("corrections")) {
+                const std::string name = corr.at("name").get<std::string>();
+                const auto& tags = sources[i].tags;
+                if (std::find(tags.begin(), tags.end(), name) != tags.end()) kept.push_back(corr);
+            }
+            cset["corrections"] = std::move(kept);
+            cset.erase("compound_corrections");
+            sections[i] = cset.dump();
+        } catch (const std::exception& e) {
+            errors[i] = sources[i].jsonFile + ": " + e.what();
+        }
+    });
+    for (const auto& error : errors) {
+        if (!error.empty()) throw std::runtime_error("CorrectionImage: cannot parse " + error);
+    }
+
+    // Unique per process and thread: jobs building the same image do not write into
+    // each other's file, and the last rename wins with a complete image
+    const std::string tmpPath = path + ".tmp" + std::to_string(::getpid()) + "_" +
+                                std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("CorrectionImage: cannot write " + tmpPath);
+    }
+    out.write(headerMagic, sizeof(headerMagic));
+    const char zeros[8] = {};
+    std::vector<std::uint64_t> offsets;
+    for (const auto& section : sections) {
+        offsets.push_back(static_cast<std::uint64_t>(out.tellp()));
+        out.write(section.data(), static_cast<std::streamsize>(section.size()));
+        // The null terminator, and the padding to 8 bytes
+        out.write(zeros, static_cast<std::streamsize>(padded(section.size() + 1) - section.size()));
+    }
+    // Table: per section its offset, length and hash, and the length and characters of the file name
+    const auto tableOffset = static_cast<std::uint64_t>(out.tellp());
+    for (std::size_t i = 0; i < sections.size(); ++i) {
+        const std::string& name = sources[i].jsonFile;
+        writeU64(out, offsets[i]);
+        writeU64(out, sections[i].size());
+        writeU64(out, Helper::fnv1aHash(sections[i]));
+        writeU64(out, name.size());
+        out.write(name.data(), static_cast<std::streamsize>(name.size()));
+        out.write(zeros, static_cast<std::streamsize>(padded(name.size()) - name.size()));
+    }
+    writeU64(out, tableOffset);
+    writeU64(out, sections.size());
+    writeU64(out, hash);
+    out.write(footerMagic, sizeof(footerMagic));
+    out.close();
+    if (!out || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("CorrectionImage: failed to write " + path);
+    }
+    std::size_t nBytes = 0;
+    for (const auto& section : sections) {
+        nBytes += section.size();
+    }
+    std::cout << "[CorrectionImage] Wrote " << path << ": " << sources.size() << " files, "
+              << nBytes / 1024 << " kB of corrections" << '\n';
+}
+
+bool CorrectionImage::isUsable(const std::string& path, std::uint64_t hash) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in || in.tellg() < static_cast<std::streamoff>(sizeof(headerMagic) + footerSize)) return false;
+    in.seekg(-static_cast<std::streamoff>(footerSize), std::ios::end);
+    std::uint64_t footer[3];
+    char magic[sizeof(footerMagic)];
+    in.read(reinterpret_cast<char*>(footer), sizeof(footer));
+    in.read(magic, sizeof(magic));
+    return in && std::memcmp(magic, footerMagic, sizeof(magic)) == 0 && footer[2] == hash;
+}
+
+CorrectionImage::CorrectionImage(const std::string& path) : path_(path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("CorrectionImage: cannot open " + path);
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(headerMagic) + footerSize) {
+        ::close(fd);
+        throw std::runtime_error("CorrectionImage: " + path + " is too small");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        throw std::runtime_error("CorrectionImage: cannot map " + path);
+    }
+
+    const char* base = static_cast<const char*>(data_);
+    const char* footer = base + size_ - footerSize;
+    std::uint64_t counts[3];
+    std::memcpy(counts, footer, sizeof(counts));
+    const std::size_t tableEnd = size_ - footerSize;
+    auto fail = [&]() {
+        munmap(data_, size_);
+        data_ = nullptr;
+        throw std::runtime_error("CorrectionImage: " + path + " is incomplete or corrupted");
+    };
+    if (std::memcmp(base, headerMagic, sizeof(headerMagic)) != 0 ||
+        std::memcmp(footer + sizeof(counts), footerMagic, sizeof(footerMagic)) != 0 ||
+        counts[0] > tableEnd) {
+        fail();
+    }
+
+    // Every section between the header and the table, null terminated, with its content
+    // unchanged since the build: correctionlib parses it without any other check
+    std::size_t pos = counts[0];
+    for (std::uint64_t s = 0; s < counts[1]; ++s) {
+        std::uint64_t entry[4]; // offset, length, hash, name length
+        if (pos + sizeof(entry) > tableEnd) fail();
+        std::memcpy(entry, base + pos, sizeof(entry));
+        pos += sizeof(entry);
+        if (entry[3] > tableEnd - pos || entry[0] < sizeof(headerMagic) || entry[0] > counts[0] ||
+            entry[1] >= counts[0] - entry[0] || base[entry[0] + entry[1]] != '\0' ||
+            Helper::fnv1aHash(std::string(base + entry[0], entry[1])) != entry[2]) {
+            fail();
+        }
+        sections_[std::string(base + pos, entry[3])] = base + entry[0];
+        pos += padded(entry[3]);
+    }
+}
+
+CorrectionImage::~CorrectionImage() {
+    if (data_) munmap(data_, size_);
+}
+
+auto CorrectionImage::getJson(const std::string& jsonFile) const -> const char* {
+    auto it = sections_.find(jsonFile);
+    return it == sections_.end() ? nullptr : it->second;
+}
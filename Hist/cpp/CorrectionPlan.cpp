@@ -0,0 +1,105 @@
+#include "CorrectionPlan.h"
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+CorrectionPlan::CorrectionPlan(const MetadataRegistry& registry, const ScaleObject& scaleObject,
+                               const InputBranchMap& branchMap) {
+    // All the correction files at once, from their image, before they are needed
+    scaleObject.preloadCorrections(registry.getSources());
+    registry.validate(scaleObject);
+
+    for (const auto& meta : registry.getEntries()) {
+        CorrectionPlanEntry entry;
+        entry.baseKey      = meta.baseKey;
+        entry.group        = meta.group;
+        entry.level        = meta.level;
+        entry.id           = meta.id;
+        entry.labels       = meta.getLabels();
+        entry.reference    = meta.reference;
+
+        // For each version of the correction
+        for (const auto& version : meta.versions) {
+            const std::string& tag = version.tag;
+            auto ref = scaleObject.getCorrectionRef(version.jsonFile, tag);
+
+            std::vector<JetColumn> columns;
+            for (const auto& input : ref->inputs()) {
+                if (input.type() == correction::VarType::string) continue; // e.g. the JER systematic
+                columns.push_back(branchMap.getColumn(input.name()));
+                const std::string& branch = branchMap.getBranch(input.name());
+                if (std::find(inputBranches_.begin(), inputBranches_.end(), branch) == inputBranches_.end()) {
+                    inputBranches_.push_back(branch);
+                }
+            }
+            entry.inputColumns.push_back(std::move(columns));
+            entry.refs.push_back(std::move(ref));
+            entry.tags.push_back(tag);
+            entry.sameAs.push_back(-1);
+        }
+        entries_.push_back(std::move(entry));
+    }
+    std::cout << "[CorrectionPlan] Compiled " << entries_.size() << " baseKeys from " << registry.getPath() << '\n';
+    std::cout << "[CorrectionPlan] Input branches:";
+    for (const auto& branch : inputBranches_) std::cout << ' ' << branch;
+    std::cout << '\n';
+}
+
+auto CorrectionPlan::getBaseKeys() const -> std::vector<std::string> {
+    std::vector<std::string> baseKeys;
+    baseKeys.reserve(entries_.size());
+    for (const auto& entry : entries_) {
+        baseKeys.push_back(entry.baseKey);
+    }
+    return baseKeys;
+}
+
+void CorrectionPlan::specialize(const ScaleObject& scaleObject) {
+    int nIdentical = 0;
+    int nFused = 0;
+    int nReduced = 0;
+    for (auto& entry : entries_) {
+        entry.invariantInputs.clear();
+        for (std::size_t v = 0; v < entry.refs.size(); ++v) {
+            std::vector<std::size_t> candidates;
+            for (std::size_t k = 0; k < entry.inputColumns[v].size(); ++k) {
+                const JetColumn col = entry.inputColumns[v][k];
+                if (col == JetColumn::Run || col == JetColumn::Rho) candidates.push_back(k);
+            }
+            // JER SF columns skip the string input, they do not match the correction inputs
+            if (entry.level == CorrectionLevel::ScaleFactor) candidates.clear();
+            entry.invariantInputs.push_back(scaleObject.reducibleInputs(entry.refs[v], candidates));
+        }
+        if (std::any_of(entry.invariantInputs.begin(), entry.invariantInputs.end(),
+                        [](const auto& inputs) { return !inputs.empty(); })) {
+            ++nReduced;
+        }
+
+        const VersionSharing sharing = scaleObject.shareVersions(entry.refs);
+        entry.sameAs = sharing.sameAs;
+        entry.fused = sharing.fused;
+        entry.fusedRefs.clear();
+        for (std::size_t v = 0; v < entry.refs.size(); ++v) {
+            if (entry.fused && entry.sameAs[v] < 0) entry.fusedRefs.push_back(entry.refs[v]);
+        }
+        if (std::any_of(entry.sameAs.begin(), entry.sameAs.end(), [](int u) { return u >= 0; })) {
+            ++nIdentical;
+        }
+        if (entry.fused) ++nFused;
+    }
+    std::cout << "[CorrectionPlan] Versions: " << nIdentical << " baseKeys with identical versions, "
+              << nFused << " fused on the same binning, " << nReduced
+              << " bound per run or event, out of " << entries_.size() << '\n';
+}
+
+void CorrectionPlan::printPlan() const {
+    for (const auto& entry : entries_) {
+        const bool identical = std::any_of(entry.sameAs.begin(), entry.sameAs.end(), [](int u) { return u >= 0; });
+        std::cout << std::setw(4) << entry.id << "  "
+                  << std::setw(14) << MetadataRegistry::levelName(entry.level) << "  "
+                  << (entry.group.empty() ? "" : entry.group + "/") << entry.baseKey
+                  << "  (" << entry.refs.size() << " versions"
+                  << (identical ? ", identical" : "") << (entry.fused ? ", fused" : "") << ")" << '\n';
+    }
+}
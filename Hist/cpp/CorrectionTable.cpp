@@ -0,0 +1,246 @@
+#include "CorrectionTable.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+CorrectionTable::CorrectionTable(const CompiledCorrection& corr, double tolerance, std::size_t maxPoints) {
+    const std::size_t nInputs = corr.getNInputs();
+    if (nInputs > maxInputs) return;
+    bool hasContinuous = false;
+    for (std::size_t i = 0; i < nInputs; ++i) {
+        if (corr.isStringInput(i)) continue;
+        // Integer categories (e.g. run numbers) do not map onto a grid
+        if (corr.isCategoryInput(i)) return;
+        hasContinuous = hasContinuous || corr.isFormulaInput(i);
+    }
+
+    int points = initialPoints;
+    buildAxes(corr, points);
+    if (countPoints() > maxPoints) return;
+    fillAndCheck(corr, tolerance);
+
+    // Refine while too many cells miss the tolerance and the budget allows. This only
+    // bounds how many cells are left to exact evaluation; the tolerance itself is
+    // enforced cell by cell in fillAndCheck
+    while (hasContinuous && exactFraction_ > 0.01 && 2 * points <= maxPointsPerSegment) {
+        std::vector<Axis> coarse = axes_;
+        buildAxes(corr, 2 * points);
+        if (countPoints() > maxPoints) {
+            // Keep the coarse grid, whose values are already filled
+            axes_ = std::move(coarse);
+            computeStrides();
+            break;
+        }
+        points *= 2;
+        fillAndCheck(corr, tolerance);
+    }
+    valid_ = true;
+}
+
+void CorrectionTable::buildAxes(const CompiledCorrection& corr, int pointsPerSegment) {
+    axes_.assign(corr.getNInputs(), Axis());
+    for (std::size_t i = 0; i < axes_.size(); ++i) {
+        Axis& axis = axes_[i];
+        const std::vector<double> edges = corr.getInputEdges(i);
+
+        if (!corr.isStringInput(i) && corr.isFormulaInput(i)) {
+            axis.continuous = true;
+            bool logScale = false;
+            const auto range = CompiledCorrection::typicalRange(corr.getInputNames()[i], logScale);
+            axis.bounds = edges.size() >= 2 ? edges : std::vector<double>{range.first, range.second};
+            for (std::size_t s = 0; s + 1 < axis.bounds.size(); ++s) {
+                const double a = axis.bounds[s];
+                const double b = axis.bounds[s + 1];
+                const bool useLog = logScale && a > 0.0;
+                axis.segFirst.push_back(static_cast<int>(axis.nodes.size()));
+                for (int p = 0; p < pointsPerSegment; ++p) {
+                    const double t = static_cast<double>(p) / (pointsPerSegment - 1);
+                    // The upper edge belongs to the next bin: stop just below it
+                    const double x = (p == pointsPerSegment - 1) ? std::nextafter(b, a)
+                                   : useLog ? a * std::pow(b / a, t) : a + (b - a) * t;
+                    axis.nodes.push_back(x);
+                }
+            }
+            axis.segFirst.push_back(static_cast<int>(axis.nodes.size()));
+            continue;
+        }
+
+        // Piecewise constant: one point per bin, including underflow and overflow
+        axis.bounds = corr.isStringInput(i) ? std::vector<double>() : edges;
+        const std::size_t nSeg = axis.bounds.size() + 1;
+        for (std::size_t s = 0; s < nSeg; ++s) {
+            axis.segFirst.push_back(static_cast<int>(s));
+            if (axis.bounds.empty())      axis.nodes.push_back(0.0);
+            else if (s == 0)              axis.nodes.push_back(axis.bounds.front() - 1.0);
+            else if (s == nSeg - 1)       axis.nodes.push_back(axis.bounds.back() + 1.0);
+            else                          axis.nodes.push_back(0.5 * (axis.bounds[s - 1] + axis.bounds[s]));
+        }
+        axis.segFirst.push_back(static_cast<int>(nSeg));
+    }
+    computeStrides();
+}
+
+void CorrectionTable::computeStrides() {
+    // Last input fastest
+    strides_.assign(axes_.size(), 1);
+    for (int i = static_cast<int>(axes_.size()) - 2; i >= 0; --i) {
+        strides_[i] = strides_[i + 1] * axes_[i + 1].nodes.size();
+    }
+}
+
+std::size_t CorrectionTable::countPoints() const {
+    std::size_t count = 1;
+    for (const Axis& axis : axes_) {
+        if (count > std::numeric_limits<std::size_t>::max() / axis.nodes.size()) {
+            return std::numeric_limits<std::size_t>::max();
+        }
+        count *= axis.nodes.size();
+    }
+    return count;
+}
+
+bool CorrectionTable::Axis::locate(double x, int& node, double& weight) const {
+    weight = 0.0;
+    if (!continuous) {
+        node = static_cast<int>(std::upper_bound(bounds.begin(), bounds.end(), x) - bounds.begin());
+        return true;
+    }
+    if (!(x >= bounds.front() && x < bounds.back())) return false;
+    const int seg = static_cast<int>(std::upper_bound(bounds.begin(), bounds.end(), x) - bounds.begin()) - 1;
+    const int first = segFirst[seg];
+    const int last  = segFirst[seg + 1];
+    int i = static_cast<int>(std::upper_bound(nodes.begin() + first, nodes.begin() + last, x) - nodes.begin()) - 1;
+    i = std::clamp(i, first, last - 2);
+    node = i;
+    weight = std::clamp((x - nodes[i]) / (nodes[i + 1] - nodes[i]), 0.0, 1.0);
+    return true;
+}
+
+double CorrectionTable::interpolate(std::size_t base, const int* contDims, const double* weights, int nCont) const {
+    double result = 0.0;
+    for (int mask = 0; mask < (1 << nCont); ++mask) {
+        double w = 1.0;
+        std::size_t index = base;
+        for (int c = 0; c < nCont; ++c) {
+            if (mask & (1 << c)) {
+                w *= weights[c];
+                index += strides_[contDims[c]];
+            } else {
+                w *= 1.0 - weights[c];
+            }
+        }
+        if (w != 0.0) result += w * values_[index];
+    }
+    return result;
+}
+
+void CorrectionTable::fillAndCheck(const CompiledCorrection& corr, double tolerance) {
+    const std::size_t nInputs = axes_.size();
+    const std::size_t nPoints = countPoints();
+    values_.assign(nPoints, std::numeric_limits<double>::quiet_NaN());
+    exactCells_.assign(nPoints, 1);
+
+    int contDims[maxInputs];
+    int nCont = 0;
+    for (std::size_t i = 0; i < nInputs; ++i) {
+        if (axes_[i].continuous) contDims[nCont++] = static_cast<int>(i);
+    }
+
+    // Exact values at the grid points (NaN where the correction throws)
+    std::vector<int> index(nInputs, 0);
+    std::vector<double> x(nInputs, 0.0);
+    auto nextIndex = [&index, this]() {
+        for (int i = static_cast<int>(index.size()) - 1; i >= 0; --i) {
+            if (++index[i] < static_cast<int>(axes_[i].nodes.size())) return;
+            index[i] = 0;
+        }
+    };
+    for (std::size_t flat = 0; flat < nPoints; ++flat, nextIndex()) {
+        for (std::size_t i = 0; i < nInputs; ++i) x[i] = axes_[i].nodes[index[i]];
+        try { values_[flat] = corr.evaluate(x.data()); } catch (const std::exception&) {}
+    }
+
+    // Compare every cell at its corners, edge and face midpoints and centre (weights
+    // 0, 0.5 and 1 along each continuous input), and at a few pseudo-random points:
+    // the interpolation error can peak away from the centre, e.g. near a formula kink
+    int nGrid = 1;
+    for (int c = 0; c < nCont; ++c) nGrid *= 3;
+    std::vector<std::vector<double>> testWeights;
+    for (int g = 0; g < nGrid; ++g) {
+        std::vector<double> w(nCont);
+        for (int c = 0, rest = g; c < nCont; ++c, rest /= 3) w[c] = 0.5 * (rest % 3);
+        testWeights.push_back(std::move(w));
+    }
+    std::uint64_t random = 0x9e3779b97f4a7c15ULL; // xorshift, the same points on every run
+    auto uniform = [&random]() {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        return static_cast<double>(random >> 11) / 9007199254740992.0; // [0, 1)
+    };
+
+    const std::size_t nTests = testWeights.size() + (nCont > 0 ? randomPointsPerCell : 0);
+
+    std::size_t nCells = 0, nExact = 0;
+    maxError_ = 0.0;
+    double weights[maxInputs];
+    std::fill(index.begin(), index.end(), 0);
+    for (std::size_t flat = 0; flat < nPoints; ++flat, nextIndex()) {
+        bool isCell = true;
+        for (int c = 0; c < nCont && isCell; ++c) {
+            const Axis& axis = axes_[contDims[c]];
+            // The last point of a segment is not the lower corner of a cell
+            isCell = std::find(axis.segFirst.begin(), axis.segFirst.end(), index[contDims[c]] + 1) == axis.segFirst.end();
+        }
+        if (!isCell) continue;
+        ++nCells;
+
+        for (std::size_t i = 0; i < nInputs; ++i) {
+            if (!axes_[i].continuous) x[i] = axes_[i].nodes[index[i]];
+        }
+        double cellError = 0.0;
+        for (std::size_t t = 0; t < nTests && !std::isnan(cellError); ++t) {
+            for (int c = 0; c < nCont; ++c) {
+                weights[c] = t < testWeights.size() ? testWeights[t][c] : uniform();
+                const Axis& axis = axes_[contDims[c]];
+                const double lo = axis.nodes[index[contDims[c]]];
+                const double hi = axis.nodes[index[contDims[c]] + 1];
+                x[contDims[c]] = lo + weights[c] * (hi - lo);
+            }
+            double exact = std::numeric_limits<double>::quiet_NaN();
+            try { exact = corr.evaluate(x.data()); } catch (const std::exception&) {}
+            const double approx = interpolate(flat, contDims, weights, nCont);
+            const double error = std::fabs(approx - exact) / std::max(std::fabs(exact), 1e-9);
+            cellError = std::isnan(error) ? error : std::max(cellError, error);
+        }
+        if (std::isnan(cellError) || cellError > tolerance) {
+            ++nExact;
+        } else {
+            exactCells_[flat] = 0;
+            maxError_ = std::max(maxError_, cellError);
+        }
+    }
+    exactFraction_ = nCells ? static_cast<double>(nExact) / nCells : 0.0;
+}
+
+bool CorrectionTable::lookup(const double* inputs, double& value) const {
+    std::size_t base = 0;
+    int contDims[maxInputs];
+    double weights[maxInputs];
+    int nCont = 0;
+    for (std::size_t i = 0; i < axes_.size(); ++i) {
+        int node = 0;
+        double weight = 0.0;
+        if (!axes_[i].locate(inputs[i], node, weight)) return false;
+        base += node * strides_[i];
+        if (axes_[i].continuous) {
+            contDims[nCont] = static_cast<int>(i);
+            weights[nCont++] = weight;
+        }
+    }
+    if (exactCells_[base]) return false;
+    value = interpolate(base, contDims, weights, nCont);
+    return true;
+}
@@ -0,0 +1,63 @@
+#include "EventBatchRing.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+EventBatchRing::EventBatchRing(std::size_t nSlots, std::size_t nEvents, std::size_t nJetMax)
+    : slots_(nSlots) {
+    if (nSlots == 0) {
+        throw std::runtime_error("EventBatchRing: the ring needs at least one slot");
+    }
+    for (auto& slot : slots_) {
+        slot.reserve(nEvents, nEvents * nJetMax);
+    }
+}
+
+void EventBatchRing::wait(int n) {
+    if (n < 64) return;
+    if (n < 128) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+auto EventBatchRing::beginWrite() -> EventBatch* {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    for (int n = 0; tail - head_.load(std::memory_order_acquire) >= slots_.size(); ++n) {
+        if (cancelled_.load(std::memory_order_relaxed)) return nullptr;
+        wait(n);
+    }
+    if (cancelled_.load(std::memory_order_relaxed)) return nullptr;
+    return &slots_[tail % slots_.size()];
+}
+
+void EventBatchRing::endWrite() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void EventBatchRing::close() {
+    closed_.store(true, std::memory_order_release);
+}
+
+auto EventBatchRing::beginRead() -> const EventBatch* {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    for (int n = 0; tail_.load(std::memory_order_acquire) == head; ++n) {
+        if (closed_.load(std::memory_order_acquire)) {
+            // The producer may have published a last batch before closing
+            if (tail_.load(std::memory_order_acquire) != head) break;
+            return nullptr;
+        }
+        wait(n);
+    }
+    return &slots_[head % slots_.size()];
+}
+
+void EventBatchRing::endRead() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void EventBatchRing::cancel() {
+    cancelled_.store(true, std::memory_order_relaxed);
+}
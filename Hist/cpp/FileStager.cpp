@@ -0,0 +1,286 @@
+#include "FileStager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <tuple>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string baseName(const std::string& name) {
+    return name.substr(name.find_last_of('/') + 1);
+}
+
+std::string replaceAll(std::string text, const std::string& key, const std::string& value) {
+    for (auto pos = text.find(key); pos != std::string::npos; pos = text.find(key, pos + value.size())) {
+        text.replace(pos, key.size(), value);
+    }
+    return text;
+}
+
+// DAS may drop the leading zeros of the checksum: compare the numbers
+bool sameChecksum(const std::string& a, const std::string& b) {
+    try {
+        return std::stoul(a, nullptr, 16) == std::stoul(b, nullptr, 16);
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+} // namespace
+
+FileStager::FileStager(std::vector<StageRequest> requests, Config config)
+    : requests_(std::move(requests)),
+      config_(std::move(config)),
+      states_(requests_.size(), State::Pending),
+      diskSizes_(requests_.size(), 0) {
+    std::error_code ec;
+    fs::create_directories(config_.stageDir, ec);
+    if (ec) {
+        throw std::runtime_error("FileStager: cannot create " + config_.stageDir + ": " + ec.message());
+    }
+    for (const auto& request : requests_) {
+        localPaths_.push_back((fs::path(config_.stageDir) / baseName(request.name)).string());
+    }
+    scanStageDir();
+    std::cout << "+ FileStager: " << readyQueue_.size() << " of " << requests_.size()
+              << " files already in " << config_.stageDir << ", "
+              << usedBytes_ / (1024 * 1024) << " MB on disk, budget "
+              << config_.diskBudget / (1024 * 1024) << " MB" << '\n';
+}
+
+FileStager::~FileStager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) {
+        t.join();
+    }
+}
+
+void FileStager::scanStageDir() {
+    std::unordered_map<std::string, std::size_t> requested;
+    for (std::size_t i = 0; i < localPaths_.size(); ++i) {
+        requested.emplace(localPaths_[i], i);
+    }
+
+    std::vector<std::tuple<fs::file_time_type, std::string, Long64_t>> others;
+    for (const auto& entry : fs::directory_iterator(config_.stageDir)) {
+        if (!entry.is_regular_file()) continue;
+        const std::string path = entry.path().string();
+        if (entry.path().extension() == ".part") {
+            fs::remove(entry.path()); // interrupted copy
+            continue;
+        }
+        const auto size = static_cast<Long64_t>(entry.file_size());
+        auto it = requested.find(path);
+        if (it == requested.end()) {
+            others.emplace_back(entry.last_write_time(), path, size);
+            continue;
+        }
+        std::string error;
+        if (states_[it->second] == State::Pending && verify(it->second, path, error)) {
+            states_[it->second] = State::Ready;
+            diskSizes_[it->second] = size;
+            usedBytes_ += size;
+            readyQueue_.push_back(it->second);
+        } else {
+            std::cerr << "Warning: removing staged " << path << ": " << error << '\n';
+            fs::remove(entry.path());
+        }
+    }
+
+    // Files of other jobs are the first to go, oldest first
+    std::sort(others.begin(), others.end());
+    for (const auto& [mtime, path, size] : others) {
+        evictable_.emplace_back(path, size);
+        usedBytes_ += size;
+    }
+}
+
+void FileStager::start() {
+    const auto nPending = static_cast<int>(std::count(states_.begin(), states_.end(), State::Pending));
+    const int nWorkers = std::min(std::max(1, config_.nWorkers), nPending);
+    for (int w = 0; w < nWorkers; ++w) {
+        workers_.emplace_back(&FileStager::worker, this);
+    }
+}
+
+void FileStager::reserve(std::unique_lock<std::mutex>& lock, Long64_t bytes) {
+    while (true) {
+        while (usedBytes_ + bytes > config_.diskBudget && !evictable_.empty()) {
+            const auto [path, size] = evictable_.front();
+            evictable_.pop_front();
+            std::error_code ec;
+            fs::remove(path, ec);
+            usedBytes_ -= size;
+        }
+        // A file larger than the whole budget is copied alone
+        if (usedBytes_ + bytes <= config_.diskBudget || usedBytes_ == 0 || stopping_) break;
+        // Everything on disk is being copied or read: wait for a release
+        cv_.wait(lock);
+    }
+    usedBytes_ += bytes;
+}
+
+void FileStager::worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        while (nextPending_ < requests_.size() && states_[nextPending_] != State::Pending) {
+            ++nextPending_;
+        }
+        if (nextPending_ >= requests_.size()) break;
+        const std::size_t index = nextPending_++;
+        states_[index] = State::Copying;
+
+        // Files of unknown size are accounted once copied
+        const Long64_t expected = std::max<Long64_t>(0, requests_[index].size);
+        reserve(lock, expected);
+        diskSizes_[index] = expected;
+        if (stopping_) break;
+        lock.unlock();
+
+        std::string error;
+        bool ok = false;
+        for (int attempt = 1; attempt <= config_.maxAttempts && !ok; ++attempt) {
+            ok = copy(index, error);
+            if (!ok && attempt < config_.maxAttempts) {
+                std::cerr << "Warning: staging " << requests_[index].name << " failed (" << error << "), retrying" << '\n';
+            }
+        }
+
+        lock.lock();
+        if (ok) {
+            std::error_code ec;
+            const auto size = static_cast<Long64_t>(fs::file_size(localPaths_[index], ec));
+            usedBytes_ += size - diskSizes_[index];
+            diskSizes_[index] = size;
+            states_[index] = State::Ready;
+            readyQueue_.push_back(index);
+            std::cout << "[FileStager] Staged " << requests_[index].name << " (" << size / (1024 * 1024) << " MB)" << '\n';
+        } else {
+            usedBytes_ -= diskSizes_[index];
+            diskSizes_[index] = 0;
+            states_[index] = State::Failed;
+            ++nDone_;
+            std::cerr << "Error: failed to stage " << requests_[index].name << ": " << error << '\n';
+        }
+        cv_.notify_all();
+    }
+}
+
+auto FileStager::copy(std::size_t index, std::string& error) const -> bool {
+    const std::string partPath = localPaths_[index] + ".part";
+    std::error_code ec;
+    fs::remove(partPath, ec);
+
+    std::string cmd = replaceAll(config_.command, "{name}", requests_[index].name);
+    cmd = replaceAll(cmd, "{dst}", partPath);
+    const int ret = std::system(cmd.c_str());
+    if (ret != 0) {
+        error = "'" + cmd + "' returned " + std::to_string(ret);
+        fs::remove(partPath, ec);
+        return false;
+    }
+    if (!verify(index, partPath, error)) {
+        fs::remove(partPath, ec);
+        return false;
+    }
+    fs::rename(partPath, localPaths_[index], ec);
+    if (ec) {
+        error = "cannot rename " + partPath + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+auto FileStager::verify(std::size_t index, const std::string& path, std::string& error) const -> bool {
+    const StageRequest& request = requests_[index];
+    std::error_code ec;
+    const auto size = static_cast<Long64_t>(fs::file_size(path, ec));
+    if (ec) {
+        error = "missing after copy";
+        return false;
+    }
+    if (request.size >= 0 && size != request.size) {
+        error = "size " + std::to_string(size) + " instead of " + std::to_string(request.size);
+        return false;
+    }
+    if (!request.adler32.empty()) {
+        const std::string checksum = adler32(path);
+        if (!sameChecksum(checksum, request.adler32)) {
+            error = "adler32 " + checksum + " instead of " + request.adler32;
+            return false;
+        }
+    }
+    return true;
+}
+
+auto FileStager::next(StagedFile& file) -> bool {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() {
+        return !readyQueue_.empty() || nDone_ == requests_.size() || stopping_;
+    });
+    if (readyQueue_.empty()) return false;
+    file.index = readyQueue_.front();
+    file.localPath = localPaths_[file.index];
+    readyQueue_.pop_front();
+    states_[file.index] = State::InUse;
+    ++nDone_;
+    return true;
+}
+
+void FileStager::release(std::size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index >= states_.size() || states_[index] != State::InUse) return;
+        states_[index] = State::Released;
+        // Most recently used: evicted last, also by the next runs
+        std::error_code ec;
+        fs::last_write_time(localPaths_[index], fs::file_time_type::clock::now(), ec);
+        evictable_.emplace_back(localPaths_[index], diskSizes_[index]);
+    }
+    cv_.notify_all();
+}
+
+auto FileStager::getNFailed() const -> int {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(std::count(states_.begin(), states_.end(), State::Failed));
+}
+
+auto FileStager::adler32(const std::string& path) -> std::string {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return "";
+    constexpr std::uint32_t mod = 65521;
+    // Largest n such that the sums cannot overflow before the modulo
+    constexpr std::size_t nmax = 5552;
+    std::uint32_t a = 1;
+    std::uint32_t b = 0;
+    std::vector<char> buffer(1 << 20);
+    while (in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const std::size_t n = static_cast<std::size_t>(in.gcount());
+        for (std::size_t start = 0; start < n; start += nmax) {
+            const std::size_t end = std::min(n, start + nmax);
+            for (std::size_t i = start; i < end; ++i) {
+                a += static_cast<unsigned char>(buffer[i]);
+                b += a;
+            }
+            a %= mod;
+            b %= mod;
+        }
+    }
+    std::ostringstream oss;
+    oss << std::hex << std::setw(8) << std::setfill('0') << ((b << 16) | a);
+    return oss.str();
+}
@@ -0,0 +1,159 @@
+#include "FlatHist.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TProfile.h"
+
+FlatAxis::FlatAxis(int nBins, double low, double high)
+    : nBins_(nBins), low_(low), high_(high) {
+    if (nBins_ < 1 || !(low_ < high_)) {
+        throw std::runtime_error("FlatAxis: invalid binning");
+    }
+}
+
+FlatAxis::FlatAxis(std::vector<double> edges)
+    : edges_(std::move(edges)) {
+    if (edges_.size() < 2 || !std::is_sorted(edges_.begin(), edges_.end())) {
+        throw std::runtime_error("FlatAxis: the bin edges must be at least two and sorted");
+    }
+    nBins_ = static_cast<int>(edges_.size()) - 1;
+    low_ = edges_.front();
+    high_ = edges_.back();
+}
+
+auto FlatAxis::findVariableBin(double x) const -> int {
+    // Index of the first edge above x, as TMath::BinarySearch + 1
+    return static_cast<int>(std::upper_bound(edges_.begin(), edges_.end(), x) - edges_.begin());
+}
+
+auto FlatAxis::getBinEdges() const -> std::vector<double> {
+    if (!edges_.empty()) return edges_;
+    std::vector<double> edges(nBins_ + 1);
+    for (int i = 0; i <= nBins_; ++i) {
+        edges[i] = low_ + i * (high_ - low_) / nBins_;
+    }
+    return edges;
+}
+
+auto FlatAxis::getBinCenter(int bin) const -> double {
+    if (edges_.empty()) return low_ + (bin - 0.5) * (high_ - low_) / nBins_;
+    return 0.5 * (edges_[bin - 1] + edges_[bin]);
+}
+
+FlatHist1D::FlatHist1D(const FlatAxis& axis)
+    : axis_(axis), sumw_(axis.getNBins() + 2, 0.0) {
+}
+
+void FlatHist1D::add(const FlatHist1D& other) {
+    if (other.sumw_.size() != sumw_.size()) {
+        throw std::runtime_error("FlatHist1D: cannot add histograms with different binning");
+    }
+    for (std::size_t i = 0; i < sumw_.size(); ++i) {
+        sumw_[i] += other.sumw_[i];
+    }
+    entries_ += other.entries_;
+    tsumw_ += other.tsumw_;
+    tsumwx_ += other.tsumwx_;
+    tsumwx2_ += other.tsumwx2_;
+}
+
+auto FlatHist1D::toTH1D(const std::string& name, const std::string& title) const -> TH1D* {
+    TH1D* h = axis_.getEdges().empty()
+        ? new TH1D(name.c_str(), title.c_str(), axis_.getNBins(), axis_.getLow(), axis_.getHigh())
+        : new TH1D(name.c_str(), title.c_str(), axis_.getNBins(), axis_.getEdges().data());
+    std::copy(sumw_.begin(), sumw_.end(), h->GetArray());
+    if (h->GetSumw2N() > 0) {
+        // Unit weights: the sum of squares is the content
+        std::copy(sumw_.begin(), sumw_.end(), h->GetSumw2()->GetArray());
+    }
+    // After the contents, which reset the statistics
+    double stats[4] = {tsumw_, tsumw_, tsumwx_, tsumwx2_};
+    h->PutStats(stats);
+    h->SetEntries(entries_);
+    return h;
+}
+
+FlatProfile::FlatProfile(const FlatAxis& axis)
+    : axis_(axis),
+      sumw_(axis.getNBins() + 2, 0.0),
+      sumwy_(axis.getNBins() + 2, 0.0),
+      sumwy2_(axis.getNBins() + 2, 0.0) {
+}
+
+void FlatProfile::add(const FlatProfile& other) {
+    if (other.sumw_.size() != sumw_.size()) {
+        throw std::runtime_error("FlatProfile: cannot add profiles with different binning");
+    }
+    for (std::size_t i = 0; i < sumw_.size(); ++i) {
+        sumw_[i] += other.sumw_[i];
+        sumwy_[i] += other.sumwy_[i];
+        sumwy2_[i] += other.sumwy2_[i];
+    }
+    entries_ += other.entries_;
+    tsumw_ += other.tsumw_;
+    tsumwx_ += other.tsumwx_;
+    tsumwx2_ += other.tsumwx2_;
+    tsumwy_ += other.tsumwy_;
+    tsumwy2_ += other.tsumwy2_;
+}
+
+auto FlatProfile::toTProfile(const std::string& name, const std::string& title) const -> TProfile* {
+    TProfile* p = axis_.getEdges().empty()
+        ? new TProfile(name.c_str(), title.c_str(), axis_.getNBins(), axis_.getLow(), axis_.getHigh())
+        : new TProfile(name.c_str(), title.c_str(), axis_.getNBins(), axis_.getEdges().data());
+    // A TProfile keeps the sum of y in its array and the sum of y^2 in fSumw2
+    std::copy(sumwy_.begin(), sumwy_.end(), p->GetArray());
+    std::copy(sumwy2_.begin(), sumwy2_.end(), p->GetSumw2()->GetArray());
+    for (std::size_t bin = 0; bin < sumw_.size(); ++bin) {
+        p->SetBinEntries(static_cast<int>(bin), sumw_[bin]);
+    }
+    if (p->GetBinSumw2()->GetSize() > 0) {
+        std::copy(sumw_.begin(), sumw_.end(), p->GetBinSumw2()->GetArray());
+    }
+    double stats[6] = {tsumw_, tsumw_, tsumwx_, tsumwx2_, tsumwy_, tsumwy2_};
+    p->PutStats(stats);
+    p->SetEntries(entries_);
+    return p;
+}
+
+FlatHist2D::FlatHist2D(const FlatAxis& xAxis, const FlatAxis& yAxis)
+    : xAxis_(xAxis), yAxis_(yAxis),
+      sumw_(static_cast<std::size_t>(xAxis.getNBins() + 2) * (yAxis.getNBins() + 2), 0.0) {
+}
+
+void FlatHist2D::add(const FlatHist2D& other) {
+    if (other.sumw_.size() != sumw_.size()) {
+        throw std::runtime_error("FlatHist2D: cannot add histograms with different binning");
+    }
+    for (std::size_t i = 0; i < sumw_.size(); ++i) {
+        sumw_[i] += other.sumw_[i];
+    }
+    entries_ += other.entries_;
+    tsumw_ += other.tsumw_;
+    tsumwx_ += other.tsumwx_;
+    tsumwx2_ += other.tsumwx2_;
+    tsumwy_ += other.tsumwy_;
+    tsumwy2_ += other.tsumwy2_;
+    tsumwxy_ += other.tsumwxy_;
+}
+
+auto FlatHist2D::toTH2D(const std::string& name, const std::string& title) const -> TH2D* {
+    // Both axes uniform or both variable, as the TH2D constructors
+    TH2D* h = (xAxis_.getEdges().empty() && yAxis_.getEdges().empty())
+        ? new TH2D(name.c_str(), title.c_str(), xAxis_.getNBins(), xAxis_.getLow(), xAxis_.getHigh(),
+                   yAxis_.getNBins(), yAxis_.getLow(), yAxis_.getHigh())
+        : new TH2D(name.c_str(), title.c_str(), xAxis_.getNBins(), xAxis_.getBinEdges().data(),
+                   yAxis_.getNBins(), yAxis_.getBinEdges().data());
+    std::copy(sumw_.begin(), sumw_.end(), h->GetArray());
+    if (h->GetSumw2N() > 0) {
+        std::copy(sumw_.begin(), sumw_.end(), h->GetSumw2()->GetArray());
+    }
+    double stats[7] = {tsumw_, tsumw_, tsumwx_, tsumwx2_, tsumwy_, tsumwy2_, tsumwxy_};
+    h->PutStats(stats);
+    h->SetEntries(entries_);
+    return h;
+}
@@ -0,0 +1,136 @@
+#include "FormulaCompiler.h"
+#include "Helper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+FormulaCompiler::FormulaCompiler(std::string cacheDir)
+    : cacheDir_(std::move(cacheDir)) {}
+
+FormulaCompiler::~FormulaCompiler() {
+    for (void* handle : handles_) {
+        dlclose(handle);
+    }
+}
+
+std::string FormulaCompiler::generateSource(const std::vector<const FormulaExpr*>& formulas) {
+    std::ostringstream src;
+    src << "// Generated by FormulaCompiler, do not edit\n"
+        << "#include <algorithm>\n"
+        << "#include <cmath>\n\n"
+        << "extern \"C\" {\n";
+    for (std::size_t i = 0; i < formulas.size(); ++i) {
+        src << "// " << formulas[i]->getExpression() << "\n"
+            << "double f_" << i << "(const double* v, const double* p) {\n"
+            << "    (void)v; (void)p;\n"
+            << "    return " << formulas[i]->toCpp() << ";\n"
+            << "}\n";
+    }
+    src << "\ntypedef double (*formula_fn)(const double*, const double*);\n"
+        << "formula_fn formula_table[] = {";
+    for (std::size_t i = 0; i < formulas.size(); ++i) {
+        src << (i ? ", " : "") << "f_" << i;
+    }
+    src << "};\n"
+        << "unsigned long formula_count = " << formulas.size() << ";\n"
+        << "}\n";
+    return src.str();
+}
+
+bool FormulaCompiler::buildLibrary(const std::string& source, const std::string& libPath) const {
+    std::error_code ec;
+    fs::create_directories(cacheDir_, ec);
+
+    // Build under a per-process name and rename, so concurrent jobs never load a partial file
+    const std::string stem    = libPath + ".tmp" + std::to_string(getpid());
+    const std::string srcPath = stem + ".cpp";
+    const std::string tmpLib  = stem + ".so";
+    const std::string logPath = stem + ".log";
+    {
+        std::ofstream out(srcPath);
+        if (!out) {
+            std::cerr << "[FormulaCompiler] Cannot write " << srcPath << '\n';
+            return false;
+        }
+        out << source;
+    }
+
+    const char* cxx = std::getenv("CXX");
+    const std::string command = std::string(cxx ? cxx : "g++") +
+        " -O2 -shared -fPIC -std=c++17 -o " + tmpLib + " " + srcPath + " > " + logPath + " 2>&1";
+    std::cout << "[FormulaCompiler] " << command << '\n';
+    const int status = std::system(command.c_str());
+
+    bool ok = (status == 0);
+    if (ok) {
+        fs::rename(tmpLib, libPath, ec);
+        ok = !ec;
+    } else {
+        std::ifstream log(logPath);
+        std::cerr << "[FormulaCompiler] Compilation failed (status " << status << "):\n" << log.rdbuf() << '\n';
+    }
+    fs::remove(srcPath, ec);
+    fs::remove(tmpLib, ec);
+    fs::remove(logPath, ec);
+    return ok;
+}
+
+bool FormulaCompiler::compile(const std::vector<CompiledCorrection*>& corrections, const std::string& contentKey) {
+    // Distinct formulas over all corrections, in order of first appearance
+    std::vector<const FormulaExpr*> formulas;
+    std::unordered_map<std::string, std::size_t> formulaIds;
+    for (const CompiledCorrection* corr : corrections) {
+        for (const FormulaExpr& formula : corr->getFormulas()) {
+            if (formulaIds.emplace(formula.getExpression(), formulas.size()).second) {
+                formulas.push_back(&formula);
+            }
+        }
+    }
+    if (formulas.empty()) return true;
+
+    const std::string source = generateSource(formulas);
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx",
+                  static_cast<unsigned long long>(Helper::fnv1aHash(contentKey + source)));
+    const std::string libPath = cacheDir_ + "/" + hash + ".so";
+
+    if (fs::exists(libPath)) {
+        std::cout << "[FormulaCompiler] Using cached " << libPath << '\n';
+    } else if (!buildLibrary(source, libPath)) {
+        return false;
+    }
+
+    void* handle = dlopen(fs::absolute(libPath).c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        std::cerr << "[FormulaCompiler] dlopen failed: " << dlerror() << '\n';
+        return false;
+    }
+    auto* count = static_cast<unsigned long*>(dlsym(handle, "formula_count"));
+    auto* table = static_cast<FormulaFn*>(dlsym(handle, "formula_table"));
+    if (!count || !table || *count != formulas.size()) {
+        std::cerr << "[FormulaCompiler] " << libPath << " does not match the formulas, ignoring it\n";
+        dlclose(handle);
+        return false;
+    }
+    handles_.push_back(handle);
+
+    for (CompiledCorrection* corr : corrections) {
+        std::vector<FormulaFn> functions;
+        for (const FormulaExpr& formula : corr->getFormulas()) {
+            functions.push_back(table[formulaIds.at(formula.getExpression())]);
+        }
+        if (!functions.empty()) corr->setNativeFunctions(functions);
+    }
+    std::cout << "[FormulaCompiler] Loaded " << formulas.size() << " native formulas from " << libPath << '\n';
+    return true;
+}
@@ -0,0 +1,313 @@
+#include "FormulaExpr.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <iterator>
+
+namespace {
+
+// Functions of one argument: TFormula name, C++ name used by toCpp()
+struct Func1 { const char* name; double (*fn)(double); const char* cpp; };
+const Func1 funcs1[] = {
+    {"exp",   [](double a) { return std::exp(a); },   "std::exp"},
+    {"log",   [](double a) { return std::log(a); },   "std::log"},
+    {"log10", [](double a) { return std::log10(a); }, "std::log10"},
+    {"sqrt",  [](double a) { return std::sqrt(a); },  "std::sqrt"},
+    {"abs",   [](double a) { return std::fabs(a); },  "std::fabs"},
+    {"fabs",  [](double a) { return std::fabs(a); },  "std::fabs"},
+    {"sin",   [](double a) { return std::sin(a); },   "std::sin"},
+    {"cos",   [](double a) { return std::cos(a); },   "std::cos"},
+    {"tan",   [](double a) { return std::tan(a); },   "std::tan"},
+    {"asin",  [](double a) { return std::asin(a); },  "std::asin"},
+    {"acos",  [](double a) { return std::acos(a); },  "std::acos"},
+    {"atan",  [](double a) { return std::atan(a); },  "std::atan"},
+    {"sinh",  [](double a) { return std::sinh(a); },  "std::sinh"},
+    {"cosh",  [](double a) { return std::cosh(a); },  "std::cosh"},
+    {"tanh",  [](double a) { return std::tanh(a); },  "std::tanh"},
+    {"erf",   [](double a) { return std::erf(a); },   "std::erf"},
+    {"erfc",  [](double a) { return std::erfc(a); },  "std::erfc"},
+};
+
+// Functions of two arguments
+struct Func2 { const char* name; double (*fn)(double, double); const char* cpp; };
+const Func2 funcs2[] = {
+    {"pow",   [](double a, double b) { return std::pow(a, b); },   "std::pow"},
+    {"power", [](double a, double b) { return std::pow(a, b); },   "std::pow"},
+    {"max",   [](double a, double b) { return std::max(a, b); },   "std::max<double>"},
+    {"min",   [](double a, double b) { return std::min(a, b); },   "std::min<double>"},
+    {"atan2", [](double a, double b) { return std::atan2(a, b); }, "std::atan2"},
+};
+
+std::string lowerName(std::string name) {
+    // TMath::Log10 -> log10
+    const std::string tmath = "TMath::";
+    if (name.compare(0, tmath.size(), tmath) == 0) name = name.substr(tmath.size());
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    return name;
+}
+
+std::string formatConstant(double value) {
+    std::ostringstream oss;
+    oss << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+    std::string s = oss.str();
+    if (s.find_first_of(".eEn") == std::string::npos) s += ".0"; // keep it a double literal
+    return "(" + s + ")";
+}
+
+} // namespace
+
+FormulaExpr::FormulaExpr(const std::string& expression)
+    : expression_(expression) {
+    parseComparison();
+    skipSpaces();
+    if (pos_ != expression_.size()) {
+        throw std::runtime_error("FormulaExpr: unexpected '" + expression_.substr(pos_) + "' in: " + expression_);
+    }
+    if (maxDepth_ > maxStack) {
+        throw std::runtime_error("FormulaExpr: expression too deep: " + expression_);
+    }
+}
+
+void FormulaExpr::emit(Op op, int index, double value) {
+    program_.push_back({op, index, value});
+    switch (op) {
+        case Op::Const: case Op::Var: case Op::Param:
+            ++depth_;
+            break;
+        case Op::Neg: case Op::Func1:
+            break;
+        default: // binary operators and Func2
+            --depth_;
+    }
+    maxDepth_ = std::max(maxDepth_, depth_);
+}
+
+void FormulaExpr::skipSpaces() {
+    while (pos_ < expression_.size() && std::isspace(static_cast<unsigned char>(expression_[pos_]))) ++pos_;
+}
+
+bool FormulaExpr::accept(const char* token) {
+    skipSpaces();
+    const std::size_t len = std::char_traits<char>::length(token);
+    if (expression_.compare(pos_, len, token) == 0) {
+        pos_ += len;
+        return true;
+    }
+    return false;
+}
+
+void FormulaExpr::parseComparison() {
+    parseSum();
+    while (true) {
+        if      (accept("<=")) { parseSum(); emit(Op::Le); }
+        else if (accept(">=")) { parseSum(); emit(Op::Ge); }
+        else if (accept("==")) { parseSum(); emit(Op::Eq); }
+        else if (accept("!=")) { parseSum(); emit(Op::Ne); }
+        else if (accept("<"))  { parseSum(); emit(Op::Lt); }
+        else if (accept(">"))  { parseSum(); emit(Op::Gt); }
+        else break;
+    }
+}
+
+void FormulaExpr::parseSum() {
+    parseProduct();
+    while (true) {
+        if      (accept("+")) { parseProduct(); emit(Op::Add); }
+        else if (accept("-")) { parseProduct(); emit(Op::Sub); }
+        else break;
+    }
+}
+
+void FormulaExpr::parseProduct() {
+    parsePower();
+    while (true) {
+        if      (accept("*")) { parsePower(); emit(Op::Mul); }
+        else if (accept("/")) { parsePower(); emit(Op::Div); }
+        else break;
+    }
+}
+
+void FormulaExpr::parsePower() {
+    // Right associative; a unary minus belongs to the atom as in correctionlib: -x^2 = (-x)^2
+    parseUnary();
+    if (accept("^")) {
+        parsePower();
+        emit(Op::Pow);
+    }
+}
+
+void FormulaExpr::parseUnary() {
+    if (accept("-")) {
+        parseUnary();
+        emit(Op::Neg);
+    } else if (accept("+")) {
+        parseUnary();
+    } else {
+        parsePrimary();
+    }
+}
+
+void FormulaExpr::parsePrimary() {
+    skipSpaces();
+    if (pos_ >= expression_.size()) {
+        throw std::runtime_error("FormulaExpr: unexpected end of: " + expression_);
+    }
+    const char c = expression_[pos_];
+
+    // Number
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+        const char* begin = expression_.c_str() + pos_;
+        char* end = nullptr;
+        double value = std::strtod(begin, &end);
+        pos_ += static_cast<std::size_t>(end - begin);
+        emit(Op::Const, 0, value);
+        return;
+    }
+
+    // Parameter [i]
+    if (c == '[') {
+        ++pos_;
+        std::size_t close = expression_.find(']', pos_);
+        if (close == std::string::npos) {
+            throw std::runtime_error("FormulaExpr: missing ']' in: " + expression_);
+        }
+        int index = std::stoi(expression_.substr(pos_, close - pos_));
+        pos_ = close + 1;
+        nParameters_ = std::max(nParameters_, index + 1);
+        emit(Op::Param, index);
+        return;
+    }
+
+    // Parenthesis
+    if (c == '(') {
+        ++pos_;
+        parseComparison();
+        if (!accept(")")) {
+            throw std::runtime_error("FormulaExpr: missing ')' in: " + expression_);
+        }
+        return;
+    }
+
+    // Identifier: variable or function
+    if (std::isalpha(static_cast<unsigned char>(c))) {
+        std::size_t start = pos_;
+        while (pos_ < expression_.size() &&
+               (std::isalnum(static_cast<unsigned char>(expression_[pos_])) ||
+                expression_[pos_] == '_' || expression_[pos_] == ':')) {
+            ++pos_;
+        }
+        const std::string name = expression_.substr(start, pos_ - start);
+
+        static const std::string varNames = "xyzt";
+        if (name.size() == 1 && varNames.find(name[0]) != std::string::npos) {
+            int index = static_cast<int>(varNames.find(name[0]));
+            nVariables_ = std::max(nVariables_, index + 1);
+            emit(Op::Var, index);
+            return;
+        }
+
+        const std::string fname = lowerName(name);
+        if (!accept("(")) {
+            throw std::runtime_error("FormulaExpr: unknown variable '" + name + "' in: " + expression_);
+        }
+        for (int f = 0; f < static_cast<int>(std::size(funcs1)); ++f) {
+            if (fname == funcs1[f].name) {
+                parseComparison();
+                if (!accept(")")) throw std::runtime_error("FormulaExpr: missing ')' in: " + expression_);
+                emit(Op::Func1, f);
+                return;
+            }
+        }
+        for (int f = 0; f < static_cast<int>(std::size(funcs2)); ++f) {
+            if (fname == funcs2[f].name) {
+                parseComparison();
+                if (!accept(",")) throw std::runtime_error("FormulaExpr: missing ',' in: " + expression_);
+                parseComparison();
+                if (!accept(")")) throw std::runtime_error("FormulaExpr: missing ')' in: " + expression_);
+                emit(Op::Func2, f);
+                return;
+            }
+        }
+        throw std::runtime_error("FormulaExpr: unsupported function '" + name + "' in: " + expression_);
+    }
+
+    throw std::runtime_error("FormulaExpr: unexpected '" + std::string(1, c) + "' in: " + expression_);
+}
+
+double FormulaExpr::evaluate(const double* vars, const double* params) const {
+    double stack[maxStack];
+    int top = -1;
+    for (const Instr& in : program_) {
+        switch (in.op) {
+            case Op::Const: stack[++top] = in.value; break;
+            case Op::Var:   stack[++top] = vars[in.index]; break;
+            case Op::Param: stack[++top] = params[in.index]; break;
+            case Op::Add: --top; stack[top] = stack[top] + stack[top + 1]; break;
+            case Op::Sub: --top; stack[top] = stack[top] - stack[top + 1]; break;
+            case Op::Mul: --top; stack[top] = stack[top] * stack[top + 1]; break;
+            case Op::Div: --top; stack[top] = stack[top] / stack[top + 1]; break;
+            case Op::Pow: --top; stack[top] = std::pow(stack[top], stack[top + 1]); break;
+            case Op::Neg: stack[top] = -stack[top]; break;
+            case Op::Lt: --top; stack[top] = stack[top] <  stack[top + 1] ? 1.0 : 0.0; break;
+            case Op::Gt: --top; stack[top] = stack[top] >  stack[top + 1] ? 1.0 : 0.0; break;
+            case Op::Le: --top; stack[top] = stack[top] <= stack[top + 1] ? 1.0 : 0.0; break;
+            case Op::Ge: --top; stack[top] = stack[top] >= stack[top + 1] ? 1.0 : 0.0; break;
+            case Op::Eq: --top; stack[top] = stack[top] == stack[top + 1] ? 1.0 : 0.0; break;
+            case Op::Ne: --top; stack[top] = stack[top] != stack[top + 1] ? 1.0 : 0.0; break;
+            case Op::Func1: stack[top] = funcs1[in.index].fn(stack[top]); break;
+            case Op::Func2: --top; stack[top] = funcs2[in.index].fn(stack[top], stack[top + 1]); break;
+        }
+    }
+    return stack[top];
+}
+
+std::string FormulaExpr::toCpp() const {
+    std::vector<std::string> stack;
+    auto binary = [&stack](const char* op) {
+        std::string rhs = std::move(stack.back());
+        stack.pop_back();
+        stack.back() = "(" + stack.back() + " " + op + " " + rhs + ")";
+    };
+    auto compare = [&stack](const char* op) {
+        std::string rhs = std::move(stack.back());
+        stack.pop_back();
+        stack.back() = "((" + stack.back() + " " + op + " " + rhs + ") ? 1.0 : 0.0)";
+    };
+    for (const Instr& in : program_) {
+        switch (in.op) {
+            case Op::Const: stack.push_back(formatConstant(in.value)); break;
+            case Op::Var:   stack.push_back("v[" + std::to_string(in.index) + "]"); break;
+            case Op::Param: stack.push_back("p[" + std::to_string(in.index) + "]"); break;
+            case Op::Add: binary("+"); break;
+            case Op::Sub: binary("-"); break;
+            case Op::Mul: binary("*"); break;
+            case Op::Div: binary("/"); break;
+            case Op::Pow: {
+                std::string rhs = std::move(stack.back());
+                stack.pop_back();
+                stack.back() = "std::pow(" + stack.back() + ", " + rhs + ")";
+                break;
+            }
+            case Op::Neg: stack.back() = "(-" + stack.back() + ")"; break;
+            case Op::Lt: compare("<");  break;
+            case Op::Gt: compare(">");  break;
+            case Op::Le: compare("<="); break;
+            case Op::Ge: compare(">="); break;
+            case Op::Eq: compare("=="); break;
+            case Op::Ne: compare("!="); break;
+            case Op::Func1: stack.back() = std::string(funcs1[in.index].cpp) + "(" + stack.back() + ")"; break;
+            case Op::Func2: {
+                std::string rhs = std::move(stack.back());
+                stack.pop_back();
+                stack.back() = std::string(funcs2[in.index].cpp) + "(" + stack.back() + ", " + rhs + ")";
+                break;
+            }
+        }
+    }
+    return stack.empty() ? "0.0" : stack.back();
+}
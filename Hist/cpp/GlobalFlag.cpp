@@ -14,6 +14,21 @@ void GlobalFlag::setDebug(const bool& debug){
 void GlobalFlag::setNDebug(const int & nDebug){
     nDebug_ = nDebug;
 }
+void GlobalFlag::setNThreads(const int & nThreads){
+    nThreads_ = nThreads;
+}
+void GlobalFlag::setCorrectionBackend(const CorrectionBackend& backend){
+    correctionBackend_ = backend;
+}
+void GlobalFlag::setLutTolerance(const double& tolerance){
+    lutTolerance_ = tolerance;
+}
+void GlobalFlag::setAsyncRead(const bool& asyncRead){
+    isAsyncRead_ = asyncRead;
+}
+void GlobalFlag::setWriteEmpty(const bool& writeEmpty){
+    isWriteEmpty_ = writeEmpty;
+}
 
 void GlobalFlag::parseFlags() {
     // Parsing Year
@@ -131,6 +146,21 @@ void GlobalFlag::printFlags() const {
         std::cout << "isDebug_ = true" << '\n';
         std::cout << "nDebug_ = " << nDebug_ << '\n';
     }
+    if (nThreads_ > 1){
+        std::cout << "nThreads_ = " << nThreads_ << '\n';
+    }
+    if (correctionBackend_ == CorrectionBackend::Native){
+        std::cout << "correctionBackend_ = Native" << '\n';
+    }
+    if (lutTolerance_ > 0){
+        std::cout << "lutTolerance_ = " << lutTolerance_ << '\n';
+    }
+    if (isAsyncRead_){
+        std::cout << "isAsyncRead_ = true" << '\n';
+    }
+    if (isWriteEmpty_){
+        std::cout << "isWriteEmpty_ = true" << '\n';
+    }
 
     // Print Year
     switch (year_) {
@@ -0,0 +1,311 @@
+#include "GridScan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+#include <TDirectory.h>
+#include <TH2D.h>
+#include <TH3D.h>
+#include <TProfile2D.h>
+
+#include "CorrectionPlan.h"
+#include "Helper.h"
+#include "HistGiven.h"
+#include "RunChannel.h"
+#include "ScaleObject.h"
+
+namespace {
+// Only these inputs can be scanned, the others are fixed
+bool isScannable(JetColumn col) {
+    return col == JetColumn::Eta || col == JetColumn::Pt || col == JetColumn::Rho;
+}
+
+std::string safeName(std::string key) {
+    for (auto& c : key) {
+        if (c == ':' || c == '/' || c == ' ') c = '_';
+    }
+    return key;
+}
+} // namespace
+
+GridScan::GridScan(const std::string& spec) {
+    // Defaults, in JetColumn order: Area, Eta, Phi, Pt, Rho, Run
+    axes_ = {
+        {"area", 1, 0.5, 0.5, false},
+        {"eta", 104, -5.191, 5.191, false},
+        {"phi", 1, 0.0, 0.0, false},
+        {"pt", 100, 10.0, 4500.0, true},
+        {"rho", 1, 20.0, 20.0, false},
+        {"run", 1, 0.0, 0.0, false}
+    };
+
+    for (const auto& item : Helper::splitString(spec, ",")) {
+        if (item.empty() || item == "default") continue; // e.g. default,run:383000
+        const std::vector<std::string> fields = Helper::splitString(item, ":");
+        auto it = std::find_if(axes_.begin(), axes_.end(), [&](const Axis& a) { return a.name == fields[0]; });
+        if (it == axes_.end()) {
+            throw std::runtime_error("GridScan: unknown input '" + fields[0] + "' in '" + item + "'");
+        }
+        Axis& a = *it;
+        const JetColumn col = static_cast<JetColumn>(it - axes_.begin());
+        if (col == JetColumn::Run) runGiven_ = true;
+        try {
+            if (fields.size() == 2) {
+                a.nBins = 1;
+                a.low = a.high = std::stod(fields[1]);
+                a.log = false;
+            } else if ((fields.size() == 4 || fields.size() == 5) && isScannable(col)) {
+                a.low   = std::stod(fields[1]);
+                a.high  = std::stod(fields[2]);
+                a.nBins = std::stoi(fields[3]);
+                a.log   = fields.size() == 5 && fields[4] == "log";
+                if (fields.size() == 5 && !a.log) {
+                    throw std::runtime_error("expected 'log'");
+                }
+            } else {
+                throw std::runtime_error("expected NAME:VALUE" +
+                                         std::string(isScannable(col) ? " or NAME:LOW:HIGH:N[:log]" : ""));
+            }
+        } catch (const std::exception& e) {
+            throw std::runtime_error("GridScan: invalid axis '" + item + "': " + e.what());
+        }
+        if (a.nBins < 1 || (a.nBins > 1 && a.high <= a.low) || (a.log && a.low <= 0)) {
+            throw std::runtime_error("GridScan: invalid range in '" + item + "'");
+        }
+    }
+}
+
+double GridScan::Axis::edge(int i) const {
+    if (nBins == 1 && low == high) return low + (i == 0 ? -0.5 : 0.5); // fixed value
+    const double f = static_cast<double>(i) / nBins;
+    return log ? low * std::pow(high / low, f) : low + (high - low) * f;
+}
+
+double GridScan::Axis::center(int i) const {
+    if (low == high) return low;
+    return log ? std::sqrt(edge(i) * edge(i + 1)) : 0.5 * (edge(i) + edge(i + 1));
+}
+
+std::vector<double> GridScan::Axis::edges() const {
+    std::vector<double> out;
+    for (int i = 0; i <= nBins; ++i) {
+        out.push_back(edge(i));
+    }
+    return out;
+}
+
+void GridScan::printGrid() const {
+    std::size_t nPoints = 1;
+    for (const Axis& a : axes_) {
+        std::cout << "[GridScan] " << a.name << ": ";
+        if (a.low == a.high) {
+            std::cout << a.low << '\n';
+        } else {
+            std::cout << a.nBins << " points in [" << a.low << ", " << a.high << "]" << (a.log ? " (log)" : "") << '\n';
+        }
+        nPoints *= a.nBins;
+    }
+    std::cout << "[GridScan] " << nPoints << " points" << '\n';
+}
+
+void GridScan::fillRow(int iEta, JetBatch& batch) const {
+    const Axis& pt = axis(JetColumn::Pt);
+    const Axis& rho = axis(JetColumn::Rho);
+    const double eta = axis(JetColumn::Eta).center(iEta);
+    for (int iPt = 0; iPt < pt.nBins; ++iPt) {
+        for (int iRho = 0; iRho < rho.nBins; ++iRho) {
+            batch.push(axis(JetColumn::Area).center(0), eta, axis(JetColumn::Phi).center(0), pt.center(iPt),
+                       rho.center(iRho), axis(JetColumn::Run).center(0));
+        }
+    }
+}
+
+void GridScan::run(const CorrectionPlan& plan, const ScaleObject& scaleObject, int nThreads, TDirectory* dir) const {
+    auto startClock = std::chrono::high_resolution_clock::now();
+    const Axis& etaAxis = axis(JetColumn::Eta);
+    const Axis& ptAxis  = axis(JetColumn::Pt);
+    const Axis& rhoAxis = axis(JetColumn::Rho);
+    const std::size_t nRow = static_cast<std::size_t>(ptAxis.nBins) * rhoAxis.nBins;
+    const std::size_t nPoints = nRow * etaAxis.nBins;
+
+    // Every version but the reference is compared to the reference; baseKeys with one
+    // version have nothing to compare
+    std::vector<const CorrectionPlanEntry*> entries;
+    struct Comparison {
+        std::size_t entry;   // in entries
+        std::size_t version; // compared to entries[entry]->reference
+    };
+    std::vector<Comparison> comparisons;
+    for (const auto& entry : plan.getEntries()) {
+        if (entry.refs.size() < 2) {
+            std::cout << "[GridScan] Skipping " << entry.baseKey << ": " << entry.refs.size() << " version(s)" << '\n';
+            continue;
+        }
+        for (std::size_t v = 0; v < entry.refs.size(); ++v) {
+            if (v != entry.reference) comparisons.push_back({entries.size(), v});
+        }
+        entries.push_back(&entry);
+    }
+
+    // A run-dependent correction has no meaningful default run: ask for one, and say when
+    // it selects no run category or bin (only the default or flow values are compared)
+    const double runValue = axis(JetColumn::Run).center(0);
+    for (const CorrectionPlanEntry* entry : entries) {
+        for (std::size_t v = 0; v < entry->refs.size(); ++v) {
+            const auto& columns = entry->inputColumns[v];
+            auto itRun = std::find(columns.begin(), columns.end(), JetColumn::Run);
+            if (itRun == columns.end()) continue;
+            if (!runGiven_) {
+                throw std::runtime_error("GridScan: " + entry->baseKey + " depends on the run, give it with run:VALUE");
+            }
+            const std::size_t input = itRun - columns.begin();
+            if (!scaleObject.hasBranchFor(entry->refs[v], input, runValue)) {
+                std::cerr << "Warning: run " << runValue << " is outside every run category of "
+                          << entry->refs[v]->name() << " (" << entry->baseKey << ")" << '\n';
+            }
+        }
+    }
+
+    // [comparison][point], point = (iEta * nPt + iPt) * nRho + iRho; each thread writes whole eta rows
+    std::vector<std::vector<double>> ratios(comparisons.size(), std::vector<double>(nPoints));
+    std::vector<std::vector<double>> diffs(comparisons.size(), std::vector<double>(nPoints));
+    std::atomic<int> nextRow{0};
+    auto worker = [&]() {
+        JetBatch batch;
+        batch.reserve(nRow);
+        BatchBuffers buffers;
+        for (int iEta = nextRow++; iEta < etaAxis.nBins; iEta = nextRow++) {
+            batch.clear();
+            fillRow(iEta, batch);
+            const std::size_t offset = iEta * nRow;
+            std::size_t c = 0;
+            for (std::size_t e = 0; e < entries.size(); ++e) {
+                const CorrectionPlanEntry& entry = *entries[e];
+                RunChannel::evaluateEntry(entry, batch, scaleObject, buffers);
+                const auto& ref = buffers.corrValues[entry.source(entry.reference)];
+                for (; c < comparisons.size() && comparisons[c].entry == e; ++c) {
+                    const auto& value = buffers.corrValues[entry.source(comparisons[c].version)];
+                    for (std::size_t k = 0; k < nRow; ++k) {
+                        ratios[c][offset + k] = ref[k] != 0.0 ? value[k] / ref[k] : 0.0;
+                        diffs[c][offset + k]  = value[k] - ref[k];
+                    }
+                }
+            }
+        }
+    };
+    nThreads = std::max(1, std::min(nThreads, etaAxis.nBins));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    const double evalTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startClock).count();
+    std::cout << "[GridScan] Evaluated " << entries.size() << " baseKeys on " << nPoints << " points with "
+              << nThreads << " threads in " << evalTime << " s" << '\n';
+
+    // Book and fill the maps
+    const std::vector<double> etaEdges = etaAxis.edges();
+    const std::vector<double> ptEdges  = ptAxis.edges();
+    const std::vector<double> rhoEdges = rhoAxis.edges();
+    const bool scanRho = rhoAxis.nBins > 1;
+    const int iRhoRef = rhoAxis.nBins / 2;
+    const std::string rhoRef = Helper::formatNumber(rhoAxis.center(iRhoRef));
+
+    // The directories of each metadata group (one group without prefix for a single file)
+    struct GroupDirs {
+        TDirectory* grid = nullptr;
+        std::vector<TDirectory*> pt, eta;
+    };
+    std::map<std::string, GroupDirs> groupDirs;
+    for (const auto* entry : entries) {
+        if (groupDirs.count(entry->group)) continue;
+        const std::string prefix = entry->group.empty() ? "" : entry->group + "/";
+        GroupDirs& dirs = groupDirs[entry->group];
+        dirs.grid = Helper::createTDirectory(dir, prefix + "GridScan");
+        for (int b = 0; b < HistGivenPt::nCells; ++b) {
+            dirs.pt.push_back(Helper::createTDirectory(dir, prefix + "HistGivenPt/" + HistGivenPt::cellName(b)));
+        }
+        for (int b = 0; b < HistGivenEta::nCells; ++b) {
+            dirs.eta.push_back(Helper::createTDirectory(dir, prefix + "HistGivenEta/" + HistGivenEta::cellName(b)));
+        }
+    }
+
+    for (std::size_t c = 0; c < comparisons.size(); ++c) {
+        const CorrectionPlanEntry& entry = *entries[comparisons[c].entry];
+        const GroupDirs& dirs = groupDirs.at(entry.group);
+        const std::string& baseKey = entry.baseKey;
+        const std::string& label = entry.labels[comparisons[c].version];
+        const std::string& refLabel = entry.labels[entry.reference];
+        const std::string key = MetadataRegistry::comparisonSuffix(entry.labels, comparisons[c].version) +
+                                "_" + safeName(baseKey);
+        const std::vector<double>* values[2] = {&ratios[c], &diffs[c]};
+        const char* kinds[2] = {"Ratio", "Diff"};
+        const std::string labels[2] = {label + "/" + refLabel, label + "-" + refLabel};
+
+        for (int m = 0; m < 2; ++m) {
+            const std::vector<double>& value = *values[m];
+            dirs.grid->cd();
+            auto* h2 = new TH2D(("h2" + std::string(kinds[m]) + key).c_str(),
+                                (baseKey + " : " + labels[m] + " at #rho = " + rhoRef).c_str(),
+                                etaAxis.nBins, etaEdges.data(), ptAxis.nBins, ptEdges.data());
+            h2->GetXaxis()->SetTitle("Jet #eta");
+            h2->GetYaxis()->SetTitle("Jet p_{T} (GeV)");
+            h2->GetZaxis()->SetTitle(labels[m].c_str());
+            TH3D* h3 = nullptr;
+            if (scanRho) {
+                h3 = new TH3D(("h3" + std::string(kinds[m]) + key).c_str(),
+                              (baseKey + " : " + labels[m]).c_str(),
+                              etaAxis.nBins, etaEdges.data(), ptAxis.nBins, ptEdges.data(),
+                              rhoAxis.nBins, rhoEdges.data());
+                h3->GetXaxis()->SetTitle("Jet #eta");
+                h3->GetYaxis()->SetTitle("Jet p_{T} (GeV)");
+                h3->GetZaxis()->SetTitle("#rho");
+            }
+            std::vector<TProfile2D*> givenPt, givenEta;
+            for (int b = 0; b < HistGivenPt::nCells; ++b) {
+                dirs.pt[b]->cd();
+                givenPt.push_back(new TProfile2D(("h2" + std::string(kinds[m]) + key).c_str(),
+                                                 (baseKey + " : " + labels[m] + " vs #eta and #rho").c_str(),
+                                                 etaAxis.nBins, etaEdges.data(), rhoAxis.nBins, rhoEdges.data()));
+                givenPt.back()->GetXaxis()->SetTitle("Jet #eta");
+                givenPt.back()->GetYaxis()->SetTitle("#rho");
+            }
+            for (int b = 0; b < HistGivenEta::nCells; ++b) {
+                dirs.eta[b]->cd();
+                givenEta.push_back(new TProfile2D(("h2" + std::string(kinds[m]) + key).c_str(),
+                                                  (baseKey + " : " + labels[m] + " vs p_{T} and #rho").c_str(),
+                                                  ptAxis.nBins, ptEdges.data(), rhoAxis.nBins, rhoEdges.data()));
+                givenEta.back()->GetXaxis()->SetTitle("Jet p_{T} (GeV)");
+                givenEta.back()->GetYaxis()->SetTitle("#rho");
+            }
+
+            for (int iEta = 0; iEta < etaAxis.nBins; ++iEta) {
+                const double eta = etaAxis.center(iEta);
+                const double absEta = std::abs(eta);
+                const int etaBin = AxisBins<AbsEtaRegionAxis>::find(absEta);
+                for (int iPt = 0; iPt < ptAxis.nBins; ++iPt) {
+                    const double pt = ptAxis.center(iPt);
+                    const int ptBin = AxisBins<PtRegionAxis>::find(pt);
+                    for (int iRho = 0; iRho < rhoAxis.nBins; ++iRho) {
+                        const double rho = rhoAxis.center(iRho);
+                        const double v = value[(static_cast<std::size_t>(iEta) * ptAxis.nBins + iPt) * rhoAxis.nBins + iRho];
+                        if (iRho == iRhoRef) h2->SetBinContent(iEta + 1, iPt + 1, v);
+                        if (h3) h3->SetBinContent(iEta + 1, iPt + 1, iRho + 1, v);
+                        if (ptBin >= 0) givenPt[ptBin]->Fill(eta, rho, v);
+                        if (etaBin >= 0) givenEta[etaBin]->Fill(pt, rho, v);
+                    }
+                }
+            }
+        }
+    }
+    dir->cd();
+    std::cout << "[GridScan] Booked the maps of " << entries.size() << " baseKeys" << '\n';
+}
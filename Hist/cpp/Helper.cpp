@@ -168,3 +168,12 @@ std::string Helper::formatNumber(double num) {
     }
     return formatted;
 }
+
+std::uint64_t Helper::fnv1aHash(const std::string& data) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,167 @@
+#include "HistGiven.h"
+#include "MetadataRegistry.h"
+
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TProfile.h"
+#include "TVectorD.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+auto HistGivenBase::corrAxis(const std::string& baseKey, int nBins) -> FlatAxis {
+    int binN = nBins;
+    double binMin = -0.5;
+    double binMax =  0.5;
+
+    if (baseKey.find("_L1FastJet_") != std::string::npos ||
+        baseKey.find("_L2Relative_") != std::string::npos||
+        baseKey.find("_L3Absolute_") != std::string::npos||
+        baseKey.find("_L2L3Residual_") != std::string::npos){
+        binMin = 0.5;
+        binMax = 1.5;
+    }
+    return FlatAxis(binN, binMin, binMax);
+}
+
+auto HistGivenBase::safeKey(const std::string& baseKey) -> std::string {
+    std::string safe = baseKey;
+    for (auto &c: safe) {
+        if (c == ':') c = '_';
+        if (c == '/') c = '_';
+        if (c == ' ') c = '_';
+    }
+    return safe;
+}
+
+auto HistGivenBase::makeSet(const HistGivenKey& key, const std::vector<double>& profileEdges)
+    -> std::unique_ptr<HistGivenSet> {
+    auto hset = std::make_unique<HistGivenSet>();
+    const bool hasProfile = !profileEdges.empty();
+    for (std::size_t v = 0; v < key.labels.size(); ++v) {
+        HistGivenVersion version;
+        version.hCorr = FlatHist1D(corrAxis(key.baseKey));
+        if (hasProfile) version.pCorr = FlatProfile(FlatAxis(profileEdges));
+        hset->versions.push_back(std::move(version));
+
+        if (v == key.reference) continue;
+        HistGivenComparison comp;
+        comp.version = v;
+        // Coarser, to keep the 2D histogram small
+        comp.h2Corr = FlatHist2D(corrAxis(key.baseKey, 40), corrAxis(key.baseKey, 40));
+        if (hasProfile) {
+            comp.pRatio = FlatProfile(FlatAxis(profileEdges));
+            comp.pDiff = FlatProfile(FlatAxis(profileEdges));
+        }
+        hset->comparisons.push_back(std::move(comp));
+    }
+    return hset;
+}
+
+void HistGivenBase::mergeSet(HistGivenSet& hset, const HistGivenSet& other) {
+    for (std::size_t v = 0; v < hset.versions.size(); ++v) {
+        hset.versions[v].hCorr.add(other.versions[v].hCorr);
+        hset.versions[v].pCorr.add(other.versions[v].pCorr);
+        hset.versions[v].qCorr.merge(other.versions[v].qCorr);
+    }
+    for (std::size_t c = 0; c < hset.comparisons.size(); ++c) {
+        HistGivenComparison& comp = hset.comparisons[c];
+        const HistGivenComparison& otherComp = other.comparisons[c];
+        comp.pRatio.add(otherComp.pRatio);
+        comp.pDiff.add(otherComp.pDiff);
+        comp.h2Corr.add(otherComp.h2Corr);
+        comp.qRatio.merge(otherComp.qRatio);
+        comp.ratio.merge(otherComp.ratio);
+        comp.diff.merge(otherComp.diff);
+    }
+}
+
+// The sums of the Summary row of comp, in ComparisonSummary order
+static std::array<double, ComparisonSummary::nSums> summarySums(const HistGivenComparison& comp) {
+    return {comp.ratio.n, comp.ratio.sum, comp.ratio.sum2, comp.diff.n, comp.diff.sum, comp.diff.sum2};
+}
+
+// The sketch as a TVectorD in the current directory
+static void writeSketch(const QuantileSketch& sketch, const std::string& name) {
+    const std::vector<double> data = sketch.toVector();
+    TVectorD vec(static_cast<int>(data.size()));
+    std::copy(data.begin(), data.end(), vec.GetMatrixArray());
+    gDirectory->WriteObject(&vec, name.c_str());
+}
+
+void HistGivenBase::saveSet(const HistGivenSet& hset, const HistGivenKey& key,
+                            const char* profileSymbol, const char* profileTitle) {
+    const std::string& baseKey = key.baseKey;
+    const std::string safe = safeKey(baseKey);
+
+    for (std::size_t v = 0; v < hset.versions.size(); ++v) {
+        const HistGivenVersion& version = hset.versions[v];
+        const std::string& label = key.labels[v];
+
+        TH1D* hCorr = version.hCorr.toTH1D("hCorr" + label + "_" + safe, baseKey + " : " + label + " Correction Factor");
+        hCorr->GetXaxis()->SetTitle(("Correction Factor (" + label + ")").c_str());
+        hCorr->GetYaxis()->SetTitle("Events");
+
+        // The sketches, for the quantiles of the values outside the histogram range too
+        writeSketch(version.qCorr, "qCorr" + label + "_" + safe);
+
+        if (!profileSymbol) continue;
+        TProfile* pCorr = version.pCorr.toTProfile("pCorr" + label + "_" + safe,
+                                                   baseKey + " : Corr" + label + " vs " + profileSymbol);
+        pCorr->GetXaxis()->SetTitle(profileTitle);
+        pCorr->GetYaxis()->SetTitle(("Mean of Corr" + label).c_str());
+    }
+
+    const std::string& refLabel = key.labels[key.reference];
+    for (const auto& comp : hset.comparisons) {
+        const std::string& label = key.labels[comp.version];
+        const std::string suffix = MetadataRegistry::comparisonSuffix(key.labels, comp.version) + "_" + safe;
+        const std::string ratioName = label + "/" + refLabel;
+        const std::string diffName = label + "-" + refLabel;
+
+        TH2D* h2Corr = comp.h2Corr.toTH2D("h2Corr" + suffix, baseKey + " : " + label + " vs " + refLabel);
+        h2Corr->GetXaxis()->SetTitle(("Correction Factor (" + refLabel + ")").c_str());
+        h2Corr->GetYaxis()->SetTitle(("Correction Factor (" + label + ")").c_str());
+
+        writeSketch(comp.qRatio, "qRatio" + suffix);
+
+        // The sums of the Summary tree, added by OutputMerger
+        const auto sums = summarySums(comp);
+        TVectorD stats(ComparisonSummary::nSums, sums.data());
+        gDirectory->WriteObject(&stats, statsName(key, comp.version).c_str());
+
+        if (!profileSymbol) continue;
+        TProfile* pRatio = comp.pRatio.toTProfile("pRatio" + suffix, baseKey + " : " + ratioName + " vs " + profileSymbol);
+        pRatio->GetXaxis()->SetTitle(profileTitle);
+        pRatio->GetYaxis()->SetTitle(("Mean of " + ratioName).c_str());
+
+        TProfile* pDiff = comp.pDiff.toTProfile("pDiff" + suffix, baseKey + " : " + diffName + " vs " + profileSymbol);
+        pDiff->GetXaxis()->SetTitle(profileTitle);
+        pDiff->GetYaxis()->SetTitle(("Mean of " + diffName).c_str());
+    }
+}
+
+auto HistGivenBase::statsName(const HistGivenKey& key, std::size_t version) -> std::string {
+    return "sStats" + MetadataRegistry::comparisonSuffix(key.labels, version) + "_" + safeKey(key.baseKey);
+}
+
+auto HistGivenBase::summaryRow(const HistGivenComparison& comp, bool hasProfile) -> ComparisonSummary::Row {
+    ComparisonSummary::Row row;
+    ComparisonSummary::setSums(row, summarySums(comp).data());
+    row.maxDevX = std::nan("");
+    row.maxDevRatio = std::nan("");
+    if (!hasProfile) return row;
+
+    double maxDev = -1.0;
+    for (int bin = 1; bin <= comp.pRatio.getAxis().getNBins(); ++bin) {
+        if (comp.pRatio.getBinEntries(bin) <= 0) continue;
+        const double dev = std::abs(comp.pRatio.getBinMean(bin) - 1.0);
+        if (dev > maxDev) {
+            maxDev = dev;
+            row.maxDevX = comp.pRatio.getAxis().getBinCenter(bin);
+            row.maxDevRatio = comp.pRatio.getBinMean(bin);
+        }
+    }
+    return row;
+}
@@ -0,0 +1,71 @@
+#include "InputBranchMap.h"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "nlohmann/json.hpp"
+
+namespace {
+
+JetColumn columnFromName(const std::string& name) {
+    if (name == "Area") return JetColumn::Area;
+    if (name == "Eta")  return JetColumn::Eta;
+    if (name == "Phi")  return JetColumn::Phi;
+    if (name == "Pt")   return JetColumn::Pt;
+    if (name == "Rho")  return JetColumn::Rho;
+    if (name == "Run")  return JetColumn::Run;
+    throw std::runtime_error("InputBranchMap: unknown column '" + name + "' (use Area, Eta, Phi, Pt, Rho or Run)");
+}
+
+// The branch SkimTree reads into each column; the batch is filled from these only
+const char* branchOfColumn(JetColumn column) {
+    switch (column) {
+        case JetColumn::Area: return "Jet_area";
+        case JetColumn::Eta:  return "Jet_eta";
+        case JetColumn::Phi:  return "Jet_phi";
+        case JetColumn::Pt:   return "Jet_pt";
+        case JetColumn::Rho:  return "Rho";
+        case JetColumn::Run:  return "run";
+    }
+    return "";
+}
+
+} // namespace
+
+InputBranchMap::InputBranchMap(const std::string& jsonPath) : jsonPath_(jsonPath) {
+    std::ifstream inFile(jsonPath_);
+    if (!inFile.is_open()) {
+        throw std::runtime_error("InputBranchMap: Unable to open " + jsonPath_);
+    }
+    nlohmann::json js;
+    inFile >> js;
+    for (auto it = js.begin(); it != js.end(); ++it) {
+        Entry entry;
+        entry.column = columnFromName(it.value().at("column").get<std::string>());
+        entry.branch = it.value().at("branch").get<std::string>();
+        const std::string expected = branchOfColumn(entry.column);
+        if (entry.branch != expected) {
+            throw std::runtime_error("InputBranchMap: input '" + it.key() + "' reads branch '" + entry.branch +
+                                     "', but column " + it.value().at("column").get<std::string>() +
+                                     " is filled from '" + expected + "' in " + jsonPath_);
+        }
+        entries_.emplace(it.key(), entry);
+    }
+    std::cout << "+ InputBranchMap: " << entries_.size() << " inputs from " << jsonPath_ << '\n';
+}
+
+auto InputBranchMap::at(const std::string& inputName) const -> const Entry& {
+    auto it = entries_.find(inputName);
+    if (it == entries_.end()) {
+        throw std::runtime_error("InputBranchMap: correction input '" + inputName + "' is not in " + jsonPath_);
+    }
+    return it->second;
+}
+
+auto InputBranchMap::getColumn(const std::string& inputName) const -> JetColumn {
+    return at(inputName).column;
+}
+
+auto InputBranchMap::getBranch(const std::string& inputName) const -> const std::string& {
+    return at(inputName).branch;
+}
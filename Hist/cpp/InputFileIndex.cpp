@@ -0,0 +1,187 @@
+#include "InputFileIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TSystem.h>
+
+#include "nlohmann/json.hpp"
+
+InputFileIndex::InputFileIndex(std::string cachePath, int nOpeners)
+    : cachePath_(std::move(cachePath)), freeOpeners_(std::max(1, nOpeners)) {
+    load();
+}
+
+void InputFileIndex::load() {
+    std::ifstream in(cachePath_);
+    if (!in.is_open()) return;
+    try {
+        nlohmann::json js = nlohmann::json::parse(in);
+        for (const auto& item : js.at("files")) {
+            InputFileInfo info;
+            info.path    = item.at("path").get<std::string>();
+            info.size    = item.at("size").get<Long64_t>();
+            info.mtime   = item.at("mtime").get<Long_t>();
+            info.entries = item.at("entries").get<Long64_t>();
+            info.valid   = item.at("valid").get<bool>();
+            cached_[info.path] = info;
+        }
+        std::cout << "+ Loaded " << cached_.size() << " cached file checks from " << cachePath_ << '\n';
+    } catch (const std::exception& e) {
+        // A broken cache only costs a revalidation
+        std::cerr << "Warning: ignoring input file cache " << cachePath_ << ": " << e.what() << '\n';
+        cached_.clear();
+    }
+}
+
+auto InputFileIndex::find(const std::string& path) const -> std::optional<InputFileInfo> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cached_.find(path);
+    if (it == cached_.end()) return std::nullopt;
+    return it->second;
+}
+
+auto InputFileIndex::inspect(const std::string& path) const -> InputFileInfo {
+    InputFileInfo info;
+    info.path = path;
+    {
+        // Already checked by this process (e.g. a file shared by two slices): no stat
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cached_.find(path);
+        if (it != cached_.end() && checkedHere_.count(path)) {
+            info = it->second;
+            if (!info.valid) info.error = "invalid (cached)";
+            return info;
+        }
+    }
+
+    // One of the opener slots of this index, shared by all the concurrent validate() calls
+    std::unique_lock<std::mutex> slotLock(mutex_);
+    openerFreed_.wait(slotLock, [this]() { return freeOpeners_ > 0; });
+    --freeOpeners_;
+    slotLock.unlock();
+    struct SlotRelease {
+        const InputFileIndex& index;
+        ~SlotRelease() {
+            {
+                std::lock_guard<std::mutex> lock(index.mutex_);
+                ++index.freeOpeners_;
+            }
+            index.openerFreed_.notify_one();
+        }
+    } release{*this};
+
+    // A stat (also for root:// URLs) is much cheaper than opening the file
+    FileStat_t stat{};
+    if (gSystem->GetPathInfo(path.c_str(), stat) == 0) {
+        info.size = stat.fSize;
+        info.mtime = stat.fMtime;
+        const std::optional<InputFileInfo> cached = find(path);
+        if (cached && cached->size == info.size && cached->mtime == info.mtime) {
+            info.entries = cached->entries;
+            info.valid = cached->valid;
+            if (!info.valid) info.error = "invalid (cached)";
+            return info;
+        }
+    }
+
+    std::unique_ptr<TFile> f(TFile::Open(path.c_str(), "READ"));
+    if (!f || f->IsZombie()) {
+        info.size = -1; // not cached: may be a transient error
+        info.error = "Failed to open or corrupted file";
+        return info;
+    }
+    if (info.size < 0) info.size = f->GetSize();
+    auto* tree = f->Get<TTree>("Events");
+    if (!tree) {
+        info.error = "'Events' not found";
+    } else {
+        info.entries = tree->GetEntries();
+        info.valid = info.entries > 0;
+        if (!info.valid) info.error = "'Events' TTree has 0 entries";
+    }
+    f->Close();
+    return info;
+}
+
+auto InputFileIndex::validate(const std::vector<std::string>& paths, int nWorkers) -> std::vector<InputFileInfo> {
+    std::vector<InputFileInfo> results(paths.size());
+    nWorkers = std::max(1, std::min<int>(nWorkers, static_cast<int>(paths.size())));
+    std::atomic<std::size_t> next{0};
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < paths.size(); i = next++) {
+            results[i] = inspect(paths[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int w = 0; w < nWorkers; ++w) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& info : results) {
+        if (info.size < 0) continue;
+        cached_[info.path] = info;
+        checkedHere_.insert(info.path);
+    }
+    return results;
+}
+
+void InputFileIndex::save() const {
+    std::error_code ec;
+    const auto parent = std::filesystem::path(cachePath_).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+
+    // Read, merge and rename under an exclusive lock: other jobs (processes, or
+    // threads with their own descriptor) wait instead of dropping each other's files
+    const std::string lockPath = cachePath_ + ".lock";
+    const int lockFd = ::open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lockFd < 0 || ::flock(lockFd, LOCK_EX) != 0) {
+        std::cerr << "Warning: cannot lock input file cache " << lockPath << ", not saved" << '\n';
+        if (lockFd >= 0) ::close(lockFd);
+        return;
+    }
+
+    // Merge with the current file, other jobs may have added files meanwhile
+    InputFileIndex onDisk(cachePath_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [path, info] : cached_) {
+            onDisk.cached_[path] = info;
+        }
+    }
+
+    nlohmann::json files = nlohmann::json::array();
+    for (const auto& [path, info] : onDisk.cached_) {
+        files.push_back({{"path", path}, {"size", info.size}, {"mtime", info.mtime},
+                         {"entries", info.entries}, {"valid", info.valid}});
+    }
+
+    // Unique per process and thread, so that a reader never sees a partial file
+    const std::string tmpPath = cachePath_ + ".tmp" + std::to_string(::getpid()) + "_" +
+                                std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmpPath);
+        if (out) out << nlohmann::json{{"files", files}}.dump(1) << '\n';
+        if (!out) std::cerr << "Warning: cannot write input file cache " << tmpPath << '\n';
+    }
+    if (std::rename(tmpPath.c_str(), cachePath_.c_str()) != 0) std::remove(tmpPath.c_str());
+    ::flock(lockFd, LOCK_UN);
+    ::close(lockFd);
+}
@@ -0,0 +1,245 @@
+#include "JetColumnCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+const char headerMagic[8] = {'J', 'E', 'T', 'C', 'A', 'C', 'H', '1'};
+const char footerMagic[8] = {'J', 'E', 'T', 'C', 'E', 'N', 'D', '1'};
+// nBlocks, nEvents, sourceHash and the magic
+constexpr std::size_t footerSize = 3 * sizeof(std::uint64_t) + sizeof(footerMagic);
+
+std::size_t padded(std::size_t nBytes) {
+    return (nBytes + 7) & ~static_cast<std::size_t>(7);
+}
+} // namespace
+
+//------------------------------------
+// Writer
+//------------------------------------
+JetColumnCache::Writer::Writer(const std::string& path, std::uint64_t sourceHash)
+    : path_(path), sourceHash_(sourceHash), out_(path + ".tmp", std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+        throw std::runtime_error("Error: cannot write jet cache " + path_ + ".tmp");
+    }
+    out_.write(headerMagic, sizeof(headerMagic));
+    jetOffset_.push_back(0);
+}
+
+JetColumnCache::Writer::~Writer() {
+    if (!closed_) {
+        // Interrupted: never leave a partial cache behind
+        out_.close();
+        std::remove((path_ + ".tmp").c_str());
+    }
+}
+
+void JetColumnCache::Writer::fill(UInt_t run, UInt_t luminosityBlock, ULong64_t event, Float_t rho, UInt_t nJet,
+                                  const Float_t* pt, const Float_t* eta, const Float_t* phi, const Float_t* mass,
+                                  const Float_t* area, const Float_t* rawFactor, const UChar_t* jetId) {
+    run_.push_back(run);
+    luminosityBlock_.push_back(luminosityBlock);
+    event_.push_back(event);
+    rho_.push_back(rho);
+    pt_.insert(pt_.end(), pt, pt + nJet);
+    eta_.insert(eta_.end(), eta, eta + nJet);
+    phi_.insert(phi_.end(), phi, phi + nJet);
+    mass_.insert(mass_.end(), mass, mass + nJet);
+    area_.insert(area_.end(), area, area + nJet);
+    rawFactor_.insert(rawFactor_.end(), rawFactor, rawFactor + nJet);
+    jetId_.insert(jetId_.end(), jetId, jetId + nJet);
+    jetOffset_.push_back(static_cast<UInt_t>(pt_.size()));
+    ++nEvents_;
+    if (run_.size() == blockEvents) flushBlock();
+}
+
+template <typename T>
+void JetColumnCache::Writer::writeColumn(const std::vector<T>& column) {
+    const std::size_t nBytes = column.size() * sizeof(T);
+    out_.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(nBytes));
+    static const char zeros[8] = {};
+    out_.write(zeros, static_cast<std::streamsize>(padded(nBytes) - nBytes));
+}
+
+void JetColumnCache::Writer::flushBlock() {
+    if (run_.empty()) return;
+    blockOffsets_.push_back(static_cast<std::uint64_t>(out_.tellp()));
+    const std::uint64_t counts[2] = {run_.size(), pt_.size()};
+    out_.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+    writeColumn(run_);
+    writeColumn(luminosityBlock_);
+    writeColumn(event_);
+    writeColumn(rho_);
+    writeColumn(jetOffset_);
+    writeColumn(pt_);
+    writeColumn(eta_);
+    writeColumn(phi_);
+    writeColumn(mass_);
+    writeColumn(area_);
+    writeColumn(rawFactor_);
+    writeColumn(jetId_);
+
+    run_.clear(); luminosityBlock_.clear(); event_.clear(); rho_.clear();
+    pt_.clear(); eta_.clear(); phi_.clear(); mass_.clear(); area_.clear(); rawFactor_.clear(); jetId_.clear();
+    jetOffset_.assign(1, 0);
+}
+
+void JetColumnCache::Writer::close() {
+    if (closed_) return;
+    flushBlock();
+    writeColumn(blockOffsets_);
+    const std::uint64_t footer[3] = {blockOffsets_.size(), nEvents_, sourceHash_};
+    out_.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+    out_.write(footerMagic, sizeof(footerMagic));
+    out_.close();
+    if (!out_ || std::rename((path_ + ".tmp").c_str(), path_.c_str()) != 0) {
+        throw std::runtime_error("Error: failed to write jet cache " + path_);
+    }
+    closed_ = true;
+    std::cout << "+ Jet cache " << path_ << " written with " << nEvents_ << " events in "
+              << blockOffsets_.size() << " blocks" << '\n';
+}
+
+//------------------------------------
+// Reader
+//------------------------------------
+bool JetColumnCache::isUsable(const std::string& path, std::uint64_t sourceHash) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in || in.tellg() < static_cast<std::streamoff>(sizeof(headerMagic) + footerSize)) return false;
+    in.seekg(-static_cast<std::streamoff>(footerSize), std::ios::end);
+    std::uint64_t footer[3];
+    char magic[sizeof(footerMagic)];
+    in.read(reinterpret_cast<char*>(footer), sizeof(footer));
+    in.read(magic, sizeof(magic));
+    return in && std::memcmp(magic, footerMagic, sizeof(magic)) == 0 && footer[2] == sourceHash;
+}
+
+JetColumnCache::JetColumnCache(const std::string& path) : path_(path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Error: cannot open jet cache " + path);
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(headerMagic) + footerSize) {
+        ::close(fd);
+        throw std::runtime_error("Error: jet cache " + path + " is too small");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        throw std::runtime_error("Error: cannot map jet cache " + path);
+    }
+
+    // Every offset and count comes from the file: check each against the mapped size
+    // before reading through it, so a truncated or foreign file is reported, not read
+    const char* base = static_cast<const char*>(data_);
+    const std::size_t footerStart = size_ - footerSize;
+    auto fail = [&]() {
+        munmap(data_, size_);
+        data_ = nullptr;
+        throw std::runtime_error("Error: jet cache " + path + " is incomplete, delete it to rebuild");
+    };
+    std::uint64_t counts[3];
+    std::memcpy(counts, base + footerStart, sizeof(counts));
+    if (std::memcmp(base, headerMagic, sizeof(headerMagic)) != 0 ||
+        std::memcmp(base + footerStart + sizeof(counts), footerMagic, sizeof(footerMagic)) != 0 ||
+        counts[0] > (footerStart - sizeof(headerMagic)) / sizeof(std::uint64_t)) {
+        fail();
+    }
+    const std::uint64_t nBlocks = counts[0];
+    nEvents_ = static_cast<Long64_t>(counts[1]);
+    sourceHash_ = counts[2];
+
+    // The blocks lie between the header and the table of block offsets
+    const std::size_t tableStart = footerStart - nBlocks * sizeof(std::uint64_t);
+    Long64_t firstEvent = 0;
+    for (std::uint64_t b = 0; b < nBlocks; ++b) {
+        std::uint64_t offset = 0;
+        std::memcpy(&offset, base + tableStart + b * sizeof(std::uint64_t), sizeof(offset));
+        std::uint64_t blockCounts[2];
+        if (offset < sizeof(headerMagic) || offset > tableStart || tableStart - offset < sizeof(blockCounts)) fail();
+        std::memcpy(blockCounts, base + offset, sizeof(blockCounts));
+        std::size_t pos = offset + sizeof(blockCounts);
+        // Bounds the counts first, so that the column sizes below cannot overflow
+        if (blockCounts[0] > tableStart || blockCounts[1] > tableStart) fail();
+        const std::size_t nE = blockCounts[0];
+        const std::size_t nJ = blockCounts[1];
+        auto take = [&](std::size_t nBytes) {
+            if (padded(nBytes) > tableStart - pos) fail();
+            const char* column = base + pos;
+            pos += padded(nBytes);
+            return column;
+        };
+        Block block{};
+        block.firstEvent      = firstEvent;
+        block.nEvents         = static_cast<Long64_t>(nE);
+        block.run             = reinterpret_cast<const UInt_t*>(take(nE * sizeof(UInt_t)));
+        block.luminosityBlock = reinterpret_cast<const UInt_t*>(take(nE * sizeof(UInt_t)));
+        block.event           = reinterpret_cast<const ULong64_t*>(take(nE * sizeof(ULong64_t)));
+        block.rho             = reinterpret_cast<const Float_t*>(take(nE * sizeof(Float_t)));
+        block.jetOffset       = reinterpret_cast<const UInt_t*>(take((nE + 1) * sizeof(UInt_t)));
+        block.pt              = reinterpret_cast<const Float_t*>(take(nJ * sizeof(Float_t)));
+        block.eta             = reinterpret_cast<const Float_t*>(take(nJ * sizeof(Float_t)));
+        block.phi             = reinterpret_cast<const Float_t*>(take(nJ * sizeof(Float_t)));
+        block.mass            = reinterpret_cast<const Float_t*>(take(nJ * sizeof(Float_t)));
+        block.area            = reinterpret_cast<const Float_t*>(take(nJ * sizeof(Float_t)));
+        block.rawFactor       = reinterpret_cast<const Float_t*>(take(nJ * sizeof(Float_t)));
+        block.jetId           = reinterpret_cast<const UChar_t*>(take(nJ * sizeof(UChar_t)));
+        // getEvent() indexes the jet columns with the offsets: they must stay within nJ
+        if (block.jetOffset[0] != 0 || block.jetOffset[nE] != nJ) fail();
+        for (std::size_t i = 0; i < nE; ++i) {
+            if (block.jetOffset[i + 1] < block.jetOffset[i]) fail();
+        }
+        blocks_.push_back(block);
+        firstEvent += block.nEvents;
+    }
+    if (firstEvent != nEvents_) fail();
+    std::cout << "+ Jet cache " << path_ << " mapped: " << nEvents_ << " events in " << nBlocks << " blocks" << '\n';
+}
+
+JetColumnCache::~JetColumnCache() {
+    if (data_) munmap(data_, size_);
+}
+
+auto JetColumnCache::getBlockStarts() const -> std::vector<Long64_t> {
+    std::vector<Long64_t> starts;
+    for (const Block& block : blocks_) starts.push_back(block.firstEvent);
+    starts.push_back(nEvents_);
+    return starts;
+}
+
+auto JetColumnCache::getEvent(Long64_t entry) const -> EventView {
+    if (entry < 0 || entry >= nEvents_) {
+        throw std::runtime_error("Error: entry " + std::to_string(entry) + " out of range in jet cache " + path_);
+    }
+    auto it = std::upper_bound(blocks_.begin(), blocks_.end(), entry,
+                               [](Long64_t e, const Block& block) { return e < block.firstEvent; });
+    const Block& block = *(it - 1);
+    const Long64_t i = entry - block.firstEvent;
+    const UInt_t first = block.jetOffset[i];
+
+    EventView view{};
+    view.run             = block.run[i];
+    view.luminosityBlock = block.luminosityBlock[i];
+    view.event           = block.event[i];
+    view.rho             = block.rho[i];
+    view.nJet            = block.jetOffset[i + 1] - first;
+    view.pt              = block.pt + first;
+    view.eta             = block.eta + first;
+    view.phi             = block.phi + first;
+    view.mass            = block.mass + first;
+    view.area            = block.area + first;
+    view.rawFactor       = block.rawFactor + first;
+    view.jetId           = block.jetId + first;
+    return view;
+}
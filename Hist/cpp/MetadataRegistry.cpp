@@ -0,0 +1,239 @@
+#include "MetadataRegistry.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <stdexcept>
+
+#include "ScaleObject.h"
+#include "nlohmann/json.hpp"
+
+MetadataRegistry::MetadataRegistry(const std::string& metadataJsonPath)
+    : MetadataRegistry(std::vector<std::string>{metadataJsonPath}) {
+}
+
+MetadataRegistry::MetadataRegistry(const std::vector<std::string>& metadataJsonPaths) {
+    if (metadataJsonPaths.empty()) {
+        throw std::runtime_error("MetadataRegistry: no metadata JSON given");
+    }
+    for (const auto& path : metadataJsonPaths) {
+        // With several files, each is a group named after the file
+        std::string group;
+        if (metadataJsonPaths.size() > 1) {
+            group = std::filesystem::path(path).stem().string();
+            if (std::find(groups_.begin(), groups_.end(), group) != groups_.end()) {
+                throw std::runtime_error("MetadataRegistry: two metadata files are named " + group +
+                                         ", their output directories would be the same");
+            }
+        }
+        groups_.push_back(group);
+        if (!metadataJsonPath_.empty()) metadataJsonPath_ += ",";
+        metadataJsonPath_ += path;
+        read(path, group);
+    }
+}
+
+void MetadataRegistry::read(const std::string& metadataJsonPath, const std::string& group) {
+    std::ifstream inFile(metadataJsonPath);
+    if (!inFile.is_open()) {
+        throw std::runtime_error("MetadataRegistry: Unable to open metadata JSON: " + metadataJsonPath);
+    }
+    nlohmann::json meta;
+    try {
+        inFile >> meta;
+    } catch (const std::exception& e) {
+        throw std::runtime_error("MetadataRegistry: Cannot parse " + metadataJsonPath + ": " + e.what());
+    }
+
+    const std::size_t nBefore = entries_.size();
+    for (auto it = meta.begin(); it != meta.end(); ++it) {
+        MetadataEntry entry;
+        entry.id      = static_cast<int>(entries_.size());
+        entry.baseKey = it.key();
+        entry.group   = group;
+        entry.level   = levelFromKey(entry.baseKey);
+
+        // For each version of the correction (each [jsonFile, tag] pair)
+        for (const auto& version : it.value()) {
+            if (version.size() < 2) continue; // Skip invalid entries.
+            if (!version.at(0).is_string() || !version.at(1).is_string()) {
+                std::cerr << "Warning: skipping version without jsonFile/tag for baseKey '"
+                          << entry.baseKey << "'\n";
+                continue;
+            }
+            std::string label;
+            if (version.size() > 2 && version.at(2).is_string()) label = version.at(2).get<std::string>();
+            entry.versions.push_back({version.at(0).get<std::string>(), version.at(1).get<std::string>(), label});
+        }
+        // Nothing to compare, and no reference to divide by
+        if (entry.versions.empty()) {
+            throw std::runtime_error("MetadataRegistry: baseKey '" + entry.baseKey + "' in " + metadataJsonPath +
+                                     " has no valid [jsonFile, tag] version");
+        }
+        assignLabels(entry);
+        entries_.push_back(std::move(entry));
+    }
+    std::cout << "[MetadataRegistry] Read " << entries_.size() - nBefore << " baseKeys from " << metadataJsonPath
+              << (group.empty() ? "" : " into " + group) << '\n';
+}
+
+void MetadataRegistry::filter(const std::string& include, const std::string& exclude) {
+    if (include.empty() && exclude.empty()) return;
+    std::regex includeRegex, excludeRegex;
+    try {
+        if (!include.empty()) includeRegex = std::regex(include);
+        if (!exclude.empty()) excludeRegex = std::regex(exclude);
+    } catch (const std::regex_error& e) {
+        throw std::runtime_error("MetadataRegistry: invalid regular expression: " + std::string(e.what()));
+    }
+
+    std::vector<MetadataEntry> kept;
+    for (auto& entry : entries_) {
+        if (!include.empty() && !std::regex_search(entry.baseKey, includeRegex)) continue;
+        if (!exclude.empty() && std::regex_search(entry.baseKey, excludeRegex)) continue;
+        entry.id = static_cast<int>(kept.size());
+        kept.push_back(std::move(entry));
+    }
+    nFiltered_ += entries_.size() - kept.size();
+    entries_ = std::move(kept);
+    std::cout << "[MetadataRegistry] Kept " << entries_.size() << " baseKeys (include '" << include
+              << "', exclude '" << exclude << "')" << '\n';
+    if (entries_.empty()) {
+        throw std::runtime_error("MetadataRegistry: no baseKey of " + metadataJsonPath_ + " passes the filters");
+    }
+}
+
+void MetadataRegistry::assignLabels(MetadataEntry& entry) {
+    const std::size_t nVersions = entry.versions.size();
+    // Two unlabeled versions keep the names of the files without labels
+    const bool oldNew = nVersions == 2 && entry.versions[0].label.empty() && entry.versions[1].label.empty();
+    for (std::size_t v = 0; v < nVersions; ++v) {
+        std::string& label = entry.versions[v].label;
+        if (label.empty()) label = oldNew ? (v == 0 ? "Old" : "New") : "V" + std::to_string(v + 1);
+        if (!std::all_of(label.begin(), label.end(), [](unsigned char c) { return std::isalnum(c); })) {
+            throw std::runtime_error("MetadataRegistry: label '" + label + "' of baseKey '" + entry.baseKey +
+                                     "' must only have letters and digits");
+        }
+        for (std::size_t u = 0; u < v; ++u) {
+            if (entry.versions[u].label == label) {
+                throw std::runtime_error("MetadataRegistry: label '" + label + "' is used twice in baseKey '" +
+                                         entry.baseKey + "'");
+            }
+        }
+    }
+}
+
+void MetadataRegistry::setReference(const std::string& label) {
+    if (label.empty()) return;
+    std::size_t nFound = 0;
+    for (auto& entry : entries_) {
+        entry.reference = 0;
+        for (std::size_t v = 0; v < entry.versions.size(); ++v) {
+            if (entry.versions[v].label == label) {
+                entry.reference = v;
+                nFound++;
+            }
+        }
+    }
+    std::cout << "[MetadataRegistry] Reference version '" << label << "' in " << nFound << " of "
+              << entries_.size() << " baseKeys, the first version in the others" << '\n';
+}
+
+void MetadataRegistry::validate(const ScaleObject& scaleObject) const {
+    std::vector<std::string> missing;
+    for (const auto& entry : entries_) {
+        for (const auto& version : entry.versions) {
+            try {
+                scaleObject.getCorrectionRef(version.jsonFile, version.tag);
+            } catch (const std::exception& e) {
+                missing.push_back(entry.baseKey + ": " + version.jsonFile + " [" + version.tag + "]: " + e.what());
+            }
+        }
+    }
+    if (missing.empty()) return;
+    std::string message = "MetadataRegistry: " + std::to_string(missing.size()) +
+                          " corrections of " + metadataJsonPath_ + " cannot be loaded:";
+    for (const auto& line : missing) {
+        message += "\n  " + line;
+    }
+    throw std::runtime_error(message);
+}
+
+auto MetadataRegistry::getBaseKeys() const -> std::vector<std::string> {
+    std::vector<std::string> baseKeys;
+    baseKeys.reserve(entries_.size());
+    for (const auto& entry : entries_) {
+        baseKeys.push_back(entry.baseKey);
+    }
+    return baseKeys;
+}
+
+auto MetadataRegistry::getSources() const -> std::vector<CorrectionImage::Source> {
+    std::vector<CorrectionImage::Source> sources;
+    for (const auto& entry : entries_) {
+        for (const auto& version : entry.versions) {
+            auto it = std::find_if(sources.begin(), sources.end(), [&version](const CorrectionImage::Source& s) {
+                return s.jsonFile == version.jsonFile;
+            });
+            if (it == sources.end()) it = sources.insert(sources.end(), {version.jsonFile, {}});
+            if (std::find(it->tags.begin(), it->tags.end(), version.tag) == it->tags.end()) {
+                it->tags.push_back(version.tag);
+            }
+        }
+    }
+    return sources;
+}
+
+auto MetadataEntry::getLabels() const -> std::vector<std::string> {
+    std::vector<std::string> labels;
+    labels.reserve(versions.size());
+    for (const auto& version : versions) {
+        labels.push_back(version.label);
+    }
+    return labels;
+}
+
+auto MetadataRegistry::comparisonSuffix(const std::vector<std::string>& labels, std::size_t v) -> std::string {
+    return labels.size() == 2 ? std::string() : labels[v];
+}
+
+auto MetadataRegistry::levelFromKey(const std::string& baseKey) -> CorrectionLevel {
+    if (baseKey.find("_ScaleFactor_")  != std::string::npos) return CorrectionLevel::ScaleFactor;
+    if (baseKey.find("_L1FastJet_")    != std::string::npos) return CorrectionLevel::L1FastJet;
+    if (baseKey.find("_L2Relative_")   != std::string::npos) return CorrectionLevel::L2Relative;
+    if (baseKey.find("_L3Absolute_")   != std::string::npos) return CorrectionLevel::L3Absolute;
+    if (baseKey.find("_L2L3Residual_") != std::string::npos) return CorrectionLevel::L2L3Residual;
+    if (baseKey.find("_PtResolution_") != std::string::npos) return CorrectionLevel::PtResolution;
+    return CorrectionLevel::Other;
+}
+
+auto MetadataRegistry::levelName(CorrectionLevel level) -> const char* {
+    switch (level) {
+        case CorrectionLevel::L1FastJet:    return "L1FastJet";
+        case CorrectionLevel::L2Relative:   return "L2Relative";
+        case CorrectionLevel::L3Absolute:   return "L3Absolute";
+        case CorrectionLevel::L2L3Residual: return "L2L3Residual";
+        case CorrectionLevel::PtResolution: return "PtResolution";
+        case CorrectionLevel::ScaleFactor:  return "ScaleFactor";
+        default:                            return "Other";
+    }
+}
+
+void MetadataRegistry::print() const {
+    for (const auto& entry : entries_) {
+        std::cout << std::setw(4) << entry.id << "  "
+                  << std::setw(14) << levelName(entry.level) << "  "
+                  << (entry.group.empty() ? "" : entry.group + "/") << entry.baseKey << "  (" << entry.versions.size() << " versions:";
+        for (std::size_t v = 0; v < entry.versions.size(); ++v) {
+            std::cout << ' ' << entry.versions[v].label << (v == entry.reference ? "*" : "");
+        }
+        std::cout << ")" << '\n';
+    }
+    if (nFiltered_ > 0) {
+        std::cout << "      (" << nFiltered_ << " baseKeys filtered out)" << '\n';
+    }
+}
@@ -0,0 +1,152 @@
+#include "OutputMerger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TProfile.h"
+#include "TTree.h"
+#include "TVectorD.h"
+
+#include "Helper.h"
+
+OutputMerger::~OutputMerger() = default;
+
+auto OutputMerger::getItem(const std::string& dir, const std::string& name, bool& isNew) -> Item& {
+    const std::string path = dir + "/" + name;
+    auto it = index_.find(path);
+    isNew = (it == index_.end());
+    if (isNew) {
+        it = index_.emplace(path, items_.size()).first;
+        items_.push_back(Item{dir, name, nullptr, nullptr, {}});
+    }
+    return items_[it->second];
+}
+
+auto OutputMerger::add(const std::string& path) -> bool {
+    std::unique_ptr<TFile> fin(TFile::Open(path.c_str(), "READ"));
+    if (!fin || fin->IsZombie()) {
+        std::cerr << "Error: cannot open " << path << '\n';
+        return false;
+    }
+    readDirectory(fin.get(), "");
+    std::cout << "[OutputMerger] Added " << path << '\n';
+    return true;
+}
+
+void OutputMerger::readDirectory(TDirectory* dir, const std::string& path) {
+    TIter next(dir->GetListOfKeys());
+    TKey* key = nullptr;
+    std::string lastName;
+    while ((key = dynamic_cast<TKey*>(next()))) {
+        // Only the highest cycle of each name, which comes first
+        const std::string name = key->GetName();
+        if (name == lastName) continue;
+        lastName = name;
+
+        if (TDirectory* subDir = dir->GetDirectory(name.c_str())) {
+            readDirectory(subDir, path.empty() ? name : path + "/" + name);
+            continue;
+        }
+        std::unique_ptr<TObject> obj(key->ReadObj());
+        bool isNew = false;
+        if (auto* hist = dynamic_cast<TH1*>(obj.get())) {
+            hist->SetDirectory(nullptr);
+            Item& item = getItem(path, name, isNew);
+            if (isNew) {
+                obj.release();
+                item.hist.reset(hist);
+            } else if (item.hist) {
+                item.hist->Add(hist);
+            }
+        } else if (auto* vec = dynamic_cast<TVectorD*>(obj.get()); vec && name.rfind("q", 0) == 0) {
+            QuantileSketch sketch = QuantileSketch::fromVector(vec->GetMatrixArray(), vec->GetNrows());
+            Item& item = getItem(path, name, isNew);
+            if (isNew) {
+                item.sketch = std::make_unique<QuantileSketch>(std::move(sketch));
+            } else if (item.sketch) {
+                item.sketch->merge(sketch);
+            }
+        } else if (auto* vec = dynamic_cast<TVectorD*>(obj.get());
+                   vec && name.rfind("sStats", 0) == 0 && vec->GetNrows() == ComparisonSummary::nSums) {
+            Item& item = getItem(path, name, isNew);
+            if (isNew) item.sums.assign(ComparisonSummary::nSums, 0.0);
+            for (int i = 0; i < ComparisonSummary::nSums; ++i) {
+                item.sums[i] += (*vec)[i];
+            }
+        } else if (auto* tree = dynamic_cast<TTree*>(obj.get()); tree && path.empty() && name == "Summary") {
+            // Only which rows exist: the numbers are recomputed from the merged sums
+            for (auto& row : ComparisonSummary::read(tree)) {
+                if (summaryStats_.insert(row.stats).second) summaryRows_.push_back(std::move(row));
+            }
+        } else {
+            std::cerr << "Warning: " << path << "/" << name << " (" << obj->ClassName()
+                      << ") is not merged" << '\n';
+        }
+    }
+}
+
+void OutputMerger::write(const std::string& outPath) const {
+    std::unique_ptr<TFile> fout(TFile::Open(outPath.c_str(), "RECREATE"));
+    if (!fout || fout->IsZombie()) {
+        throw std::runtime_error("OutputMerger: cannot create " + outPath);
+    }
+    for (const auto& item : items_) {
+        TDirectory* dir = Helper::createTDirectory(fout.get(), item.dir);
+        if (item.hist) {
+            dir->WriteTObject(item.hist.get(), item.name.c_str());
+        } else if (item.sketch) {
+            const std::vector<double> data = item.sketch->toVector();
+            TVectorD vec(static_cast<int>(data.size()));
+            std::copy(data.begin(), data.end(), vec.GetMatrixArray());
+            dir->WriteObject(&vec, item.name.c_str());
+        } else if (!item.sums.empty()) {
+            TVectorD vec(ComparisonSummary::nSums, item.sums.data());
+            dir->WriteObject(&vec, item.name.c_str());
+        }
+    }
+    if (!summaryRows_.empty()) writeSummary(fout.get());
+    fout->Write();
+    fout->Close();
+    std::cout << "[OutputMerger] Wrote " << items_.size() << " objects to " << outPath << '\n';
+}
+
+void OutputMerger::writeSummary(TDirectory* dir) const {
+    ComparisonSummary summary;
+    for (ComparisonSummary::Row row : summaryRows_) {
+        auto itStats = index_.find(row.stats);
+        if (itStats == index_.end() || items_[itStats->second].sums.empty()) {
+            std::cerr << "Warning: no merged " << row.stats << ", not in the Summary tree" << '\n';
+            continue;
+        }
+        ComparisonSummary::setSums(row, items_[itStats->second].sums.data());
+
+        // The profile bin farthest from V/R = 1, as in HistGiven, from the merged pRatio
+        row.maxDevX = std::nan("");
+        row.maxDevRatio = std::nan("");
+        const auto slash = row.stats.rfind('/');
+        const std::string ratioPath = row.stats.substr(0, slash + 1) + "pRatio" +
+                                      row.stats.substr(slash + 1 + std::string("sStats").size());
+        auto itRatio = index_.find(ratioPath);
+        const auto* pRatio = itRatio == index_.end() ? nullptr
+                                                     : dynamic_cast<const TProfile*>(items_[itRatio->second].hist.get());
+        double maxDev = -1.0;
+        for (int bin = 1; pRatio && bin <= pRatio->GetNbinsX(); ++bin) {
+            if (pRatio->GetBinEntries(bin) <= 0) continue;
+            const double dev = std::abs(pRatio->GetBinContent(bin) - 1.0);
+            if (dev > maxDev) {
+                maxDev = dev;
+                row.maxDevX = pRatio->GetXaxis()->GetBinCenter(bin);
+                row.maxDevRatio = pRatio->GetBinContent(bin);
+            }
+        }
+        summary.add(std::move(row));
+    }
+    summary.write(dir);
+    summary.print();
+}
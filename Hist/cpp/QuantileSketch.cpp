@@ -0,0 +1,132 @@
+#include "QuantileSketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+QuantileSketch::QuantileSketch(int k)
+    : k_(k) {
+    if (k_ < 8) {
+        throw std::runtime_error("QuantileSketch: k must be at least 8");
+    }
+    addLevel();
+}
+
+auto QuantileSketch::capacity(std::size_t level) const -> std::size_t {
+    const std::size_t depth = levels_.size() - 1 - level;
+    const double cap = std::ceil(k_ * std::pow(2.0 / 3.0, static_cast<double>(depth)));
+    return std::max<std::size_t>(2, static_cast<std::size_t>(cap));
+}
+
+void QuantileSketch::addLevel() {
+    levels_.emplace_back();
+    maxRetained_ = 0;
+    for (std::size_t h = 0; h < levels_.size(); ++h) {
+        maxRetained_ += capacity(h);
+    }
+}
+
+auto QuantileSketch::randomBit() -> bool {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 7;
+    random_ ^= random_ << 17;
+    return random_ & 1;
+}
+
+void QuantileSketch::compress() {
+    while (nRetained_ >= maxRetained_) {
+        // The lowest full level moves half of its values up
+        std::size_t h = 0;
+        while (levels_[h].size() < capacity(h)) h++;
+        if (h + 1 == levels_.size()) addLevel();
+
+        auto& level = levels_[h];
+        std::sort(level.begin(), level.end());
+        // With an odd number of values, the first one stays at this level
+        const std::size_t first = level.size() % 2;
+        auto& up = levels_[h + 1];
+        const std::size_t upBefore = up.size();
+        for (std::size_t i = first + (randomBit() ? 1 : 0); i < level.size(); i += 2) {
+            up.push_back(level[i]);
+        }
+        nRetained_ -= level.size() - first - (up.size() - upBefore);
+        level.resize(first);
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    if (other.n_ == 0) return;
+    if (n_ == 0 || other.min_ < min_) min_ = other.min_;
+    if (n_ == 0 || other.max_ > max_) max_ = other.max_;
+    n_ += other.n_;
+    while (levels_.size() < other.levels_.size()) addLevel();
+    for (std::size_t h = 0; h < other.levels_.size(); ++h) {
+        levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+        nRetained_ += other.levels_[h].size();
+    }
+    compress();
+}
+
+auto QuantileSketch::quantile(double q) const -> double {
+    if (n_ == 0) return 0.0;
+    if (q <= 0.0) return min_;
+    if (q >= 1.0) return max_;
+
+    std::vector<std::pair<double, double>> weighted; // (value, weight)
+    double total = 0.0;
+    for (std::size_t h = 0; h < levels_.size(); ++h) {
+        const double weight = std::ldexp(1.0, static_cast<int>(h));
+        for (double x : levels_[h]) {
+            weighted.emplace_back(x, weight);
+            total += weight;
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+    const double rank = q * total;
+    double cumulative = 0.0;
+    for (const auto& [x, weight] : weighted) {
+        cumulative += weight;
+        if (cumulative >= rank) return x;
+    }
+    return max_;
+}
+
+auto QuantileSketch::toVector() const -> std::vector<double> {
+    // format, k, n, min, max, number of levels, size of each level, values level by level
+    std::vector<double> data = {1.0, static_cast<double>(k_), static_cast<double>(n_), min_, max_,
+                                static_cast<double>(levels_.size())};
+    for (const auto& level : levels_) {
+        data.push_back(static_cast<double>(level.size()));
+    }
+    for (const auto& level : levels_) {
+        data.insert(data.end(), level.begin(), level.end());
+    }
+    return data;
+}
+
+auto QuantileSketch::fromVector(const double* data, int size) -> QuantileSketch {
+    if (size < 6 || data[0] != 1.0) {
+        throw std::runtime_error("QuantileSketch: not a sketch vector");
+    }
+    QuantileSketch sketch(static_cast<int>(data[1]));
+    sketch.n_ = static_cast<std::uint64_t>(data[2]);
+    sketch.min_ = data[3];
+    sketch.max_ = data[4];
+    const auto nLevels = static_cast<std::size_t>(data[5]);
+    if (nLevels < 1 || 6 + nLevels > static_cast<std::size_t>(size)) {
+        throw std::runtime_error("QuantileSketch: truncated sketch vector");
+    }
+    while (sketch.levels_.size() < nLevels) sketch.addLevel();
+    std::size_t pos = 6 + nLevels;
+    for (std::size_t h = 0; h < nLevels; ++h) {
+        const auto levelSize = static_cast<std::size_t>(data[6 + h]);
+        if (pos + levelSize > static_cast<std::size_t>(size)) {
+            throw std::runtime_error("QuantileSketch: truncated sketch vector");
+        }
+        sketch.levels_[h].assign(data + pos, data + pos + levelSize);
+        sketch.nRetained_ += levelSize;
+        pos += levelSize;
+    }
+    return sketch;
+}
@@ -0,0 +1,49 @@
+#include "ReducedCorrections.h"
+
+#include <algorithm>
+
+auto ReducedCorrections::get(const CompiledCorrection& compiled, const std::vector<std::size_t>& inputs,
+                             const double* values) -> const CompiledCorrection& {
+    auto [it, isNew] = entries_.try_emplace(&compiled);
+    Entry& entry = it->second;
+    if (isNew) {
+        for (std::size_t input : inputs) {
+            // The interval between edges decides every bin; categories need the value
+            if (compiled.isCategoryInput(input)) {
+                entry.edges.emplace_back();
+            } else {
+                entry.edges.push_back(compiled.getInputEdges(input));
+            }
+        }
+    }
+
+    key_.resize(inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        const auto& edges = entry.edges[i];
+        key_[i] = edges.empty() ? values[i]
+                                : static_cast<double>(std::upper_bound(edges.begin(), edges.end(), values[i]) - edges.begin());
+    }
+    if (entry.last && key_ == entry.lastKey) {
+        return *entry.last;
+    }
+
+    auto& tree = entry.trees[key_];
+    if (!tree) {
+        std::shared_ptr<CompiledCorrection> reduced;
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            reduced = (reduced ? *reduced : compiled).bindValue(inputs[i], values[i]);
+        }
+        tree = reduced ? reduced : std::make_shared<CompiledCorrection>(compiled);
+    }
+    entry.lastKey = key_;
+    entry.last = tree.get();
+    return *tree;
+}
+
+auto ReducedCorrections::size() const -> std::size_t {
+    std::size_t n = 0;
+    for (const auto& [compiled, entry] : entries_) {
+        n += entry.trees.size();
+    }
+    return n;
+}
@@ -1,212 +1,462 @@
 #include "RunChannel.h"
 #include "ScaleObject.h"
+#include "CorrectionPlan.h"
 
 #include "Helper.h"
-#include "HistGivenPt.h"
-#include "HistGivenEta.h"
-#include "HistGivenBoth.h"
-#include "nlohmann/json.hpp"
-   
+#include "EventBatchRing.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
 // Constructor implementation
 RunChannel::RunChannel(GlobalFlag& globalFlags)
     :globalFlags_(globalFlags) {
 }
 
-auto RunChannel::Run(std::shared_ptr<SkimTree>& skimT, const std::string& metadataJsonPath, TFile *fout) -> int{
-   
+auto RunChannel::Run(std::shared_ptr<SkimTree>& skimT, const MetadataRegistry& registry, TFile *fout) -> int{
+    // Pass GlobalFlag reference to ScaleObject
+    std::shared_ptr<ScaleObject> scaleObject = std::make_shared<ScaleObject>(globalFlags_);
+
+    //------------------------------------
+    // Compile the metadata into a plan
+    //------------------------------------
+    CorrectionPlan plan(registry, *scaleObject, InputBranchMap());
+    scaleObject->prepareBackends();
+    plan.specialize(*scaleObject);
+    plan.printPlan();
+
+    return Run(*skimT, plan, *scaleObject, fout);
+}
+
+auto RunChannel::Run(SkimTree& skimT, const CorrectionPlan& plan, const ScaleObject& scaleObject, TFile *fout) -> int{
+
     assert(fout && !fout->IsZombie());
     fout->cd();
- 
+
     TDirectory *origDir = gDirectory;
-    //------------------------------------
-    // Define pT and eta bin edges
-    //------------------------------------
-    const int nPtBins = 6;
-    const double ptBinEdges[nPtBins + 1] = {15, 30, 50, 110, 500, 1000, 4500};
-    
-    const int nEtaBins = 4;
-    const double etaBinEdges[nEtaBins + 1] = {0.0, 1.3, 2.5, 3.0, 5.0};
-    
-    // Pass GlobalFlag reference to ScaleObject
-    std::shared_ptr<ScaleObject> scaleObject = std::make_shared<ScaleObject>(globalFlags_);
 
     //------------------------------------
-    // Initialize Hists 
+    // Initialize Hists
     //------------------------------------
-    // Create a 1D vector to hold unique_ptrs to HistGivenPt objects
-    std::vector<std::unique_ptr<HistGivenPt>> histGivenPts;
-    for(int ptBin = 0; ptBin < nPtBins; ++ptBin){
-        std::string dirName = "Pt_" + Helper::formatNumber(ptBinEdges[ptBin]) + 
-                              "_" + Helper::formatNumber(ptBinEdges[ptBin+1]);
-        histGivenPts.emplace_back(std::make_unique<HistGivenPt>(origDir, dirName, metadataJsonPath));
+    HistBook book;
+    bookHists(origDir, plan, book);
+
+    // Read only the branches the event loop and the corrections need
+    skimT.activateBranches(plan.getInputBranches());
+
+    if (skimT.isStaging()) {
+        // Each file is processed as soon as it is on local disk, while the next ones are copied
+        while (skimT.nextStagedFile()) {
+            processJob(skimT, plan, scaleObject, book);
+        }
+    } else {
+        processJob(skimT, plan, scaleObject, book);
+    }
+
+    saveHists(book, globalFlags_.isWriteEmpty(), origDir);
+    fout->Write();
+    //Helper::scanTFile(fout);
+    std::cout << "Output file: " << fout->GetName() << '\n';
+    return 0;
+}
+
+void RunChannel::processJob(SkimTree& skimT, const CorrectionPlan& plan, const ScaleObject& scaleObject,
+                            HistBook& book) const {
+    if (globalFlags_.isDebug()) {
+        std::cout << "Debug mode: running the event loop on a single thread" << '\n';
+        processRange(skimT, skimT.getJobFirstEntry(), skimT.getJobLastEntry(), plan, scaleObject, book, showProgress_);
+        return;
     }
+    // Also with one thread, so that the histograms are the same for any -j
+    processParallel(skimT, globalFlags_.getNThreads(), plan, scaleObject, book);
+}
 
-    // Create a 1D vector to hold unique_ptrs to HistGivenEta objects
-    std::vector<std::unique_ptr<HistGivenEta>> histGivenEtas;
-    for(int etaBin = 0; etaBin < nEtaBins; ++etaBin){
-        std::string dirName = "Eta_" + Helper::formatNumber(etaBinEdges[etaBin]) + 
-                              "_" + Helper::formatNumber(etaBinEdges[etaBin+1]);
-        histGivenEtas.emplace_back(std::make_unique<HistGivenEta>(origDir, dirName, metadataJsonPath));
+void RunChannel::bookHists(TDirectory* dir, const CorrectionPlan& plan, HistBook& book) const {
+    std::vector<HistGivenKey> keys;
+    for (const auto& entry : plan.getEntries()) {
+        keys.push_back({entry.baseKey, entry.labels, entry.reference, entry.group});
     }
+    book.histGivenPt = std::make_unique<HistGivenPt>(dir, "HistGivenPt", keys);
+    book.histGivenEta = std::make_unique<HistGivenEta>(dir, "HistGivenEta", keys);
+    book.histGivenBoth = std::make_unique<HistGivenBoth>(dir, "HistGivenBoth", keys);
+}
 
-    // Create a 2D vector to hold unique_ptrs to HistGivenBoth objects
-    std::vector<std::vector<std::unique_ptr<HistGivenBoth>>> histGivenBoths;
-    histGivenBoths.reserve(nEtaBins); // Reserve space for outer vector
+void RunChannel::saveHists(const HistBook& book, bool writeEmpty, TDirectory* dir) {
+    book.histGivenPt->save(writeEmpty);
+    book.histGivenEta->save(writeEmpty);
+    book.histGivenBoth->save(writeEmpty);
 
-    for(int etaBin = 0; etaBin < nEtaBins; ++etaBin){
-        std::vector<std::unique_ptr<HistGivenBoth>> ptHists;
-        ptHists.reserve(nPtBins); // Reserve space for inner vector
+    // The comparison of the versions, from the same sums
+    ComparisonSummary summary;
+    book.histGivenPt->summarize(summary);
+    book.histGivenEta->summarize(summary);
+    book.histGivenBoth->summarize(summary);
+    summary.write(dir);
+    summary.print();
+}
 
-        for(int ptBin = 0; ptBin < nPtBins; ++ptBin){
-            // Create a unique name for each HistGivenBoth based on bin ranges
-            std::string histName = "Eta_" + Helper::formatNumber(etaBinEdges[etaBin]) + 
-                                    "_" + Helper::formatNumber(etaBinEdges[etaBin+1]) + 
-                                    "_Pt_" + Helper::formatNumber(ptBinEdges[ptBin]) + 
-                                    "_" + Helper::formatNumber(ptBinEdges[ptBin+1]);
-            // Initialize HistGivenBoth for this bin
-            ptHists.emplace_back(std::make_unique<HistGivenBoth>(origDir, histName, metadataJsonPath));
+void RunChannel::mergeHists(HistBook& target, const HistBook& src) {
+    target.histGivenPt->merge(*src.histGivenPt);
+    target.histGivenEta->merge(*src.histGivenEta);
+    target.histGivenBoth->merge(*src.histGivenBoth);
+}
+
+void RunChannel::clearHists(HistBook& book) {
+    book.histGivenPt->clear();
+    book.histGivenEta->clear();
+    book.histGivenBoth->clear();
+}
+
+void RunChannel::processParallel(SkimTree& skimT, int nThreads, const CorrectionPlan& plan,
+                                 const ScaleObject& scaleObject, HistBook& book) const {
+    // The ranges do not depend on nThreads: about nRanges per job, so that a slow file
+    // does not stall one worker
+    const Long64_t firstEntry = skimT.getJobFirstEntry();
+    const Long64_t lastEntry = skimT.getJobLastEntry();
+    const Long64_t nentries = lastEntry - firstEntry;
+    const Long64_t minEntries = std::max<Long64_t>(1, nentries / nRanges);
+    // Cluster ranges restricted to the entries of this job
+    std::vector<std::pair<Long64_t, Long64_t>> ranges;
+    for (const auto& [first, last] : skimT.getClusterRanges(minEntries)) {
+        const Long64_t lo = std::max(first, firstEntry);
+        const Long64_t hi = std::min(last, lastEntry);
+        if (lo < hi) ranges.emplace_back(lo, hi);
+    }
+    nThreads = std::max(1, std::min<int>(nThreads, static_cast<int>(ranges.size())));
+    std::cout << "\nStarting loop over " << nentries << " entries in " << ranges.size()
+              << " cluster ranges on " << nThreads << " threads" << '\n';
+
+    // Each worker gets its own branch buffers
+    std::vector<std::unique_ptr<SkimTree>> clones;
+    std::vector<SkimTree*> workerTrees;
+    if (nThreads == 1) {
+        workerTrees.push_back(&skimT);
+    } else {
+        for (int w = 0; w < nThreads; ++w) {
+            clones.emplace_back(skimT.cloneForWorker());
+            workerTrees.push_back(clones.back().get());
         }
+    }
 
-        histGivenBoths.emplace_back(std::move(ptHists)); // Move the inner vector into the outer vector
+    // Each range is filled into an empty book, and the books are added to the output
+    // book in range order: the sums do not depend on which thread read which range.
+    // The books of ranges done ahead of an earlier one wait; there are at most
+    // 2 * nThreads of them. They are never saved, so they create no ROOT object.
+    TDirectory* callerDir = gDirectory;
+    std::vector<HistBook> rangeBooks(2 * static_cast<std::size_t>(nThreads));
+    std::vector<std::size_t> freeBooks;
+    for (std::size_t b = 0; b < rangeBooks.size(); ++b) {
+        bookHists(callerDir, plan, rangeBooks[b]);
+        freeBooks.push_back(b);
     }
-    
-    //------------------------------------
-    // Parse the metadata JSON
-    //------------------------------------
-    std::ifstream inFile(metadataJsonPath);
-    nlohmann::json meta;
-    inFile >> meta;
-    inFile.close();
+    std::vector<int> doneBooks(ranges.size(), -1); // [range] its filled book, -1 if not done
+    std::size_t nextRange = 0;
+    std::size_t nextMerge = 0;
+    std::mutex mutex;
+    std::condition_variable bookFreed;
 
+    // An exception must not escape a std::thread: the first one is kept, no further
+    // range is handed out, and it is rethrown once all threads are joined
+    std::exception_ptr firstError;
+    auto stopOnError = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!firstError) firstError = std::current_exception();
+        nextRange = ranges.size();
+        bookFreed.notify_all();
+    };
 
+    std::atomic<Long64_t> nDone{0};
+    auto worker = [&](int w) {
+        try {
+            while (true) {
+                std::size_t r = 0;
+                std::size_t b = 0;
+                {
+                    // The book before the range: the worker of range nextMerge always has one
+                    std::unique_lock<std::mutex> lock(mutex);
+                    bookFreed.wait(lock, [&]() { return !freeBooks.empty() || nextRange >= ranges.size(); });
+                    if (nextRange >= ranges.size()) return;
+                    b = freeBooks.back();
+                    freeBooks.pop_back();
+                    r = nextRange++;
+                }
+                processRange(*workerTrees[w], ranges[r].first, ranges[r].second,
+                             plan, scaleObject, rangeBooks[b], false);
+                nDone += ranges[r].second - ranges[r].first;
+
+                std::lock_guard<std::mutex> lock(mutex);
+                doneBooks[r] = static_cast<int>(b);
+                for (; nextMerge < ranges.size() && doneBooks[nextMerge] >= 0; ++nextMerge) {
+                    HistBook& done = rangeBooks[doneBooks[nextMerge]];
+                    mergeHists(book, done);
+                    clearHists(done);
+                    freeBooks.push_back(doneBooks[nextMerge]);
+                }
+                bookFreed.notify_all();
+            }
+        } catch (...) {
+            stopOnError();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < nThreads; ++w) {
+        threads.emplace_back(worker, w);
+    }
+
+    // Print the progress every 10 seconds until all workers are done
+    std::atomic<bool> finished{false};
+    std::thread progress([&]() {
+        try {
+            auto startClock = std::chrono::high_resolution_clock::now();
+            auto lastPrint = startClock;
+            while (!finished) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                auto now = std::chrono::high_resolution_clock::now();
+                if (!showProgress_ || now - lastPrint < std::chrono::seconds(10)) continue;
+                lastPrint = now;
+                int sec = static_cast<int>(std::chrono::duration<double>(now - startClock).count());
+                std::cout << std::setw(5) << (nentries > 0 ? 100 * nDone / nentries : 100) << "% "
+                          << std::setw(5) << sec / 60 << "m " << sec % 60 << "s" << '\n';
+            }
+        } catch (...) {
+            stopOnError();
+        }
+    });
+    for (auto& t : threads) {
+        t.join();
+    }
+    finished = true;
+    progress.join();
+    if (firstError) std::rethrow_exception(firstError);
+    std::cout << "Merged histograms of " << ranges.size() << " ranges in range order" << '\n';
+}
+
+void RunChannel::processRange(SkimTree& skimT, Long64_t firstEntry, Long64_t lastEntry,
+                              const CorrectionPlan& plan, const ScaleObject& scaleObject,
+                              HistBook& book, bool isMainLoop) const {
+    if (globalFlags_.isAsyncRead() && !globalFlags_.isDebug() && !skimT.isCached()) {
+        processRangeAsync(skimT, firstEntry, lastEntry, plan, scaleObject, book, isMainLoop);
+        return;
+    }
     double totalTime = 0.0;
     auto startClock = std::chrono::high_resolution_clock::now();
-    Long64_t nentries = skimT->getEntries();
-    Helper::initProgress(nentries);
+    Long64_t nentries = lastEntry - firstEntry;
+    if (isMainLoop) Helper::initProgress(nentries);
     int run = 0;
     int newRun = 0;
-    for (Long64_t jentry = 0; jentry < nentries; ++jentry) {
-        if (globalFlags_.isDebug() && jentry > globalFlags_.getNDebug()) break;
-        Helper::printProgress(jentry, nentries, startClock, totalTime);
-       
-        Long64_t ientry = skimT->loadEntry(jentry);
-        if (ientry < 0) break; 
-        //if (ientry > 10000) break; 
-        skimT->getChain()->GetTree()->GetEntry(ientry);
-        run = skimT->run;
+
+    // Jets of several events are collected before evaluating the corrections.
+    // In debug mode the batch is flushed after each event to keep the printout readable.
+    const std::size_t batchSize = globalFlags_.isDebug() ? 1 : 512;
+    JetBatch batch;
+    batch.reserve(batchSize + SkimTree::nJetMax);
+    BatchBuffers buffers;
+
+    for (Long64_t jentry = firstEntry; jentry < lastEntry; ++jentry) {
+        if (globalFlags_.isDebug() && jentry - firstEntry > globalFlags_.getNDebug()) break;
+        if (isMainLoop) Helper::printProgress(jentry - firstEntry, nentries, startClock, totalTime);
+
+        // Reads from the chain, or from the jet cache
+        if (skimT.getEntry(jentry) <= 0) {
+            throw std::runtime_error("Error: failed to read entry " + std::to_string(jentry) + " in processRange()");
+        }
+        run = skimT.run;
         if(globalFlags_.isDebug()){
-            std::cout<<"\n ======= Run = "<< run<<", Event = "<<skimT->event <<"=======\n";
+            std::cout<<"\n ======= Run = "<< run<<", Event = "<<skimT.event <<"=======\n";
         }
-        if (newRun != run){
+        if (isMainLoop && newRun != run){
             newRun = run;
             std::cout<<newRun <<std::endl;
         }
 
-        for (int i = 0; i < skimT->nJet; ++i) {
-            //if (skimT->Jet_jetId[i] < 6) continue; // TightLepVeto
-            if (skimT->Jet_pt[i] < 15) continue;
-            std::vector<double> inputs = {};
-            // For each metadata entry, compute the correction factors
-            for (auto it = meta.begin(); it != meta.end(); ++it) {
-                std::string baseKey = it.key();
-                std::vector<double> corrFactors;
-            
-                // For each version of the correction (each [jsonFile, tag] pair)
-                for (auto &version : it.value()) {
-                    double corr = 1.0;
-                    if (version.size() < 2) continue; // Skip invalid entries.
-                    std::string jsonFile     = version.at(0).get<std::string>();
-                    std::string correctionTag = version.at(1).get<std::string>();
-                    if(globalFlags_.isDebug()){
-                        //std::cout << "[DEBUG] jsonFile='" << jsonFile
-                        //<< "', tag='" << correctionTag << '\n';
-                        std::cout << "\n[DEBUG] tag='" << correctionTag<< ", iJet = "<<i<<'\n';
-                    }
-    
-                    if (baseKey.find("_ScaleFactor_") != std::string::npos) {
-                        corr = scaleObject->evaluateJerSF(jsonFile, correctionTag, skimT->Jet_eta[i], skimT->Jet_pt[i], "nom");
-                    }
-                    else{
-                        if (baseKey.find("_L1FastJet_") != std::string::npos){
-                            inputs  = {skimT->Jet_area[i],skimT->Jet_eta[i], skimT->Jet_pt[i], skimT->Rho};
-                        }
-                        else if (baseKey.find("_L2Relative_") != std::string::npos){
-                            inputs  = {skimT->Jet_eta[i], skimT->Jet_phi[i], skimT->Jet_pt[i]};
-                        }
-                        else if (baseKey.find("_L3Absolute_") != std::string::npos){
-                            inputs  = {skimT->Jet_eta[i], skimT->Jet_pt[i]};
-                        }
-                        else if (baseKey.find("_L2L3Residual_") != std::string::npos){
-                            inputs = { static_cast<double>(skimT->run), skimT->Jet_eta[i], skimT->Jet_pt[i] };
-                            /*
-                            // Choose the input vector based on the JSON file.
-                            if (jsonFile.find("Winter25Prompt25_V1_jet_jerc.json") != std::string::npos) {
-                                inputs  = {skimT->Jet_eta[i], skimT->Jet_pt[i]};
-                            }
-                            else if (jsonFile.find("Winter24Prompt24_V3_jet_jerc.json") != std::string::npos) {
-                                inputs = { static_cast<double>(skimT->run), skimT->Jet_eta[i], skimT->Jet_pt[i] };
-                            }
-                            */
-                        }
-                        else if (baseKey.find("_PtResolution_") != std::string::npos){
-                            inputs  = {skimT->Jet_eta[i], skimT->Jet_pt[i], skimT->Rho};
-                        }
-                        else {
-                            inputs  = {skimT->Jet_eta[i], skimT->Jet_pt[i]};
-                        }
-                        // Evaluate this version's correction.
-                        corr = scaleObject->evaluateCorrection(jsonFile, correctionTag, inputs);
-                    }
-                    corrFactors.push_back(corr);
-                }
-                
-            
-                // Determine eta bin
-                int etaBin = -1;
-                double absEta = std::abs(skimT->Jet_eta[i]);
-                for(int b = 0; b < nEtaBins; ++b){
-                    if(absEta >= etaBinEdges[b] && absEta < etaBinEdges[b+1]){
-                        etaBin = b;
-                        break;
+        selectJets(skimT.nJet, skimT.Jet_area, skimT.Jet_eta, skimT.Jet_phi, skimT.Jet_pt,
+                   skimT.Rho, skimT.run, batch);
+
+        if (batch.size() >= batchSize) {
+            processBatch(batch, plan, scaleObject, book, buffers);
+            batch.clear();
+        }
+    }//event loop
+
+    processBatch(batch, plan, scaleObject, book, buffers);
+    batch.clear();
+}
+
+void RunChannel::processRangeAsync(SkimTree& skimT, Long64_t firstEntry, Long64_t lastEntry,
+                                   const CorrectionPlan& plan, const ScaleObject& scaleObject,
+                                   HistBook& book, bool isMainLoop) const {
+    // The reader thread uses the TChain while this thread fills histograms
+    // (ROOT::EnableThreadSafety is called by main)
+    double totalTime = 0.0;
+    auto startClock = std::chrono::high_resolution_clock::now();
+    Long64_t nentries = lastEntry - firstEntry;
+    if (isMainLoop) Helper::initProgress(nentries);
+
+    // Reader: GetEntry (I/O and decompression) into the free slots of the ring
+    EventBatchRing ring(asyncRingSlots, asyncBatchEvents, SkimTree::nJetMax);
+    std::exception_ptr readError;
+    std::thread reader([&]() {
+        try {
+            Long64_t jentry = firstEntry;
+            while (jentry < lastEntry) {
+                EventBatch* out = ring.beginWrite();
+                if (!out) break; // the event loop stopped
+                out->clear();
+                for (; jentry < lastEntry && out->size() < asyncBatchEvents; ++jentry) {
+                    if (skimT.getEntry(jentry) <= 0) {
+                        throw std::runtime_error("Error: failed to read entry " + std::to_string(jentry) +
+                                                 " in processRangeAsync()");
                     }
+                    const int nJet = skimT.nJet < SkimTree::nJetMax ? skimT.nJet : SkimTree::nJetMax;
+                    out->push(skimT.run, skimT.event, skimT.Rho, nJet,
+                              skimT.Jet_area, skimT.Jet_eta, skimT.Jet_phi, skimT.Jet_pt);
                 }
-                // Handle edge case where eta == upper edge
-                if(etaBin == -1 && absEta == etaBinEdges[nEtaBins]){
-                    etaBin = nEtaBins - 1;
-                }
+                ring.endWrite();
+            }
+        } catch (...) {
+            readError = std::current_exception();
+        }
+        ring.close();
+    });
 
-                // Determine pT bin
-                int ptBin = -1;
-                double pt = skimT->Jet_pt[i];
-                for(int b = 0; b < nPtBins; ++b){
-                    if(pt >= ptBinEdges[b] && pt < ptBinEdges[b+1]){
-                        ptBin = b;
-                        break;
-                    }
+    // Event loop: select the jets of each batch, evaluate and fill
+    const std::size_t batchSize = 512;
+    JetBatch batch;
+    batch.reserve(batchSize + SkimTree::nJetMax);
+    BatchBuffers buffers;
+    Long64_t nDone = 0;
+    int newRun = 0;
+    try {
+        while (const EventBatch* in = ring.beginRead()) {
+            for (std::size_t e = 0; e < in->size(); ++e) {
+                if (isMainLoop) Helper::printProgress(nDone, nentries, startClock, totalTime);
+                ++nDone;
+                const int run = in->run[e];
+                if (isMainLoop && newRun != run){
+                    newRun = run;
+                    std::cout<<newRun <<std::endl;
                 }
-                // Handle edge case where pt == upper edge
-                if(ptBin == -1 && pt == ptBinEdges[nPtBins]){
-                    ptBin = nPtBins - 1;
+                const std::size_t j0 = in->jetOffset[e];
+                selectJets(static_cast<int>(in->nJets(e)), in->area.data() + j0, in->eta.data() + j0,
+                           in->phi.data() + j0, in->pt.data() + j0, in->rho[e], in->run[e], batch);
+                if (batch.size() >= batchSize) {
+                    processBatch(batch, plan, scaleObject, book, buffers);
+                    batch.clear();
                 }
+            }
+            ring.endRead();
+        }
+    } catch (...) {
+        ring.cancel();
+        reader.join();
+        throw;
+    }
+    reader.join();
+    if (readError) std::rethrow_exception(readError);
 
-                // If the jet falls outside the defined bins, skip filling
-                if(etaBin == -1 || ptBin == -1){
-                    continue;
-                }
+    processBatch(batch, plan, scaleObject, book, buffers);
+    batch.clear();
+}
 
-                // Fill the corresponding histogram
-                histGivenPts[ptBin]->fill(baseKey, skimT->Jet_eta[i], corrFactors);
+void RunChannel::selectJets(int nJet, const Float_t* area, const Float_t* eta, const Float_t* phi,
+                            const Float_t* pt, double rho, double run, JetBatch& batch) {
+    for (int i = 0; i < nJet; ++i) {
+        //if (skimT.Jet_jetId[i] < 6) continue; // TightLepVeto
+        if (pt[i] < 15) continue;
 
-                histGivenEtas[etaBin]->fill(baseKey, skimT->Jet_pt[i], corrFactors);
+        // Skip the jets that no view fills, before any correction is evaluated
+        batch.push(area[i], eta[i], phi[i], pt[i], rho, run);
+        if (!isInAnyView(batch, batch.size() - 1)) batch.pop();
+    }
+}
 
-                histGivenBoths[etaBin][ptBin]->fill(baseKey, corrFactors);
-            }//metadata loop
-        }//jet loop
-    }//event loop
+auto RunChannel::isInAnyView(const JetBatch& batch, std::size_t j) -> bool {
+    return HistGivenPt::findCell(batch, j) >= 0 || HistGivenEta::findCell(batch, j) >= 0 ||
+           HistGivenBoth::findCell(batch, j) >= 0;
+}
 
-    fout->Write();
-    //Helper::scanTFile(fout);
-    std::cout << "Output file: " << fout->GetName() << '\n';
-    return 0;
+void RunChannel::evaluateEntry(const CorrectionPlanEntry& entry, const JetBatch& batch,
+                               const ScaleObject& scaleObject, BatchBuffers& buffers) {
+    const std::size_t nJets = batch.size();
+    const std::size_t nVersions = entry.refs.size();
+    if (buffers.corrValues.size() < nVersions) buffers.corrValues.resize(nVersions);
+
+    for (std::size_t v = 0; v < nVersions; ++v) {
+        buffers.corrValues[v].resize(nJets);
+    }
+    if (entry.fused) {
+        // The distinct versions share the binning: one bin search per jet for all
+        buffers.columns.clear();
+        for (JetColumn col : entry.inputColumns[0]) {
+            buffers.columns.push_back(batch.column(col));
+        }
+        buffers.fusedOuts.clear();
+        for (std::size_t v = 0; v < nVersions; ++v) {
+            if (entry.sameAs[v] < 0) buffers.fusedOuts.push_back(buffers.corrValues[v].data());
+        }
+        scaleObject.evaluateFusedBatch(entry.fusedRefs, buffers.columns, nJets, buffers.fusedOuts);
+        return;
+    }
+
+    // For each version of the correction
+    for (std::size_t v = 0; v < nVersions; ++v) {
+        if (entry.sameAs[v] >= 0) continue; // identical to an earlier version, values reused
+        buffers.columns.clear();
+        for (JetColumn col : entry.inputColumns[v]) {
+            buffers.columns.push_back(batch.column(col));
+        }
+        auto& values = buffers.corrValues[v];
+        if (entry.level == CorrectionLevel::ScaleFactor) {
+            scaleObject.evaluateJerSFBatch(entry.refs[v], buffers.columns, nJets, "nom", values.data());
+        }
+        else if (v < entry.invariantInputs.size() && !entry.invariantInputs[v].empty()) {
+            // run and rho are bound once per run of jets from the same run and event
+            scaleObject.evaluateBatchReduced(entry.refs[v], buffers.columns, entry.invariantInputs[v],
+                                             nJets, values.data(), buffers.reduced);
+        }
+        else{
+            scaleObject.evaluateBatch(entry.refs[v], buffers.columns, nJets, values.data());
+        }
+    }
+}
+
+void RunChannel::processBatch(const JetBatch& batch, const CorrectionPlan& plan,
+                              const ScaleObject& scaleObject, HistBook& book,
+                              BatchBuffers& buffers) const {
+    const std::size_t nJets = batch.size();
+    if (nJets == 0) return;
+
+    // Directory of each jet in each view, the same for all entries
+    buffers.ptCells.resize(nJets);
+    buffers.etaCells.resize(nJets);
+    buffers.bothCells.resize(nJets);
+    for (std::size_t j = 0; j < nJets; ++j) {
+        buffers.ptCells[j] = HistGivenPt::findCell(batch, j);
+        buffers.etaCells[j] = HistGivenEta::findCell(batch, j);
+        buffers.bothCells[j] = HistGivenBoth::findCell(batch, j);
+    }
+
+    // For each metadata entry, compute the correction factors of all jets
+    for (const auto& entry : plan.getEntries()) {
+        const std::size_t nVersions = entry.refs.size();
+        evaluateEntry(entry, batch, scaleObject, buffers);
+
+        // Fill the corresponding histograms, jet by jet in the original order
+        for (std::size_t j = 0; j < nJets; ++j) {
+            buffers.corrFactors.clear();
+            for (std::size_t v = 0; v < nVersions; ++v) {
+                buffers.corrFactors.push_back(buffers.corrValues[entry.source(v)][j]);
+            }
+            // The histograms are booked in id order: entry.id is their handle
+            book.histGivenPt->fill(entry.id, buffers.ptCells[j], batch, j, buffers.corrFactors);
+            book.histGivenEta->fill(entry.id, buffers.etaCells[j], batch, j, buffers.corrFactors);
+            book.histGivenBoth->fill(entry.id, buffers.bothCells[j], batch, j, buffers.corrFactors);
+        }
+    }//metadata loop
 }
-   
+
@@ -3,10 +3,29 @@
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
+#include <sstream>
+#include <random>
+#include <cmath>
 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
 #include <variant> // Needed for std::variant
 #include "nlohmann/json.hpp"
 
+namespace {
+// Systematics for which corrections with a string input (JER SF) are bound
+const char* const boundSysts[] = {"nom", "up", "down"};
+
+int findStringInput(const CompiledCorrection& compiled) {
+    for (std::size_t i = 0; i < compiled.getNInputs(); ++i) {
+        if (compiled.isStringInput(i)) return static_cast<int>(i);
+    }
+    return -1;
+}
+} // namespace
+
 ScaleObject::ScaleObject(GlobalFlag& globalFlags)
     : globalFlags_(globalFlags)
     , year_(globalFlags_.getYear())
@@ -21,11 +40,16 @@ ScaleObject::ScaleObject(GlobalFlag& globalFlags)
 
 // Modify the definition to be const:
 correction::Correction::Ref ScaleObject::getCorrectionRef(const std::string& jsonFile, const std::string& tag) const {
+    std::lock_guard<std::mutex> lock(correctionSetsMutex_);
     if (correctionSets_.find(jsonFile) == correctionSets_.end()) {
         std::cout << "Loading CorrectionSet from: " << jsonFile << std::endl;
         auto cset = correction::CorrectionSet::from_file(jsonFile);
         correctionSets_[jsonFile] = std::move(cset); // Allowed since correctionSets_ is mutable.
     }
+    const auto key = std::make_pair(jsonFile, tag);
+    if (std::find(resolvedCorrections_.begin(), resolvedCorrections_.end(), key) == resolvedCorrections_.end()) {
+        resolvedCorrections_.push_back(key);
+    }
     try {
         return correctionSets_.at(jsonFile)->at(tag);
     } catch (const std::exception &e) {
@@ -34,10 +58,89 @@ correction::Correction::Ref ScaleObject::getCorrectionRef(const std::string& jso
     }
 }
 
+void ScaleObject::preloadCorrections(const std::vector<CorrectionImage::Source>& sources, int nThreads,
+                                     const std::string& cacheDir) const {
+    if (sources.empty()) return;
+    auto startClock = std::chrono::high_resolution_clock::now();
+
+    std::unique_ptr<CorrectionImage> image;
+    try {
+        const std::uint64_t hash = CorrectionImage::hashSources(sources, nThreads);
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.img", static_cast<unsigned long long>(hash));
+        const std::string path = cacheDir + "/" + name;
+        if (CorrectionImage::isUsable(path, hash)) {
+            std::cout << "[ScaleObject] Using cached " << path << '\n';
+            try {
+                image = std::make_unique<CorrectionImage>(path);
+            } catch (const std::exception& e) {
+                std::cerr << "[ScaleObject] Rebuilding the correction image: " << e.what() << '\n';
+            }
+        } else {
+            std::filesystem::create_directories(cacheDir);
+        }
+        if (!image) {
+            CorrectionImage::build(path, sources, hash, nThreads);
+            image = std::make_unique<CorrectionImage>(path);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ScaleObject] No correction image, parsing the JSON files: " << e.what() << '\n';
+    }
+
+    // One file per thread
+    std::vector<std::shared_ptr<correction::CorrectionSet>> sets(sources.size());
+    std::vector<std::string> reduced(sources.size());
+    std::atomic<std::size_t> next{0};
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < sources.size(); i = next++) {
+            const std::string& jsonFile = sources[i].jsonFile;
+            try {
+                const char* json = image ? image->getJson(jsonFile) : nullptr;
+                if (json) {
+                    reduced[i] = json;
+                    sets[i] = correction::CorrectionSet::from_string(json);
+                } else {
+                    sets[i] = correction::CorrectionSet::from_file(jsonFile);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "[ScaleObject] Cannot preload " << jsonFile << ": " << e.what() << '\n';
+            }
+        }
+    };
+    nThreads = std::max(1, std::min<int>(nThreads, static_cast<int>(sources.size())));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::size_t nLoaded = 0;
+    {
+        std::lock_guard<std::mutex> lock(correctionSetsMutex_);
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            if (!sets[i] || correctionSets_.count(sources[i].jsonFile)) continue;
+            correctionSets_[sources[i].jsonFile] = std::move(sets[i]);
+            if (!reduced[i].empty()) reducedJsons_[sources[i].jsonFile] = std::move(reduced[i]);
+            nLoaded++;
+        }
+    }
+    const double loadTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startClock).count();
+    std::cout << "[ScaleObject] Preloaded " << nLoaded << " of " << sources.size() << " correction files"
+              << (image ? " from their image" : "") << " in " << loadTime << " s" << '\n';
+}
+
 // Updated evaluateCorrection with debug prints
 double ScaleObject::evaluateCorrection(const std::string& jsonFile,
                                          const std::string& correctionTag,
                                          const std::vector<double>& inputs) const {
+    // Get the correction reference (caching happens in getCorrectionRef)
+    return evaluateCorrection(getCorrectionRef(jsonFile, correctionTag), inputs);
+}
+
+double ScaleObject::evaluateCorrection(const correction::Correction::Ref& corrRef,
+                                         const std::vector<double>& inputs) const {
     // Print inputs if debugging
     if (isDebug_) {
         std::cout<< "[DEBUG] inputs=["; 
@@ -56,9 +159,6 @@ double ScaleObject::evaluateCorrection(const std::string& jsonFile,
         formattedInputs.emplace_back(value);
     }
 
-    // Get the correction reference (caching happens in getCorrectionRef)
-    correction::Correction::Ref corrRef = getCorrectionRef(jsonFile, correctionTag);
-
     try {
         // Evaluate the correction factor
         double result = corrRef->evaluate(formattedInputs);
@@ -67,8 +167,8 @@ double ScaleObject::evaluateCorrection(const std::string& jsonFile,
         }
         return result;
     } catch (const std::exception &e) {
-        std::cerr << "Error: evaluateCorrection for json=" << jsonFile
-                  << " tag=" << correctionTag << ": " << e.what() << std::endl;
+        std::cerr << "Error: evaluateCorrection for tag=" << corrRef->name()
+                  << ": " << e.what() << std::endl;
         return 1.0;
     }
 }
@@ -79,6 +179,14 @@ double ScaleObject::evaluateJerSF(const std::string& jsonFile,
                                   const double& jetEta,
                                   const double& jetPt,
                                   const std::string &syst) const {
+    // Get the correction reference using the caching mechanism.
+    return evaluateJerSF(getCorrectionRef(jsonFile, correctionTag), jetEta, jetPt, syst);
+}
+
+double ScaleObject::evaluateJerSF(const correction::Correction::Ref& corrRef,
+                                  const double& jetEta,
+                                  const double& jetPt,
+                                  const std::string &syst) const {
     if (isDebug_) {
         std::cout << "[DEBUG] inputs: jetEta=" << jetEta
                   << ", jetPt=" << jetPt
@@ -92,9 +200,6 @@ double ScaleObject::evaluateJerSF(const std::string& jsonFile,
     formattedInputs.emplace_back(jetPt);
     formattedInputs.emplace_back(syst);
 
-    // Get the correction reference using the caching mechanism.
-    correction::Correction::Ref corrRef = getCorrectionRef(jsonFile, correctionTag);
-
     try {
         // Evaluate and return the scale factor.
         double result = corrRef->evaluate(formattedInputs);
@@ -103,9 +208,532 @@ double ScaleObject::evaluateJerSF(const std::string& jsonFile,
         }
         return result;
     } catch (const std::exception &e) {
-        std::cerr << "Error: evaluateJerSF for json=" << jsonFile
-                  << " tag=" << correctionTag << ": " << e.what() << std::endl;
+        std::cerr << "Error: evaluateJerSF for tag=" << corrRef->name()
+                  << ": " << e.what() << std::endl;
+        return 1.0;
+    }
+}
+
+double ScaleObject::evaluateFormatted(const correction::Correction::Ref& corrRef,
+                                      const std::vector<CorrType>& formattedInputs,
+                                      const char* caller) const {
+    try {
+        double result = corrRef->evaluate(formattedInputs);
+        if (isDebug_) {
+            std::cout << "[DEBUG] result: " << result << std::endl;
+        }
+        return result;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << caller << " for tag=" << corrRef->name()
+                  << ": " << e.what() << std::endl;
+        return 1.0;
+    }
+}
+
+double ScaleObject::evaluateCompiled(const CompiledCorrection& compiled, const double* inputs,
+                                     const char* caller) const {
+    try {
+        double result = compiled.evaluate(inputs);
+        if (isDebug_) {
+            std::cout << "[DEBUG] result: " << result << std::endl;
+        }
+        return result;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << caller << " for tag=" << compiled.getName()
+                  << ": " << e.what() << std::endl;
         return 1.0;
     }
 }
 
+void ScaleObject::evaluateBatch(const correction::Correction::Ref& corrRef,
+                                const std::vector<const double*>& columns,
+                                std::size_t nJets, double* out) const {
+    const CompiledCorrection* compiled = nullptr;
+    auto itCompiled = compiled_.find(corrRef.get());
+    if (itCompiled != compiled_.end() && itCompiled->second->getNInputs() == columns.size()) {
+        compiled = itCompiled->second.get();
+    }
+    const CorrectionTable* table = nullptr;
+    auto itTable = tables_.find(corrRef.get());
+    if (itTable != tables_.end() && itTable->second->getNInputs() == columns.size()) {
+        table = itTable->second.get();
+    }
+
+    // One input vector for the whole batch: assigning a double to the
+    // double alternative of the variant does not allocate
+    std::vector<CorrType> formattedInputs(columns.size(), 0.0);
+    std::vector<double> inputs(columns.size());
+    for (std::size_t j = 0; j < nJets; ++j) {
+        if (isDebug_) {
+            std::cout << "[DEBUG] tag=" << corrRef->name() << ", jet " << j << ", inputs=[";
+            for (std::size_t k = 0; k < columns.size(); ++k) {
+                std::cout << columns[k][j] << (k + 1 < columns.size() ? ", " : "");
+            }
+            std::cout << "]" << std::endl;
+        }
+        if (table || compiled) {
+            for (std::size_t k = 0; k < columns.size(); ++k) {
+                inputs[k] = columns[k][j];
+            }
+            if (table && table->lookup(inputs.data(), out[j])) continue;
+            if (compiled) {
+                out[j] = evaluateCompiled(*compiled, inputs.data(), "evaluateBatch");
+                continue;
+            }
+        }
+        for (std::size_t k = 0; k < columns.size(); ++k) {
+            std::get<double>(formattedInputs[k]) = columns[k][j];
+        }
+        out[j] = evaluateFormatted(corrRef, formattedInputs, "evaluateBatch");
+    }
+}
+
+void ScaleObject::evaluateFusedBatch(const std::vector<correction::Correction::Ref>& refs,
+                                     const std::vector<const double*>& columns,
+                                     std::size_t nJets, const std::vector<double*>& outs) const {
+    std::vector<const CompiledCorrection*> compiled;
+    for (const auto& corrRef : refs) {
+        compiled.push_back(exact_.at(corrRef.get()).get());
+    }
+
+    std::vector<double> inputs(columns.size());
+    for (std::size_t j = 0; j < nJets; ++j) {
+        for (std::size_t k = 0; k < columns.size(); ++k) {
+            inputs[k] = columns[k][j];
+        }
+        if (isDebug_) {
+            std::cout << "[DEBUG] fused " << refs.size() << " versions of tag=" << refs.front()->name()
+                      << ", jet " << j << ", inputs=[";
+            for (std::size_t k = 0; k < columns.size(); ++k) {
+                std::cout << inputs[k] << (k + 1 < columns.size() ? ", " : "");
+            }
+            std::cout << "]" << std::endl;
+        }
+        int leaf = -1;
+        try {
+            leaf = compiled.front()->findLeaf(inputs.data());
+        } catch (const std::exception &e) {
+            std::cerr << "Error: evaluateFusedBatch for tag=" << refs.front()->name()
+                      << ": " << e.what() << std::endl;
+        }
+        for (std::size_t v = 0; v < compiled.size(); ++v) {
+            outs[v][j] = leaf < 0 ? 1.0 : compiled[v]->evaluateLeaf(leaf, inputs.data());
+        }
+    }
+}
+
+auto ScaleObject::hasBranchFor(const correction::Correction::Ref& corrRef, std::size_t input,
+                               double value) const -> bool {
+    auto it = trees_.find(corrRef.get());
+    return it == trees_.end() || input >= it->second->getNInputs() || it->second->hasBranchFor(input, value);
+}
+
+auto ScaleObject::reducibleInputs(const correction::Correction::Ref& corrRef,
+                                  const std::vector<std::size_t>& candidates) const -> std::vector<std::size_t> {
+    std::vector<std::size_t> inputs;
+    auto itExact = exact_.find(corrRef.get());
+    if (itExact == exact_.end()) return inputs;
+    for (std::size_t input : candidates) {
+        if (input < itExact->second->getNInputs() && itExact->second->isSelectingInput(input) &&
+            !itExact->second->isUniformInput(input)) {
+            inputs.push_back(input);
+        }
+    }
+    return inputs;
+}
+
+void ScaleObject::evaluateBatchReduced(const correction::Correction::Ref& corrRef,
+                                       const std::vector<const double*>& columns,
+                                       const std::vector<std::size_t>& invariant,
+                                       std::size_t nJets, double* out, ReducedCorrections& reduced) const {
+    auto itExact = exact_.find(corrRef.get());
+    if (invariant.empty() || itExact == exact_.end() || tables_.count(corrRef.get()) ||
+        itExact->second->getNInputs() != columns.size()) {
+        evaluateBatch(corrRef, columns, nJets, out);
+        return;
+    }
+    const CompiledCorrection& full = *itExact->second;
+
+    std::vector<double> inputs(columns.size());
+    std::vector<double> bound(invariant.size());
+    std::size_t j = 0;
+    while (j < nJets) {
+        for (std::size_t i = 0; i < invariant.size(); ++i) {
+            bound[i] = columns[invariant[i]][j];
+        }
+        const CompiledCorrection& tree = reduced.get(full, invariant, bound.data());
+
+        // The jets of one event (same rho), or of one run
+        auto isSame = [&](std::size_t jet) {
+            for (std::size_t i = 0; i < invariant.size(); ++i) {
+                if (columns[invariant[i]][jet] != bound[i]) return false;
+            }
+            return true;
+        };
+        do {
+            for (std::size_t k = 0; k < columns.size(); ++k) {
+                inputs[k] = columns[k][j];
+            }
+            if (isDebug_) {
+                std::cout << "[DEBUG] tag=" << corrRef->name() << " (reduced), jet " << j << ", inputs=[";
+                for (std::size_t k = 0; k < columns.size(); ++k) {
+                    std::cout << inputs[k] << (k + 1 < columns.size() ? ", " : "");
+                }
+                std::cout << "]" << std::endl;
+            }
+            out[j] = evaluateCompiled(tree, inputs.data(), "evaluateBatchReduced");
+            ++j;
+        } while (j < nJets && isSame(j));
+    }
+}
+
+void ScaleObject::evaluateJerSFBatch(const correction::Correction::Ref& corrRef,
+                                     const std::vector<const double*>& columns,
+                                     std::size_t nJets, const std::string& syst, double* out) const {
+    // The columns fill the numeric inputs in order, syst the string input
+    const auto& corrInputs = corrRef->inputs();
+    std::vector<CorrType> formattedInputs;
+    std::vector<int> columnOf; // [input] its column, -1 for the string input
+    int nColumns = 0;
+    for (const auto& input : corrInputs) {
+        if (input.type() == correction::VarType::string) {
+            formattedInputs.emplace_back(syst);
+            columnOf.push_back(-1);
+        } else {
+            formattedInputs.emplace_back(0.0);
+            columnOf.push_back(nColumns++);
+        }
+    }
+    if (static_cast<std::size_t>(nColumns) != columns.size()) {
+        throw std::runtime_error("evaluateJerSFBatch: " + std::to_string(columns.size()) +
+                                 " columns for the numeric inputs of " + corrRef->name());
+    }
+
+    const CompiledCorrection* compiled = nullptr;
+    auto itCompiled = compiledBound_.find(std::make_pair(corrRef.get(), syst));
+    if (itCompiled != compiledBound_.end() && itCompiled->second->getNInputs() == corrInputs.size()) {
+        compiled = itCompiled->second.get();
+    }
+    const CorrectionTable* table = nullptr;
+    auto itTable = tablesBound_.find(std::make_pair(corrRef.get(), syst));
+    if (itTable != tablesBound_.end() && itTable->second->getNInputs() == corrInputs.size()) {
+        table = itTable->second.get();
+    }
+
+    // The systematic string is set once for the whole batch; the bound evaluators
+    // ignore the value at its position
+    std::vector<double> inputs(corrInputs.size(), 0.0);
+    for (std::size_t j = 0; j < nJets; ++j) {
+        for (std::size_t k = 0; k < columnOf.size(); ++k) {
+            if (columnOf[k] < 0) continue;
+            inputs[k] = columns[columnOf[k]][j];
+            std::get<double>(formattedInputs[k]) = inputs[k];
+        }
+        if (isDebug_) {
+            std::cout << "[DEBUG] tag=" << corrRef->name() << ", jet " << j << ", inputs=[";
+            for (std::size_t k = 0; k < inputs.size(); ++k) {
+                if (columnOf[k] < 0) std::cout << "'" << syst << "'";
+                else std::cout << inputs[k];
+                std::cout << (k + 1 < inputs.size() ? ", " : "");
+            }
+            std::cout << "]" << std::endl;
+        }
+        if (table && table->lookup(inputs.data(), out[j])) continue;
+        if (compiled) {
+            out[j] = evaluateCompiled(*compiled, inputs.data(), "evaluateJerSFBatch");
+            continue;
+        }
+        out[j] = evaluateFormatted(corrRef, formattedInputs, "evaluateJerSFBatch");
+    }
+}
+
+auto ScaleObject::parseResolved(std::string& contentKey) const
+    -> std::vector<std::pair<correction::Correction::Ref, std::shared_ptr<CompiledCorrection>>> {
+    std::vector<std::pair<std::string, std::string>> resolved;
+    std::unordered_map<std::string, std::string> reducedJsons;
+    {
+        std::lock_guard<std::mutex> lock(correctionSetsMutex_);
+        resolved = resolvedCorrections_;
+        reducedJsons = reducedJsons_;
+    }
+
+    // Parse every JSON file once; the content key covers the files and the tags
+    std::unordered_map<std::string, nlohmann::json> jsons;
+    std::vector<std::pair<correction::Correction::Ref, std::shared_ptr<CompiledCorrection>>> candidates;
+    for (const auto& [jsonFile, tag] : resolved) {
+        // The reduced JSON of the image if the file was preloaded, which also covers .gz files
+        auto itReduced = reducedJsons.find(jsonFile);
+        if (itReduced == reducedJsons.end() &&
+            jsonFile.size() > 3 && jsonFile.compare(jsonFile.size() - 3, 3, ".gz") == 0) {
+            std::cout << "[ScaleObject] CompiledCorrection does not read .gz files, using correctionlib for " << tag << '\n';
+            continue;
+        }
+        auto itJson = jsons.find(jsonFile);
+        if (itJson == jsons.end()) {
+            std::string content;
+            if (itReduced != reducedJsons.end()) {
+                content = itReduced->second;
+            } else {
+                std::ifstream in(jsonFile);
+                std::stringstream buffer;
+                buffer << in.rdbuf();
+                content = buffer.str();
+            }
+            contentKey += content;
+            try {
+                itJson = jsons.emplace(jsonFile, nlohmann::json::parse(content)).first;
+            } catch (const std::exception& e) {
+                std::cerr << "[ScaleObject] Cannot parse " << jsonFile << ": " << e.what() << '\n';
+                continue;
+            }
+        }
+        contentKey += tag;
+
+        try {
+            const auto& corrections = itJson->second.at("corrections");
+            auto itCorr = std::find_if(corrections.begin(), corrections.end(), [&tag](const nlohmann::json& c) {
+                return c.at("name").get<std::string>() == tag;
+            });
+            if (itCorr == corrections.end()) continue;
+            candidates.emplace_back(getCorrectionRef(jsonFile, tag), std::make_shared<CompiledCorrection>(*itCorr));
+        } catch (const std::exception& e) {
+            std::cout << "[ScaleObject] Using correctionlib for " << tag << ": " << e.what() << '\n';
+        }
+    }
+    return candidates;
+}
+
+void ScaleObject::prepareBackends() {
+    if (globalFlags_.getCorrectionBackend() == GlobalFlag::CorrectionBackend::Native) {
+        compileNative();
+    }
+    if (globalFlags_.getLutTolerance() > 0) {
+        buildTables(globalFlags_.getLutTolerance());
+    }
+    hashCorrections();
+}
+
+void ScaleObject::hashCorrections() {
+    std::string contentKey;
+    auto candidates = parseResolved(contentKey);
+
+    // The default backend keeps correctionlib for every jet: no exact evaluators, and
+    // none of their validation at startup
+    const bool keepExact = usesOwnEvaluators();
+    for (const auto& [corrRef, parsed] : candidates) {
+        trees_[corrRef.get()] = parsed;
+        if (!keepExact) continue;
+        if (findStringInput(*parsed) >= 0) continue; // JER SF, evaluated per systematic
+        auto itCompiled = compiled_.find(corrRef.get());
+        if (itCompiled != compiled_.end()) {
+            exact_[corrRef.get()] = itCompiled->second;
+        } else if (validateCompiled(*corrRef, *parsed, -1, "")) {
+            exact_[corrRef.get()] = parsed;
+        }
+    }
+    std::cout << "[ScaleObject] Hashed " << trees_.size() << " corrections, "
+              << exact_.size() << " with an exact evaluator" << '\n';
+}
+
+auto ScaleObject::usesOwnEvaluators() const -> bool {
+    return globalFlags_.getCorrectionBackend() == GlobalFlag::CorrectionBackend::Native ||
+           globalFlags_.getLutTolerance() > 0;
+}
+
+auto ScaleObject::shareVersions(const std::vector<correction::Correction::Ref>& refs) const -> VersionSharing {
+    VersionSharing sharing;
+    sharing.sameAs.assign(refs.size(), -1);
+    std::vector<const CompiledCorrection*> trees(refs.size(), nullptr);
+    for (std::size_t v = 0; v < refs.size(); ++v) {
+        auto it = trees_.find(refs[v].get());
+        if (it != trees_.end()) trees[v] = it->second.get();
+    }
+
+    // The content covers the inputs, so copies also read the same columns. A matching
+    // hash alone is not enough to reuse the values: the trees are compared too.
+    std::vector<std::size_t> distinct;
+    for (std::size_t v = 0; v < refs.size(); ++v) {
+        for (std::size_t u : distinct) {
+            if (trees[v] && trees[u] && trees[v]->sameContent(*trees[u])) {
+                sharing.sameAs[v] = static_cast<int>(u);
+                break;
+            }
+        }
+        if (sharing.sameAs[v] < 0) distinct.push_back(v);
+    }
+
+    // Fusing evaluates with the exact evaluators instead of correctionlib, so only when
+    // -b native or -t asked for them. Tables are faster than any bin search, fusing is
+    // only for exact evaluation.
+    sharing.fused = usesOwnEvaluators() && distinct.size() > 1;
+    for (std::size_t v : distinct) {
+        const auto* corr = refs[v].get();
+        if (!sharing.fused || !exact_.count(corr) || tables_.count(corr) ||
+            !trees[v]->sameStructure(*trees[distinct.front()])) {
+            sharing.fused = false;
+            break;
+        }
+    }
+    return sharing;
+}
+
+void ScaleObject::compileNative() {
+    std::string contentKey;
+    auto candidates = parseResolved(contentKey);
+
+    std::vector<CompiledCorrection*> toCompile;
+    for (const auto& candidate : candidates) {
+        toCompile.push_back(candidate.second.get());
+    }
+    formulaCompiler_ = std::make_unique<FormulaCompiler>();
+    if (!formulaCompiler_->compile(toCompile, contentKey)) {
+        std::cerr << "[ScaleObject] Native compilation failed, using correctionlib for all corrections" << '\n';
+        return;
+    }
+
+    // Keep only what agrees with correctionlib
+    int nRejected = 0;
+    for (const auto& [corrRef, compiled] : candidates) {
+        const int stringInput = findStringInput(*compiled);
+        if (stringInput < 0) {
+            if (validateCompiled(*corrRef, *compiled, -1, "")) compiled_[corrRef.get()] = compiled;
+            else ++nRejected;
+            continue;
+        }
+        for (const std::string syst : boundSysts) {
+            try {
+                auto bound = compiled->bindString(stringInput, syst);
+                if (validateCompiled(*corrRef, *bound, stringInput, syst)) {
+                    compiledBound_[std::make_pair(corrRef.get(), syst)] = bound;
+                } else {
+                    ++nRejected;
+                }
+            } catch (const std::exception& e) {
+                std::cout << "[ScaleObject] Using correctionlib for " << corrRef->name()
+                          << " (" << syst << "): " << e.what() << '\n';
+            }
+        }
+    }
+    std::cout << "[ScaleObject] Native backend: " << compiled_.size() << " corrections, "
+              << compiledBound_.size() << " bound corrections, " << nRejected << " rejected" << '\n';
+}
+
+void ScaleObject::buildTables(double tolerance) {
+    std::string contentKey;
+    auto candidates = parseResolved(contentKey);
+
+    auto addTable = [tolerance](const CompiledCorrection& exact, const std::string& label,
+                                std::unique_ptr<CorrectionTable>& slot) {
+        auto table = std::make_unique<CorrectionTable>(exact, tolerance);
+        if (!table->isValid()) {
+            std::cout << "[ScaleObject] No table for " << label << ", evaluating exactly" << '\n';
+            return;
+        }
+        std::cout << "[ScaleObject] Table for " << label << ": " << table->getNPoints() << " points, max rel. error "
+                  << table->getMaxError() << " at the test points, " << 100.0 * table->getExactFraction()
+                  << "% of cells exact" << '\n';
+        slot = std::move(table);
+    };
+
+    std::cout << "[ScaleObject] Lookup tables with tolerance " << tolerance
+              << ": the bound is empirical, checked at test points of each cell, not guaranteed" << '\n';
+    for (const auto& [corrRef, parsed] : candidates) {
+        const int stringInput = findStringInput(*parsed);
+        if (stringInput < 0) {
+            // Tabulate the native correction when there is one, it is already validated
+            auto itCompiled = compiled_.find(corrRef.get());
+            if (itCompiled != compiled_.end()) {
+                addTable(*itCompiled->second, corrRef->name(), tables_[corrRef.get()]);
+            } else if (validateCompiled(*corrRef, *parsed, -1, "")) {
+                addTable(*parsed, corrRef->name(), tables_[corrRef.get()]);
+            }
+            continue;
+        }
+        for (const std::string syst : boundSysts) {
+            const auto key = std::make_pair(corrRef.get(), syst);
+            const std::string label = corrRef->name() + " (" + syst + ")";
+            try {
+                auto itCompiled = compiledBound_.find(key);
+                if (itCompiled != compiledBound_.end()) {
+                    addTable(*itCompiled->second, label, tablesBound_[key]);
+                    continue;
+                }
+                auto bound = parsed->bindString(stringInput, syst);
+                if (validateCompiled(*corrRef, *bound, stringInput, syst)) {
+                    addTable(*bound, label, tablesBound_[key]);
+                }
+            } catch (const std::exception& e) {
+                std::cout << "[ScaleObject] No table for " << label << ": " << e.what() << '\n';
+            }
+        }
+    }
+    // Drop the empty slots, so that lookups only find usable tables
+    for (auto it = tables_.begin(); it != tables_.end();) {
+        it = it->second ? std::next(it) : tables_.erase(it);
+    }
+    for (auto it = tablesBound_.begin(); it != tablesBound_.end();) {
+        it = it->second ? std::next(it) : tablesBound_.erase(it);
+    }
+}
+
+bool ScaleObject::validateCompiled(const correction::Correction& corr, const CompiledCorrection& compiled,
+                                 int stringInput, const std::string& stringValue) const {
+    const std::size_t nInputs = compiled.getNInputs();
+    std::vector<std::pair<double, double>> ranges(nInputs);
+    std::vector<bool> logScale(nInputs, false);
+    for (std::size_t i = 0; i < nInputs; ++i) {
+        bool logInput = false;
+        auto range = compiled.getInputRange(i);
+        if (range.first <= range.second) {
+            // Go beyond the outer edges to exercise the flow behaviour
+            const double width = range.second - range.first;
+            range = {range.first - 0.1 * width, range.second + 0.1 * width};
+        } else {
+            range = CompiledCorrection::typicalRange(compiled.getInputNames()[i], logInput);
+        }
+        logScale[i] = logInput;
+        ranges[i] = range;
+    }
+
+    // Fixed seed: the same inputs in every job
+    std::mt19937_64 rng(20240101);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<CorrType> formattedInputs(nInputs, 0.0);
+    std::vector<double> inputs(nInputs, 0.0);
+    const int nSamples = 1000;
+    for (int n = 0; n < nSamples; ++n) {
+        for (std::size_t i = 0; i < nInputs; ++i) {
+            if (static_cast<int>(i) == stringInput) {
+                formattedInputs[i] = stringValue;
+                continue;
+            }
+            const auto& [low, high] = ranges[i];
+            double value = logScale[i] ? low * std::pow(high / low, uniform(rng))
+                                       : low + (high - low) * uniform(rng);
+            if (compiled.isIntInput(i)) {
+                value = std::round(value);
+                formattedInputs[i] = static_cast<int>(value);
+            } else {
+                formattedInputs[i] = value;
+            }
+            inputs[i] = value;
+        }
+
+        double expected = 0.0, result = 0.0;
+        bool expectedThrew = false, resultThrew = false;
+        try { expected = corr.evaluate(formattedInputs); } catch (const std::exception&) { expectedThrew = true; }
+        try { result = compiled.evaluate(inputs.data()); } catch (const std::exception&) { resultThrew = true; }
+
+        const bool agree = (expectedThrew == resultThrew) &&
+            (expectedThrew || expected == result || (std::isnan(expected) && std::isnan(result)) ||
+             std::fabs(expected - result) <= 1e-9 * std::max(1.0, std::fabs(expected)));
+        if (!agree) {
+            std::cerr << "[ScaleObject] Native " << corr.name()
+                      << (stringInput >= 0 ? " (" + stringValue + ")" : std::string())
+                      << " disagrees with correctionlib: " << result << " vs " << expected
+                      << ", using correctionlib" << '\n';
+            return false;
+        }
+    }
+    return true;
+}
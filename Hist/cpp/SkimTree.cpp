@@ -5,6 +5,9 @@
 #include <algorithm>
 #include "SkimTree.h"
 #include "Helper.h"
+#include "InputFileIndex.h"
+
+#include <filesystem>
 
 SkimTree::SkimTree(GlobalFlag& globalFlags): 
     globalFlags_(globalFlags),
@@ -128,6 +131,12 @@ void SkimTree::loadJobFileNames() {
     int nFiles = static_cast<int>(loadedAllFileNames_.size());
     std::cout << "Total files = " << nFiles << '\n';
 
+    if (loadAllFileEntries()) {
+        splitJobByEntries();
+        return;
+    }
+    std::cout << "Entries per file unknown, splitting by number of files" << '\n';
+
     if (loadedTotJob_ > nFiles) {
         std::cout << "Since loadedTotJob_ > nFiles, setting loadedTotJob_ to nFiles: " << nFiles << '\n';
         loadedTotJob_ = nFiles;
@@ -151,6 +160,87 @@ void SkimTree::loadJobFileNames() {
     loadedJobFileNames_ = smallVectors[loadedNthJob_ - 1];
 }
 
+bool SkimTree::loadAllFileEntries() {
+    loadedAllFileEntries_.clear();
+
+    // 1. EntriesNano_<channel>_<year>.json, written by getRootFiles.py next to FilesNano
+    std::string entriesPath = inputJsonPath_;
+    const auto pos = entriesPath.rfind("FilesNano_");
+    if (pos != std::string::npos) {
+        entriesPath.replace(pos, std::string("FilesNano_").size(), "EntriesNano_");
+        std::ifstream fileName(entriesPath);
+        if (fileName.is_open()) {
+            try {
+                nlohmann::json js;
+                fileName >> js;
+                const auto& entries = js.at(loadedSampKey_);
+                for (const auto& name : loadedAllFileNames_) {
+                    loadedAllFileEntries_.push_back(entries.at(name).get<Long64_t>());
+                }
+                std::cout << "+ Entries per file from " << entriesPath << '\n';
+                return true;
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: incomplete " << entriesPath << ": " << e.what() << '\n';
+                loadedAllFileEntries_.clear();
+            }
+        }
+    }
+
+    // 2. Checks of previous runs, if every file of the sample was seen
+    const auto fileIndex = fileIndex_ ? fileIndex_ : std::make_shared<InputFileIndex>();
+    for (const auto& name : loadedAllFileNames_) {
+        std::optional<InputFileInfo> info = fileIndex->find(eosPrefix + name);
+        if (!info) info = fileIndex->find(xrootdPrefix + name);
+        if (!info) {
+            loadedAllFileEntries_.clear();
+            return false;
+        }
+        loadedAllFileEntries_.push_back(info->valid ? info->entries : 0);
+    }
+    std::cout << "+ Entries per file from the input file cache" << '\n';
+    return true;
+}
+
+void SkimTree::splitJobByEntries() {
+    if (loadedNthJob_ < 1 || loadedNthJob_ > loadedTotJob_) {
+        throw std::runtime_error("Error: Make sure 0 < loadedNthJob_ <= loadedTotJob_ in loadJobFileNames()");
+    }
+    std::cout << "Jobs: " << loadedNthJob_ << " of " << loadedTotJob_ << ", split by entries" << '\n';
+    Long64_t total = 0;
+    for (Long64_t entries : loadedAllFileEntries_) total += entries;
+
+    // Job N of M gets entries [total*(N-1)/M, total*N/M) of the concatenated files
+    const Long64_t first = total * (loadedNthJob_ - 1) / loadedTotJob_;
+    const Long64_t last  = total * loadedNthJob_ / loadedTotJob_;
+    loadedJobFileNames_.clear();
+    Long64_t fileStart = 0;
+    for (std::size_t i = 0; i < loadedAllFileNames_.size(); ++i) {
+        const Long64_t fileEnd = fileStart + loadedAllFileEntries_[i];
+        if (fileEnd > first && fileStart < last) {
+            if (loadedJobFileNames_.empty()) jobFirstInFile_ = first - fileStart;
+            loadedJobFileNames_.push_back(loadedAllFileNames_[i]);
+            jobLastInFile_ = std::min(last, fileEnd) - fileStart;
+        }
+        fileStart = fileEnd;
+    }
+    splitByEntries_ = true;
+    std::cout << "Job entries [" << first << ", " << last << ") of " << total
+              << " in " << loadedJobFileNames_.size() << " files" << '\n';
+    if (loadedJobFileNames_.empty()) {
+        throw std::runtime_error("Error: no entries for this job in loadJobFileNames()");
+    }
+}
+
+auto SkimTree::getJobFirstEntry() const -> Long64_t {
+    if (jetCache_) return 0; // the cache holds the job range only
+    return jobFirstEntry_;
+}
+
+auto SkimTree::getJobLastEntry() const -> Long64_t {
+    if (jetCache_) return jetCache_->getNEvents();
+    return jobLastEntry_ < 0 ? getEntries() : jobLastEntry_;
+}
+
 void SkimTree::loadTree() {
     std::cout << "==> loadTree()" << '\n';
     if (!fChain_) {
@@ -162,136 +252,362 @@ void SkimTree::loadTree() {
         throw std::runtime_error("Error: No files to load in loadTree()");
     }
 
-    bool isCopy = false;  // Set to true if you want to copy files locally
-    std::string dir = "root://cms-xrd-global.cern.ch/";  // Default remote directory
-
     int totalFiles = 0;
     int addedFiles = 0;
     int failedFiles = 0;
-
-    // Optimization parameters for xrdcp
-    const int streams = 15;              // Number of parallel data streams
-    const int tcpBufSize = 1048576;      // TCP buffer size (1MB)
+    std::vector<std::string> fullPaths;
 
     for (const auto& fileName : loadedJobFileNames_) {
         totalFiles++;
-        std::string fullPath;
+        // Local EOS path if mounted, remote otherwise
+        const std::string eosPath = eosPrefix + fileName;
+        fullPaths.push_back(std::filesystem::exists(eosPath) ? eosPath : xrootdPrefix + fileName);
+    }
 
-        if (isCopy) {
-            // Extract the local file name from the remote path
-            std::string localFile = fileName.substr(fileName.find_last_of('/') + 1);
-            std::string cmd = "xrdcp ";
+    // Open every file once, concurrently, reusing the checks of previous runs; a shared
+    // index is saved by its owner
+    const auto fileIndex = fileIndex_ ? fileIndex_ : std::make_shared<InputFileIndex>();
+    const auto infos = fileIndex->validate(fullPaths, nValidationWorkers);
+    if (!fileIndex_) fileIndex->save();
 
-            // Append optimization options to the xrdcp command
-            cmd += "--streams " + std::to_string(streams) + " ";
+    Long64_t totalEntries = 0;
+    for (const auto& info : infos) {
+        if (!info.valid) {
+            std::cerr << "Error: " << info.error << " for " << info.path << '\n';
+            failedFiles++;
+            continue;  // Skip adding this file
+        }
 
-            // Construct the full remote path
-            std::string remoteFile = dir + fileName;
+        // The entries are known: TChain::Add does not open the file again
+        int added = fChain_->Add(info.path.c_str(), info.entries);
+        if (added == 0) {
+            std::cerr << "Warning: TChain::Add failed for " << info.path << '\n';
+            failedFiles++;
+            continue;  // Skip adding this file
+        }
 
-            // Build the final command
-            cmd += remoteFile + " " + localFile;
+        totalEntries += info.entries;
+        std::cout << info.path << "  Entries: " << totalEntries << '\n';
+        loadedTreeFiles_.emplace_back(info.path, info.entries);
+        addedFiles++;
+    }
+    std::cout << "Files: " << addedFiles << " added, " << failedFiles << " failed out of " << totalFiles << '\n';
+
+    // Job range in chain coordinates. The partial first/last files only count if they
+    // were added; entries beyond the actual file size are clamped.
+    jobFirstEntry_ = 0;
+    jobLastEntry_ = totalEntries;
+    if (splitByEntries_ && !loadedTreeFiles_.empty()) {
+        auto isFile = [](const std::string& path, const std::string& fileName) {
+            const std::string base = fileName.substr(fileName.find_last_of('/') + 1);
+            return path.size() >= base.size() && path.compare(path.size() - base.size(), base.size(), base) == 0;
+        };
+        const auto& [firstPath, firstEntries] = loadedTreeFiles_.front();
+        const auto& [lastPath, lastEntries] = loadedTreeFiles_.back();
+        if (isFile(firstPath, loadedJobFileNames_.front())) {
+            jobFirstEntry_ = std::min(jobFirstInFile_, firstEntries);
+        }
+        if (isFile(lastPath, loadedJobFileNames_.back())) {
+            jobLastEntry_ = totalEntries - lastEntries + std::min(jobLastInFile_, lastEntries);
+        }
+        jobLastEntry_ = std::max(jobLastEntry_, jobFirstEntry_);
+    }
+    std::cout << "Job entries in the chain: [" << jobFirstEntry_ << ", " << jobLastEntry_ << ")" << '\n';
 
-            std::cout << "Executing command: " << cmd << '\n';
-            int ret = system(cmd.c_str());
+    setBranches();
+}
 
-            if (ret != 0) {
-                std::cerr << "Error: Failed to copy " << remoteFile << " to local file " << localFile << '\n';
-                failedFiles++;
-                continue;  // Skip adding this file
-            }
+void SkimTree::activateBranches(const std::vector<std::string>& branches) {
+    activeBranches_ = branches;
+    if (jetCache_) return; // no ROOT I/O, the cache holds all columns
+    if (fChain_->GetNtrees() == 0) return; // staging: applied to each file as it arrives
+    std::cout << "==> activateBranches()" << '\n';
+    setBranches();
+}
 
-            // Check if the file was successfully copied
-            if (!std::filesystem::exists(localFile)) {
-                std::cerr << "Error: Local file " << localFile << " does not exist after copying.\n";
-                failedFiles++;
-                continue;  // Skip adding this file
-            }
+auto SkimTree::isBranchActive(const std::string& branch) const -> bool {
+    return activeBranches_.empty() ||
+           std::find(activeBranches_.begin(), activeBranches_.end(), branch) != activeBranches_.end();
+}
 
-            fullPath = localFile;  // Use the local file path
-        } else {
-            // Remote file handling
-            std::filesystem::path filePath = "/eos/cms/" + fileName;
-            if (std::filesystem::exists(filePath)) {
-                dir = "/eos/cms/";  // Use local EOS path
-                fullPath = dir + fileName;
-            } else {
-                dir = "root://cms-xrd-global.cern.ch/";  // Fallback to remote
-                fullPath = dir + fileName;
+void SkimTree::setBranches() {
+    fChain_->SetBranchStatus("*", false);
+    fChain_->ResetBranchAddresses();
+
+    // Always read: event id and the jet pt/eta used for the selection and binning
+    const std::vector<std::pair<std::string, void*>> alwaysOn = {
+        {"run", &run},
+        {"luminosityBlock", &luminosityBlock},
+        {"event", &event},
+        {"nJet", &nJet},
+        {"Jet_pt", &Jet_pt},
+        {"Jet_eta", &Jet_eta},
+    };
+    for (const auto& [name, address] : alwaysOn) {
+        fChain_->SetBranchStatus(name.c_str(), true);
+        fChain_->SetBranchAddress(name.c_str(), address);
+    }
+
+    // Read only if a correction consumes them (or no selection was given)
+    const std::vector<std::pair<std::string, void*>> optional = {
+        {"Jet_area", &Jet_area},
+        {"Jet_phi", &Jet_phi},
+        {"Jet_mass", &Jet_mass},
+        {"Jet_rawFactor", &Jet_rawFactor},
+        {"Jet_jetId", &Jet_jetId},
+        {"Rho", &Rho},
+    };
+    // A selected branch must be one of the above
+    for (const auto& name : activeBranches_) {
+        const auto isNamed = [&name](const std::pair<std::string, void*>& known) { return known.first == name; };
+        if (std::none_of(alwaysOn.begin(), alwaysOn.end(), isNamed) &&
+            std::none_of(optional.begin(), optional.end(), isNamed)) {
+            throw std::runtime_error("SkimTree::setBranches: branch " + name + " cannot be read into the event loop");
+        }
+    }
+    std::size_t nActive = alwaysOn.size();
+    for (const auto& [name, address] : optional) {
+        if (!isBranchActive(name)) continue;
+        // "Rho" is the rho branch of the year
+        const std::string branch = (name == "Rho") ? getRhoBranchName() : name;
+        if (!fChain_->GetBranch(branch.c_str())) {
+            // A correction reads it: evaluating it at 0 would be silently wrong
+            if (!activeBranches_.empty()) {
+                throw std::runtime_error("SkimTree::setBranches: branch " + branch + " (" + name +
+                                         ") is needed by a correction but not found in the input");
             }
+            std::cerr << "Warning: branch " << branch << " not found, " << name << " is 0" << '\n';
+            continue;
         }
+        fChain_->SetBranchStatus(branch.c_str(), true);
+        fChain_->SetBranchAddress(branch.c_str(), address);
+        if (name == "Rho") std::cout << "+ Rho read from " << branch << '\n';
+        ++nActive;
+    }
+    std::cout << "+ Reading " << nActive << " branches" << '\n';
+}
 
-        // Attempt to open the file to verify its validity
-        TFile* f = TFile::Open(fullPath.c_str(), "READ");
-        if (!f || f->IsZombie()) {
-            std::cerr << "Error: Failed to open or corrupted file " << fullPath << '\n';
-            if (f) f->Close();
-            failedFiles++;
-            continue;  // Skip adding this file
+auto SkimTree::loadStageRequests() const -> std::vector<StageRequest> {
+    std::vector<StageRequest> requests;
+    for (const auto& fileName : loadedJobFileNames_) {
+        StageRequest request;
+        request.name = fileName;
+        requests.push_back(request);
+    }
+
+    // ChecksumsNano_<channel>_<year>.json, written by getRootFiles.py next to FilesNano
+    std::string checksumsPath = inputJsonPath_;
+    const auto pos = checksumsPath.rfind("FilesNano_");
+    if (pos == std::string::npos) return requests;
+    checksumsPath.replace(pos, std::string("FilesNano_").size(), "ChecksumsNano_");
+    std::ifstream fileName(checksumsPath);
+    if (!fileName.is_open()) {
+        std::cout << "No " << checksumsPath << ": staged files are not verified" << '\n';
+        return requests;
+    }
+    try {
+        nlohmann::json js;
+        fileName >> js;
+        const auto& checksums = js.at(loadedSampKey_);
+        int nKnown = 0;
+        for (auto& request : requests) {
+            auto it = checksums.find(request.name);
+            if (it == checksums.end()) continue;
+            request.size = it->at("size").get<Long64_t>();
+            request.adler32 = it->at("adler32").get<std::string>();
+            nKnown++;
         }
+        std::cout << "+ Size and adler32 of " << nKnown << " files from " << checksumsPath << '\n';
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: ignoring " << checksumsPath << ": " << e.what() << '\n';
+    }
+    return requests;
+}
 
-        // Check if "Events" tree exists
-        if (!f->GetListOfKeys()->Contains("Events")) {
-            std::cerr << "Error: 'Events' not found in " << fullPath << '\n';
-            f->Close();
-            failedFiles++;
-            continue;  // Skip adding this file
+void SkimTree::startStaging(const FileStager::Config& config) {
+    std::cout << "==> startStaging()" << '\n';
+    if (loadedJobFileNames_.empty()) {
+        throw std::runtime_error("Error: No files to stage in startStaging()");
+    }
+    stager_ = std::make_unique<FileStager>(loadStageRequests(), config);
+    stager_->start();
+}
+
+auto SkimTree::nextStagedFile() -> bool {
+    if (hasStagedFile_) {
+        stager_->release(stagedIndex_);
+        hasStagedFile_ = false;
+    }
+
+    StagedFile file;
+    while (stager_->next(file)) {
+        // The file is local now, opening it is cheap
+        Long64_t entries = 0;
+        {
+            std::unique_ptr<TFile> f(TFile::Open(file.localPath.c_str(), "READ"));
+            auto* tree = (f && !f->IsZombie()) ? f->Get<TTree>("Events") : nullptr;
+            if (tree) entries = tree->GetEntries();
+        }
+        if (entries <= 0) {
+            std::cerr << "Error: no 'Events' entries in staged file " << file.localPath << '\n';
+            stager_->release(file.index);
+            stagedFailed_++;
+            continue;
         }
 
-        // Check the entries in the newly added TTree
-        Long64_t fileEntries = f->Get<TTree>("Events")->GetEntries();
-        if (fileEntries == 0) {
-            std::cerr << "\nWarning: 'Events' TTree in file " << fullPath << " has 0 entries. Skipping file.\n\n";
-            f->Close();
-            failedFiles++;
-            continue;  // Skip adding this file to the final count
+        fChain_ = std::make_unique<TChain>("Events");
+        fChain_->SetCacheSize(100 * 1024 * 1024);
+        fChain_->Add(file.localPath.c_str(), entries);
+        fCurrent_ = -1;
+        loadedTreeFiles_.assign(1, {file.localPath, entries});
+
+        // The partial first/last files of a job split by entries
+        jobFirstEntry_ = 0;
+        jobLastEntry_ = entries;
+        if (splitByEntries_) {
+            if (file.index == 0) jobFirstEntry_ = std::min(jobFirstInFile_, entries);
+            if (file.index + 1 == stager_->getNRequests()) jobLastEntry_ = std::min(jobLastInFile_, entries);
+            jobLastEntry_ = std::max(jobLastEntry_, jobFirstEntry_);
         }
+        stagedIndex_ = file.index;
+        hasStagedFile_ = true;
+        stagedProcessed_++;
+        std::cout << "\nProcessing staged file " << stagedProcessed_ << "/" << stager_->getNRequests()
+                  << ": " << file.localPath << ", entries [" << jobFirstEntry_ << ", " << jobLastEntry_ << ")" << '\n';
+        setBranches();
+        return true;
+    }
+    std::cout << "Files: " << stagedProcessed_ << " processed, " << stager_->getNFailed() + stagedFailed_
+              << " failed out of " << stager_->getNRequests() << '\n';
+    return false;
+}
 
-        // File is valid, add it to the TChain
-        int added = fChain_->Add(fullPath.c_str());
-        if (added == 0) {
-            std::cerr << "Warning: TChain::Add failed for " << fullPath << '\n';
-            f->Close();
-            failedFiles++;
-            continue;  // Skip adding this file
+auto SkimTree::getRhoBranchName() const -> std::string {
+    // Run 2 NanoAOD: fixedGridRhoFastjetAll, Run 3: Rho_fixedGridRhoFastjetAll
+    if (year_ == GlobalFlag::Year::Year2016Pre || year_ == GlobalFlag::Year::Year2016Post ||
+        year_ == GlobalFlag::Year::Year2017 || year_ == GlobalFlag::Year::Year2018) {
+        return "fixedGridRhoFastjetAll";
+    }
+    return "Rho_fixedGridRhoFastjetAll";
+}
+
+auto SkimTree::getJobFilesHash() const -> std::uint64_t {
+    std::string names;
+    for (const auto& fileName : loadedJobFileNames_) {
+        names += fileName + "\n";
+    }
+    if (splitByEntries_) {
+        names += std::to_string(jobFirstInFile_) + ":" + std::to_string(jobLastInFile_);
+    }
+    return Helper::fnv1aHash(names);
+}
+
+void SkimTree::loadJetCache(const std::string& cachePath) {
+    std::cout << "==> loadJetCache()" << '\n';
+    if (!JetColumnCache::isUsable(cachePath, getJobFilesHash())) {
+        std::cout << "No usable jet cache at " << cachePath << ", building it" << '\n';
+        loadTree();
+        buildJetCache(cachePath);
+    }
+    jetCache_ = std::make_shared<const JetColumnCache>(cachePath);
+}
+
+void SkimTree::buildJetCache(const std::string& cachePath) {
+    // Only the entries of this job are cached
+    JetColumnCache::Writer writer(cachePath, getJobFilesHash());
+    const Long64_t firstEntry = getJobFirstEntry();
+    const Long64_t nentries = getJobLastEntry() - firstEntry;
+    double totalTime = 0.0;
+    auto startClock = std::chrono::high_resolution_clock::now();
+    Helper::initProgress(nentries);
+    for (Long64_t jentry = firstEntry; jentry < firstEntry + nentries; ++jentry) {
+        Helper::printProgress(jentry - firstEntry, nentries, startClock, totalTime);
+        if (fChain_->GetEntry(jentry) <= 0) {
+            throw std::runtime_error("Error: failed to read entry " + std::to_string(jentry) + " in buildJetCache()");
         }
+        const UInt_t nJetSaved = static_cast<UInt_t>(nJet < nJetMax ? nJet : nJetMax);
+        writer.fill(run, luminosityBlock, event, Rho, nJetSaved,
+                    Jet_pt, Jet_eta, Jet_phi, Jet_mass, Jet_area, Jet_rawFactor, Jet_jetId);
+    }
+    writer.close();
+}
 
-        std::cout << fullPath << "  Entries: " << fChain_->GetEntries() << '\n';
-        addedFiles++;
-        f->Close();
+auto SkimTree::cloneForSlice(int nthJob) const -> std::unique_ptr<SkimTree> {
+    auto slice = std::make_unique<SkimTree>(globalFlags_);
+    slice->loadedSampKey_ = loadedSampKey_;
+    slice->loadedNthJob_ = nthJob;
+    slice->loadedTotJob_ = loadedTotJob_;
+    slice->outName_ = loadedSampKey_ + "_Hist_" + std::to_string(nthJob) + "of" + std::to_string(loadedTotJob_) + ".root";
+    slice->inputJsonPath_ = inputJsonPath_;
+    slice->loadedAllFileNames_ = loadedAllFileNames_;
+    slice->fileIndex_ = fileIndex_;
+    return slice;
+}
+
+auto SkimTree::cloneForWorker() const -> std::unique_ptr<SkimTree> {
+    auto worker = std::make_unique<SkimTree>(globalFlags_);
+    worker->outName_ = outName_;
+    worker->loadedSampKey_ = loadedSampKey_;
+    worker->loadedNthJob_ = loadedNthJob_;
+    worker->loadedTotJob_ = loadedTotJob_;
+    worker->loadedTreeFiles_ = loadedTreeFiles_;
+    worker->activeBranches_ = activeBranches_;
+
+    // The mapped cache is read-only: workers share it
+    if (jetCache_) {
+        worker->jetCache_ = jetCache_;
+        return worker;
     }
 
-    fChain_->SetBranchStatus("*", false);
-    fChain_->SetBranchStatus("run", true);
-    fChain_->SetBranchStatus("luminosityBlock", true);
-    fChain_->SetBranchStatus("event", true);
-
-    fChain_->SetBranchAddress("run", &run);
-    fChain_->SetBranchAddress("luminosityBlock", &luminosityBlock);
-    fChain_->SetBranchAddress("event", &event);
-
-	//--------------------------------------- 
-	//Jet for all channels 
-	//--------------------------------------- 
-	fChain_->SetBranchStatus("nJet", true); 
-	fChain_->SetBranchStatus("Jet_area", true); 
-	fChain_->SetBranchStatus("Jet_eta"     , true); 
-	fChain_->SetBranchStatus("Jet_mass"    , true); 
-	fChain_->SetBranchStatus("Jet_phi"     , true); 
-	fChain_->SetBranchStatus("Jet_pt"    , true); 
-	fChain_->SetBranchStatus("Jet_rawFactor", true); 
-	fChain_->SetBranchStatus("Jet_jetId", true); 
-
-	fChain_->SetBranchAddress("nJet", &nJet);
-	fChain_->SetBranchAddress("Jet_area", &Jet_area);
-	fChain_->SetBranchAddress("Jet_eta"     , &Jet_eta);
-	fChain_->SetBranchAddress("Jet_mass"    , &Jet_mass);
-	fChain_->SetBranchAddress("Jet_phi"     , &Jet_phi);
-	fChain_->SetBranchAddress("Jet_pt"    , &Jet_pt);
-	fChain_->SetBranchAddress("Jet_rawFactor", &Jet_rawFactor);
-	fChain_->SetBranchAddress("Jet_jetId", &Jet_jetId);
+    // Files were validated by loadTree(), pass the entries so they are not scanned again
+    worker->fChain_->SetCacheSize(100 * 1024 * 1024);
+    for (const auto& [path, nEntries] : loadedTreeFiles_) {
+        worker->fChain_->Add(path.c_str(), nEntries);
+    }
+    worker->setBranches();
+    return worker;
+}
+
+auto SkimTree::getClusterRanges(Long64_t minEntries) -> std::vector<std::pair<Long64_t, Long64_t>> {
+    std::vector<std::pair<Long64_t, Long64_t>> ranges;
+    if (jetCache_) {
+        // Cache blocks play the role of the clusters
+        const auto starts = jetCache_->getBlockStarts();
+        Long64_t rangeStart = 0;
+        for (std::size_t b = 1; b < starts.size(); ++b) {
+            if (starts[b] - rangeStart >= minEntries || b + 1 == starts.size()) {
+                ranges.emplace_back(rangeStart, starts[b]);
+                rangeStart = starts[b];
+            }
+        }
+        return ranges;
+    }
+    Long64_t offset = 0;
+    for (const auto& [path, nEntries] : loadedTreeFiles_) {
+        if (fChain_->LoadTree(offset) < 0) {
+            throw std::runtime_error("Error: LoadTree failed for " + path + " in getClusterRanges()");
+        }
+        TTree* tree = fChain_->GetTree();
+        auto clusterIter = tree->GetClusterIterator(0);
+        Long64_t rangeStart = 0;
+        Long64_t clusterStart = 0;
+        while ((clusterStart = clusterIter()) < nEntries) {
+            Long64_t clusterEnd = std::min(clusterIter.GetNextEntry(), nEntries);
+            if (clusterEnd - rangeStart >= minEntries) {
+                ranges.emplace_back(offset + rangeStart, offset + clusterEnd);
+                rangeStart = clusterEnd;
+            }
+        }
+        if (rangeStart < nEntries) {
+            ranges.emplace_back(offset + rangeStart, offset + nEntries);
+        }
+        offset += nEntries;
+    }
+    return ranges;
 }
 
 auto SkimTree::getEntries() const -> Long64_t {
+    if (jetCache_) return jetCache_->getNEvents();
     return fChain_ ? fChain_->GetEntries() : 0;
 }
 
@@ -300,11 +616,29 @@ auto SkimTree::getChain() const -> TChain* {
 }
 
 auto SkimTree::getEntry(Long64_t entry) -> Int_t {
+    if (jetCache_) {
+        // Same accessors as with the chain: copy the event into the branch buffers
+        const JetColumnCache::EventView ev = jetCache_->getEvent(entry);
+        run = ev.run;
+        luminosityBlock = ev.luminosityBlock;
+        event = ev.event;
+        Rho = ev.rho;
+        nJet = static_cast<Int_t>(std::min<UInt_t>(ev.nJet, nJetMax));
+        std::copy(ev.pt, ev.pt + nJet, Jet_pt);
+        std::copy(ev.eta, ev.eta + nJet, Jet_eta);
+        std::copy(ev.phi, ev.phi + nJet, Jet_phi);
+        std::copy(ev.mass, ev.mass + nJet, Jet_mass);
+        std::copy(ev.area, ev.area + nJet, Jet_area);
+        std::copy(ev.rawFactor, ev.rawFactor + nJet, Jet_rawFactor);
+        std::copy(ev.jetId, ev.jetId + nJet, Jet_jetId);
+        return 1;
+    }
     return fChain_ ? fChain_->GetEntry(entry) : 0;
 }
 
 auto SkimTree::loadEntry(Long64_t entry) -> Long64_t {
     // Set the environment to read one entry
+    if (jetCache_) return entry;
     if (!fChain_) {
         throw std::runtime_error("Error: fChain_ is not initialized in loadEntry()");
     }
@@ -0,0 +1,135 @@
+#include "SliceDriver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include <unistd.h>
+
+#include <TFile.h>
+
+#include "CorrectionPlan.h"
+#include "Helper.h"
+#include "InputFileIndex.h"
+#include "RunChannel.h"
+#include "ScaleObject.h"
+#include "SkimTree.h"
+
+SliceDriver::SliceDriver(GlobalFlag& globalFlags, std::string sampKey, int nSlices)
+    : globalFlags_(globalFlags), sampKey_(std::move(sampKey)), nSlices_(nSlices) {
+    if (nSlices_ < 1) {
+        throw std::runtime_error("SliceDriver: the number of slices must be positive");
+    }
+}
+
+// Out of line: the members are incomplete types in the header
+SliceDriver::~SliceDriver() = default;
+
+auto SliceDriver::parseSlices(const std::string& list, int nSlices) -> std::vector<int> {
+    std::vector<int> slices;
+    for (const auto& item : Helper::splitString(list, ",")) {
+        if (item.empty()) continue;
+        const auto dash = item.find('-');
+        const int first = std::stoi(item.substr(0, dash));
+        const int last = (dash == std::string::npos) ? first : std::stoi(item.substr(dash + 1));
+        if (first < 1 || last > nSlices || first > last) {
+            throw std::runtime_error("SliceDriver: invalid slice range '" + item + "' for " +
+                                     std::to_string(nSlices) + " slices");
+        }
+        for (int n = first; n <= last; ++n) {
+            slices.push_back(n);
+        }
+    }
+    std::sort(slices.begin(), slices.end());
+    slices.erase(std::unique(slices.begin(), slices.end()), slices.end());
+    return slices;
+}
+
+void SliceDriver::prepare(const std::string& jsonDir, const MetadataRegistry& registry) {
+    // The input file list, read once, and the file checks, shared by the slices
+    fileIndex_ = std::make_shared<InputFileIndex>();
+    sample_ = std::make_unique<SkimTree>(globalFlags_);
+    sample_->setFileIndex(fileIndex_);
+    sample_->setInput(sampKey_ + "_Hist_1of" + std::to_string(nSlices_) + ".root");
+    sample_->loadInput();
+    sample_->setInputJsonPath(jsonDir);
+    sample_->loadInputJson();
+
+    // The correction sets and the plan, loaded once and read-only afterwards
+    scaleObject_ = std::make_unique<ScaleObject>(globalFlags_);
+    plan_ = std::make_unique<CorrectionPlan>(registry, *scaleObject_, InputBranchMap());
+    scaleObject_->prepareBackends();
+    plan_->specialize(*scaleObject_);
+    plan_->printPlan();
+}
+
+auto SliceDriver::runSlice(int nthJob, const std::string& outDir) const -> bool {
+    if (!plan_) {
+        throw std::runtime_error("SliceDriver: call prepare() before runSlice()");
+    }
+    std::unique_ptr<SkimTree> skimT = sample_->cloneForSlice(nthJob);
+    const std::string outPath = outDir + "/" + skimT->getOutName();
+    // A crash leaves only the temporary file behind; unique per process, as a chunk
+    // taken from a silent worker may still be written by it
+    const std::string tmpPath = outPath + ".part" + std::to_string(::getpid());
+    try {
+        skimT->loadJobFileNames();
+        skimT->loadTree();
+        auto fout = std::make_unique<TFile>(tmpPath.c_str(), "RECREATE");
+        if (!fout || fout->IsZombie()) {
+            throw std::runtime_error("cannot create " + tmpPath);
+        }
+        RunChannel runCh(globalFlags_);
+        runCh.setShowProgress(false);
+        runCh.Run(*skimT, *plan_, *scaleObject_, fout.get());
+        fout->Close();
+        if (std::rename(tmpPath.c_str(), outPath.c_str()) != 0) {
+            throw std::runtime_error("cannot rename " + tmpPath + " to " + outPath);
+        }
+    } catch (const std::exception& e) {
+        std::remove(tmpPath.c_str());
+        std::cerr << "Error: slice " << nthJob << "of" << nSlices_ << " failed: " << e.what() << '\n';
+        return false;
+    }
+    std::cout << "[SliceDriver] Done slice " << nthJob << "of" << nSlices_ << ": " << outPath << '\n';
+    return true;
+}
+
+void SliceDriver::saveFileIndex() const {
+    if (fileIndex_) fileIndex_->save();
+}
+
+auto SliceDriver::run(const std::vector<int>& requested, int nWorkers, const std::string& jsonDir,
+                      const MetadataRegistry& registry, const std::string& outDir) -> int {
+    std::vector<int> slices = requested;
+    if (slices.empty()) {
+        for (int n = 1; n <= nSlices_; ++n) slices.push_back(n);
+    }
+    nWorkers = std::max(1, std::min<int>(nWorkers, static_cast<int>(slices.size())));
+    std::cout << "==> SliceDriver: " << slices.size() << " of " << nSlices_ << " slices of "
+              << sampKey_ << " on " << nWorkers << " threads" << '\n';
+    prepare(jsonDir, registry);
+
+    std::atomic<std::size_t> next{0};
+    std::atomic<int> nFailed{0};
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < slices.size(); i = next++) {
+            if (!runSlice(slices[i], outDir)) nFailed++;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < nWorkers; ++w) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    saveFileIndex();
+    std::cout << "Slices: " << slices.size() - nFailed << " done, " << nFailed << " failed" << '\n';
+    return nFailed;
+}
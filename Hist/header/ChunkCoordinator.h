@@ -0,0 +1,89 @@
+#ifndef CHUNKCOORDINATOR_H
+#define CHUNKCOORDINATOR_H
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * ChunkCoordinator hands out the chunks of one sample to ChunkWorker
+ * processes over a Unix domain socket, so that fast workers take more
+ * chunks than slow ones. Chunk N of M is the slice of job N of M (same
+ * files and entry range as ./runMain -o <sampKey>_Hist_NofM.root), and the
+ * worker writes the same output file.
+ *
+ * Workers keep their connection open while they work, and send ALIVE every
+ * heartbeatSeconds while processing a chunk. A chunk is done when its
+ * worker reports it; if the connection drops before (the worker crashed or
+ * was killed), or the worker is silent for timeoutSeconds (stopped, or its
+ * machine hangs), the connection is closed and the chunk is queued again.
+ * A chunk that fails maxAttempts times is given up.
+ *
+ * Protocol, one text line per message, worker first:
+ *     HELLO        -> SAMPLE <sampKey> <nChunks>
+ *     NEXT         -> CHUNK <n> | WAIT (all chunks running) | DONE
+ *     ALIVE <n>    -> OK
+ *     FINISHED <n> -> OK
+ *     FAILED <n>   -> OK
+ */
+class ChunkCoordinator {
+public:
+    ChunkCoordinator(std::string socketPath, std::string sampKey, int nChunks, int maxAttempts = 3);
+    ~ChunkCoordinator();
+
+    // Serve until every chunk is done or given up; returns the number given up
+    int run();
+
+    // A worker sends ALIVE this often while it processes a chunk, and loses
+    // the chunk when it is silent for timeoutSeconds
+    static constexpr int heartbeatSeconds = 5;
+    static constexpr int timeoutSeconds = 30;
+
+    // Line I/O on a connected socket, shared with ChunkWorker.
+    // readLine returns false on end of file or error.
+    static bool sendLine(int fd, const std::string& line);
+    static bool readLine(int fd, std::string& buffer, std::string& line);
+
+private:
+    enum class State {
+        Pending,
+        Running,
+        Done,
+        GivenUp
+    };
+
+    struct Client {
+        std::string buffer; // bytes received after the last complete line
+        int chunk = -1;     // chunk being processed, -1 if none
+        std::chrono::steady_clock::time_point lastSeen = std::chrono::steady_clock::now();
+    };
+
+    std::string socketPath_;
+    std::string sampKey_;
+    int nChunks_;
+    int maxAttempts_;
+    int listenFd_ = -1;
+
+    std::vector<State> states_;     // [chunk - 1]
+    std::vector<int> attempts_;     // [chunk - 1]
+    std::deque<int> pending_;
+    std::map<int, Client> clients_; // by file descriptor
+    int nDone_ = 0;
+    int nGivenUp_ = 0;
+
+    // Answer one request line of client fd
+    std::string handle(int fd, const std::string& request);
+    // Requeue the chunk of a failed or lost worker, or give it up
+    void retry(int chunk, const std::string& reason);
+    void disconnect(int fd);
+    // Disconnect the workers silent for timeoutSeconds with a chunk
+    void dropSilentWorkers();
+
+    // Disable copying and assignment
+    ChunkCoordinator(const ChunkCoordinator&) = delete;
+    ChunkCoordinator& operator=(const ChunkCoordinator&) = delete;
+};
+
+#endif // CHUNKCOORDINATOR_H
@@ -0,0 +1,42 @@
+#ifndef CHUNKWORKER_H
+#define CHUNKWORKER_H
+
+#include <string>
+
+class SliceDriver;
+
+/**
+ * ChunkWorker connects to a ChunkCoordinator, learns which sample to
+ * process, then asks for chunks one at a time and processes each with a
+ * SliceDriver until the coordinator has none left. While a chunk runs, a
+ * second thread sends the heartbeat the coordinator expects.
+ */
+class ChunkWorker {
+public:
+    // Connect and ask for the sample; throws if the coordinator is not reachable
+    explicit ChunkWorker(const std::string& socketPath);
+    ~ChunkWorker();
+
+    const std::string& getSampKey() const { return sampKey_; }
+    int getNChunks() const { return nChunks_; }
+
+    // Process chunks into outDir until the coordinator is done; returns the number processed
+    int run(const SliceDriver& driver, const std::string& outDir);
+
+private:
+    std::string socketPath_;
+    int fd_ = -1;
+    std::string buffer_;
+    std::string sampKey_;
+    int nChunks_ = 0;
+
+    // Send one request and wait for the reply; empty if the coordinator is gone.
+    // Called by one thread at a time: the heartbeat thread only runs during a chunk.
+    std::string request(const std::string& line);
+
+    // Disable copying and assignment
+    ChunkWorker(const ChunkWorker&) = delete;
+    ChunkWorker& operator=(const ChunkWorker&) = delete;
+};
+
+#endif // CHUNKWORKER_H
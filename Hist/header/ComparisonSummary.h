@@ -0,0 +1,66 @@
+#ifndef COMPARISONSUMMARY_H
+#define COMPARISONSUMMARY_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class TDirectory;
+class TTree;
+
+/**
+ * ComparisonSummary collects, at the end of the event loop, one row per
+ * baseKey, version and histogram directory with the per-jet mean and RMS of
+ * V/R and V-R (R the reference version), and the profile bin where the mean
+ * V/R is farthest from 1. It is
+ * written as the TTree "Summary", so the comparison needs no second pass
+ * over the histograms.
+ *
+ * The sums behind the means and RMS are also written next to the
+ * histograms, as a TVectorD of nSums values (see Row::stats), so that
+ * OutputMerger can add them over jobs and rebuild the tree of the merged
+ * output.
+ */
+class ComparisonSummary {
+public:
+    struct Row {
+        std::string view;    // HistGivenPt, HistGivenEta, HistGivenBoth
+        std::string cell;    // e.g. Pt_15_30
+        std::string baseKey;
+        std::string version;   // label of the compared version
+        std::string reference; // label of the reference version
+        double nJets = 0.0;
+        double meanRatio = 0.0;
+        double rmsRatio = 0.0;
+        double meanDiff = 0.0;
+        double rmsDiff = 0.0;
+        // Profile bin with the largest |<V/R> - 1|: its center and <V/R>; NaN without profile
+        double maxDevX = 0.0;
+        double maxDevRatio = 0.0;
+        // Path of the TVectorD of sums in the file, e.g. HistGivenPt/Pt_15_30/sStats_<key>
+        std::string stats;
+    };
+
+    // The sums: n, sum and sum of squares of the per-jet V/R, then of V-R
+    static constexpr int nSums = 6;
+    // Set nJets and the means and RMS of row from sums
+    static void setSums(Row& row, const double* sums);
+
+    void add(Row row) { rows_.push_back(std::move(row)); }
+    std::size_t size() const { return rows_.size(); }
+
+    // Create the TTree "Summary" in dir, to be written with the TFile
+    void write(TDirectory* dir) const;
+
+    // The rows of a tree written by write(); empty (with a warning) for trees
+    // without the stats branch
+    static std::vector<Row> read(TTree* tree);
+
+    // Print the row with the largest deviation of each baseKey and version
+    void print() const;
+
+private:
+    std::vector<Row> rows_;
+};
+
+#endif // COMPARISONSUMMARY_H
@@ -0,0 +1,149 @@
+#ifndef COMPILEDCORRECTION_H
+#define COMPILEDCORRECTION_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "FormulaExpr.h"
+#include "nlohmann/json.hpp"
+
+/**
+ * CompiledCorrection is our own evaluator of one correctionlib correction.
+ * The JSON "data" tree (binning, multibinning, category, formula,
+ * formularef and constants) is flattened into a vector of nodes. Formula
+ * leaves reference a FormulaExpr and either run its postfix program or a
+ * natively compiled function attached by FormulaCompiler.
+ *
+ * Inputs are passed as doubles in the order of the correction "inputs".
+ * String inputs (e.g. the JER systematic) must be fixed with bindString()
+ * before evaluation. Node types that are not supported (transform,
+ * hashprng) make the constructor throw, so the caller can fall back to
+ * correctionlib.
+ */
+class CompiledCorrection {
+public:
+    explicit CompiledCorrection(const nlohmann::json& correctionJson);
+    ~CompiledCorrection() = default;
+
+    const std::string& getName() const { return name_; }
+    std::size_t getNInputs() const { return inputNames_.size(); }
+    const std::vector<std::string>& getInputNames() const { return inputNames_; }
+    bool isStringInput(std::size_t input) const { return inputTypes_.at(input) == "string"; }
+    bool isIntInput(std::size_t input) const { return inputTypes_.at(input) == "int"; }
+
+    // Copy with the string input fixed to value: its category nodes are replaced by the selected branch
+    std::shared_ptr<CompiledCorrection> bindString(std::size_t input, const std::string& value) const;
+    bool hasStringNodes() const;
+    // Copy with a numeric input fixed to value: binning and category nodes on it are replaced
+    // by the selected branch. Multibinning nodes, and nodes that would throw, are kept, so
+    // the reduced correction still needs the value in its inputs.
+    std::shared_ptr<CompiledCorrection> bindValue(std::size_t input, double value) const;
+
+    // Evaluate for one set of inputs (string input slots are ignored); throws on "error" flow
+    double evaluate(const double* inputs) const;
+
+    // The same in two steps: the bin search down to a leaf (throws on "error" flow),
+    // then the leaf. Corrections with the same structure hash have the same leaves.
+    int findLeaf(const double* inputs) const;
+    double evaluateLeaf(int leaf, const double* inputs) const;
+
+    // Hashes of the tree, computed when it is built. The content hash covers all that
+    // changes the result (not the name); the structure hash leaves out the constants and
+    // formula parameters, so that versions with the same binning share it.
+    std::uint64_t getContentHash() const { return contentHash_; }
+    std::uint64_t getStructureHash() const { return structureHash_; }
+    // The same comparisons without relying on the 64-bit hashes: the hashes first, then
+    // the serialized trees they were computed from (equal content implies equal structure)
+    bool sameStructure(const CompiledCorrection& other) const;
+    bool sameContent(const CompiledCorrection& other) const;
+
+    // Distinct formulas used by this correction, in order of first appearance
+    const std::vector<FormulaExpr>& getFormulas() const { return formulas_; }
+    // Attach one native function per entry of getFormulas()
+    void setNativeFunctions(const std::vector<FormulaFn>& functions);
+    bool isNative() const { return !nativeFunctions_.empty(); }
+
+    // Range of the values of an input that matter: the outer binning edges, if any
+    std::pair<double, double> getInputRange(std::size_t input) const;
+    // Sorted distinct bin edges of an input over all binning nodes
+    std::vector<double> getInputEdges(std::size_t input) const;
+    // Whether an input is a formula variable, or selects a category
+    bool isFormulaInput(std::size_t input) const;
+    bool isCategoryInput(std::size_t input) const;
+    // Whether an input has a binning or category node, i.e. bindValue() can reduce on it
+    bool isSelectingInput(std::size_t input) const;
+    bool isUniformInput(std::size_t input) const;
+    // Whether value falls in a category or inside the binning of an input (true if nothing
+    // selects on it); false means only defaults or flow behaviour apply
+    bool hasBranchFor(std::size_t input, double value) const;
+
+    // Typical range of a jet input, guessed from its name (pt, eta, phi, rho, area, run);
+    // logScale is set for inputs best sampled in log (pt)
+    static std::pair<double, double> typicalRange(const std::string& inputName, bool& logScale);
+
+private:
+    enum class NodeType : unsigned char { Constant, Binning, MultiBinning, Category, Formula };
+    enum class Flow : unsigned char { Clamp, Error, Default };
+
+    struct Axis {
+        int input = -1;
+        bool uniform = false;
+        int nBins = 0;
+        double low = 0.0;
+        double high = 0.0;
+        std::vector<double> edges;
+        // Bin index, -1 for underflow and nBins for overflow
+        int findBin(double value) const;
+    };
+
+    struct Node {
+        NodeType type = NodeType::Constant;
+        double value = 0.0;            // Constant
+        std::vector<Axis> axes;        // Binning (one axis) and MultiBinning
+        Flow flow = Flow::Clamp;
+        int flowChild = -1;            // Default flow content
+        int input = -1;                // Category input
+        std::vector<int> intKeys;      // Category keys (integer inputs)
+        std::vector<std::string> strKeys; // Category keys (string inputs)
+        int defaultChild = -1;         // Category default
+        std::vector<int> children;     // Binning/MultiBinning/Category content
+        int formula = -1;              // Formula: index into formulas_
+        std::vector<int> variables;    // Formula: input index of x, y, z, t
+        std::vector<double> parameters;// Formula: [0], [1], ...
+    };
+
+    std::string name_;
+    std::vector<std::string> inputNames_;
+    std::vector<std::string> inputTypes_;
+    std::vector<Node> nodes_; // nodes_[root_] is the top of the tree
+    int root_ = -1;
+    std::vector<FormulaExpr> formulas_;
+    std::vector<FormulaFn> nativeFunctions_;
+    std::uint64_t contentHash_ = 0;
+    std::uint64_t structureHash_ = 0;
+
+    // Build helpers
+    int inputIndex(const std::string& inputName) const;
+    int formulaIndex(const std::string& expression);
+    Axis buildAxis(const std::string& inputName, const nlohmann::json& edges) const;
+    int buildNode(const nlohmann::json& content, const nlohmann::json& genericFormulas);
+    void buildFlow(Node& node, const nlohmann::json& flow, const nlohmann::json& genericFormulas);
+    int buildFormula(const std::string& expression, const nlohmann::json& variables,
+                     const nlohmann::json& parameters);
+
+    void computeHashes();
+    // What the hashes cover: structure (binning, formulas) and values (constants, parameters)
+    void serialize(std::string& structure, std::string& values) const;
+
+    double evaluateFormula(const Node& node, const double* inputs) const;
+    // Copy the subtree of node into out, replacing each node for which select() returns a
+    // child by that child (select returns -1 to keep the node)
+    int reduceNode(int node, const std::function<int(const Node&)>& select, CompiledCorrection& out) const;
+    std::shared_ptr<CompiledCorrection> reduce(const std::function<int(const Node&)>& select) const;
+};
+
+#endif // COMPILEDCORRECTION_H
@@ -0,0 +1,65 @@
+#ifndef CORRECTIONIMAGE_H
+#define CORRECTIONIMAGE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * CorrectionImage is a compact copy of the corrections a metadata uses, so
+ * that a job does not parse the full correction JSONs (tens of MB for
+ * jet_jerc.json.gz) to evaluate a few corrections of each.
+ *
+ * For each source JSON the image holds its CorrectionSet reduced to the
+ * referenced corrections, minified and null terminated; correctionlib reads
+ * it with CorrectionSet::from_string straight from the mapped file. The
+ * footer has the section table and the hash of the content of the source
+ * files and of the tags, so an image of other files or other tags is never
+ * used. The table also has the hash of each section, checked when the image
+ * is mapped. The file is written under a name unique to the process and
+ * thread, and renamed when complete.
+ */
+class CorrectionImage {
+public:
+    // A correction JSON and the corrections used from it
+    struct Source {
+        std::string jsonFile;
+        std::vector<std::string> tags;
+    };
+
+    // Hash of the content of the source files (read on nThreads threads) and of the tags
+    static std::uint64_t hashSources(const std::vector<Source>& sources, int nThreads);
+
+    // Parse the source files on nThreads threads and write their image at path;
+    // throws std::runtime_error if a file cannot be read or parsed
+    static void build(const std::string& path, const std::vector<Source>& sources,
+                      std::uint64_t hash, int nThreads);
+
+    // True if path is a complete image with this hash
+    static bool isUsable(const std::string& path, std::uint64_t hash);
+
+    // Map an existing image; throws std::runtime_error if it is missing, incomplete or
+    // a section does not match its hash
+    explicit CorrectionImage(const std::string& path);
+    ~CorrectionImage();
+
+    CorrectionImage(const CorrectionImage&) = delete;
+    CorrectionImage& operator=(const CorrectionImage&) = delete;
+
+    // Reduced CorrectionSet JSON of jsonFile, null terminated, in the mapped file;
+    // nullptr if jsonFile is not in the image
+    const char* getJson(const std::string& jsonFile) const;
+    std::size_t getSize() const { return size_; }
+
+    // Text of a correction JSON, compressed (.gz) or not
+    static std::string readFile(const std::string& path);
+
+private:
+    std::string path_;
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::unordered_map<std::string, const char*> sections_; // jsonFile -> JSON
+};
+
+#endif // CORRECTIONIMAGE_H
@@ -0,0 +1,81 @@
+#ifndef CORRECTIONPLAN_H
+#define CORRECTIONPLAN_H
+
+#include <string>
+#include <vector>
+
+#include "JetBatch.h"
+#include "InputBranchMap.h"
+#include "MetadataRegistry.h"
+#include "ScaleObject.h"
+#include "correction.h"         // Provided by correctionlib
+
+// One baseKey of the metadata, resolved and ready for the event loop
+struct CorrectionPlanEntry {
+    std::string baseKey;
+    std::string group; // top-level output directory, see MetadataRegistry
+    CorrectionLevel level = CorrectionLevel::Other;
+    // JetBatch columns passed as correctionlib inputs, in order, per version
+    // (from the inputs declared by each correction; string inputs are not columns)
+    std::vector<std::vector<JetColumn>> inputColumns;
+
+    // One resolved correction per version (V1, V2, ...)
+    std::vector<correction::Correction::Ref> refs;
+    std::vector<std::string> tags; // only used for debug printing
+    // [version] label in the histogram names, and the version the others are compared to
+    std::vector<std::string> labels;
+    std::size_t reference = 0;
+
+    // [version] earlier version with identical content whose values are reused, or -1
+    std::vector<int> sameAs;
+    // The other versions share the binning and are evaluated together (fusedRefs)
+    bool fused = false;
+    std::vector<correction::Correction::Ref> fusedRefs;
+    // [version] input columns constant over a run or an event (run, rho) on which the
+    // correction selects a branch: bound once with ScaleObject::evaluateBatchReduced
+    std::vector<std::vector<std::size_t>> invariantInputs;
+
+    // Version whose values version v uses: v itself, or the identical one
+    std::size_t source(std::size_t v) const { return sameAs[v] < 0 ? v : static_cast<std::size_t>(sameAs[v]); }
+
+    // Id of the baseKey in the MetadataRegistry, used as histogram handle
+    int id = -1;
+};
+
+/**
+ * CorrectionPlan compiles the MetadataRegistry once before the event loop:
+ *   - every (jsonFile, tag) pair is validated and resolved to a Correction::Ref
+ *   - the inputs declared by each correction are mapped to JetBatch
+ *     columns and NanoAOD branches through an InputBranchMap
+ *   - versions with identical content are evaluated once, and versions
+ *     with the same binning share one bin search
+ *   - run and rho are bound once per run and per event where corrections
+ *     select on them (both done by specialize())
+ * The event loop then only iterates over plain entries.
+ */
+class CorrectionPlan {
+public:
+    CorrectionPlan(const MetadataRegistry& registry, const ScaleObject& scaleObject,
+                   const InputBranchMap& branchMap);
+    ~CorrectionPlan() = default;
+
+    const std::vector<CorrectionPlanEntry>& getEntries() const { return entries_; }
+    // baseKeys of the entries, in id order
+    std::vector<std::string> getBaseKeys() const;
+    std::size_t size() const { return entries_.size(); }
+
+    // Once the corrections are hashed (ScaleObject::prepareBackends): find identical and
+    // same-binning versions and the inputs to bind, and print how many baseKeys share work
+    void specialize(const ScaleObject& scaleObject);
+
+    // Distinct NanoAOD branches read by the corrections of the plan
+    const std::vector<std::string>& getInputBranches() const { return inputBranches_; }
+
+    void printPlan() const;
+
+private:
+    std::vector<CorrectionPlanEntry> entries_;
+    std::vector<std::string> inputBranches_;
+};
+
+#endif // CORRECTIONPLAN_H
@@ -0,0 +1,76 @@
+#ifndef CORRECTIONTABLE_H
+#define CORRECTIONTABLE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "CompiledCorrection.h"
+
+/**
+ * CorrectionTable samples a CompiledCorrection once on a grid over its
+ * inputs and replaces the per-jet evaluation by a table lookup.
+ *
+ * Inputs that only select bins (e.g. eta in L2Relative) get one grid point
+ * per bin, which is exact. Formula variables (pt, rho, area) get points
+ * inside every bin of that input, log-spaced for pt, and are interpolated
+ * linearly, never across a bin edge.
+ *
+ * At build time every cell is compared with the exact value at its corners,
+ * edge and face midpoints, centre and a few pseudo-random points; a cell
+ * above the relative tolerance at any of them is evaluated exactly. The
+ * bound is thus empirical: a narrow peak of the error between the test
+ * points is not seen. The grid is refined until at most 1% of the cells are
+ * evaluated exactly or the point budget is reached. Those cells, and inputs
+ * outside the sampled range, make lookup() return false so the caller
+ * evaluates exactly.
+ */
+class CorrectionTable {
+public:
+    CorrectionTable(const CompiledCorrection& corr, double tolerance,
+                    std::size_t maxPoints = 4000000);
+    ~CorrectionTable() = default;
+
+    // False when the correction cannot be tabulated (category inputs, too many points)
+    bool isValid() const { return valid_; }
+
+    // Interpolated value at inputs (in the order of the correction inputs);
+    // false when the point must be evaluated exactly
+    bool lookup(const double* inputs, double& value) const;
+
+    std::size_t getNInputs() const { return axes_.size(); }
+    std::size_t getNPoints() const { return values_.size(); }
+    double getMaxError() const { return maxError_; }        // at the test points of the accepted cells
+    double getExactFraction() const { return exactFraction_; } // cells left to exact evaluation
+
+private:
+    struct Axis {
+        bool continuous = false;
+        std::vector<double> bounds;  // continuous: segment boundaries, bounds.front() to bounds.back() is the domain
+                                     // otherwise: bin edges of the correction (may be empty)
+        std::vector<double> nodes;   // grid points, segment by segment
+        std::vector<int> segFirst;   // first node of each segment, plus nodes.size()
+        // Lower node of the cell containing x and interpolation weight; false outside the domain
+        bool locate(double x, int& node, double& weight) const;
+    };
+
+    static constexpr int maxInputs = 8;
+    static constexpr int initialPoints = 8;
+    static constexpr int maxPointsPerSegment = 256;
+    static constexpr std::size_t randomPointsPerCell = 4; // besides the 3^n grid of test points
+
+    bool valid_ = false;
+    std::vector<Axis> axes_;
+    std::vector<std::size_t> strides_;
+    std::vector<double> values_;
+    std::vector<unsigned char> exactCells_; // indexed by the lower corner of the cell
+    double maxError_ = 0.0;
+    double exactFraction_ = 0.0;
+
+    void buildAxes(const CompiledCorrection& corr, int pointsPerSegment);
+    void computeStrides();
+    std::size_t countPoints() const;
+    void fillAndCheck(const CompiledCorrection& corr, double tolerance);
+    double interpolate(std::size_t base, const int* contDims, const double* weights, int nCont) const;
+};
+
+#endif // CORRECTIONTABLE_H
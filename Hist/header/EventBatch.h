@@ -0,0 +1,57 @@
+#ifndef EVENTBATCH_H
+#define EVENTBATCH_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Rtypes.h"
+
+/**
+ * EventBatch holds consecutive events as read from the SkimTree, with the
+ * jets of all events in structure-of-arrays columns. The jets of event e
+ * are [jetOffset[e], jetOffset[e+1]). It is the unit passed from the
+ * reader thread to the event loop through an EventBatchRing.
+ */
+struct EventBatch {
+    // Per event
+    std::vector<UInt_t> run;
+    std::vector<ULong64_t> event;
+    std::vector<Float_t> rho;
+    std::vector<std::size_t> jetOffset{0}; // size() + 1 entries
+
+    // Per jet
+    std::vector<Float_t> area;
+    std::vector<Float_t> eta;
+    std::vector<Float_t> phi;
+    std::vector<Float_t> pt;
+
+    std::size_t size() const { return run.size(); }
+    std::size_t nJets(std::size_t e) const { return jetOffset[e + 1] - jetOffset[e]; }
+
+    void clear() {
+        run.clear(); event.clear(); rho.clear();
+        jetOffset.assign(1, 0);
+        area.clear(); eta.clear(); phi.clear(); pt.clear();
+    }
+
+    void reserve(std::size_t nEvents, std::size_t nJetsTotal) {
+        run.reserve(nEvents); event.reserve(nEvents); rho.reserve(nEvents);
+        jetOffset.reserve(nEvents + 1);
+        area.reserve(nJetsTotal); eta.reserve(nJetsTotal); phi.reserve(nJetsTotal); pt.reserve(nJetsTotal);
+    }
+
+    void push(UInt_t eventRun, ULong64_t eventNumber, Float_t eventRho, int nJet,
+              const Float_t* jetArea, const Float_t* jetEta, const Float_t* jetPhi, const Float_t* jetPt) {
+        run.push_back(eventRun);
+        event.push_back(eventNumber);
+        rho.push_back(eventRho);
+        const std::size_t n = nJet > 0 ? static_cast<std::size_t>(nJet) : 0;
+        area.insert(area.end(), jetArea, jetArea + n);
+        eta.insert(eta.end(), jetEta, jetEta + n);
+        phi.insert(phi.end(), jetPhi, jetPhi + n);
+        pt.insert(pt.end(), jetPt, jetPt + n);
+        jetOffset.push_back(pt.size());
+    }
+};
+
+#endif // EVENTBATCH_H
@@ -0,0 +1,58 @@
+#ifndef EVENTBATCHRING_H
+#define EVENTBATCHRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "EventBatch.h"
+
+/**
+ * EventBatchRing is a bounded single-producer single-consumer queue of
+ * EventBatch slots. The slots are allocated once and reused, so the
+ * reader thread and the event loop exchange batches without locks or
+ * allocations: the producer fills the slot at tail_, the consumer reads
+ * the slot at head_, and each side only advances its own index.
+ *
+ * A side that has to wait (ring full or empty) spins briefly, then yields
+ * and sleeps, which keeps the idle thread off the CPU during long reads.
+ */
+class EventBatchRing {
+public:
+    // nSlots batches, each reserved for nEvents events of up to nJetMax jets
+    EventBatchRing(std::size_t nSlots, std::size_t nEvents, std::size_t nJetMax);
+    ~EventBatchRing() = default;
+
+    // Producer: a free slot to fill, or nullptr if the consumer cancelled
+    EventBatch* beginWrite();
+    // Producer: publish the slot returned by beginWrite()
+    void endWrite();
+    // Producer: no more batches will be written
+    void close();
+
+    // Consumer: the oldest filled slot, or nullptr once the ring is closed and drained
+    const EventBatch* beginRead();
+    // Consumer: give the slot returned by beginRead() back to the producer
+    void endRead();
+    // Consumer: stop the producer (e.g. on error); beginWrite() then returns nullptr
+    void cancel();
+
+    std::size_t getNSlots() const { return slots_.size(); }
+
+private:
+    std::vector<EventBatch> slots_;
+    // Monotonic counters, the slot is the counter modulo the number of slots
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::atomic<bool> closed_{false};
+    std::atomic<bool> cancelled_{false};
+
+    // Back off after the n-th unsuccessful poll
+    static void wait(int n);
+
+    // Disable copying and assignment
+    EventBatchRing(const EventBatchRing&) = delete;
+    EventBatchRing& operator=(const EventBatchRing&) = delete;
+};
+
+#endif // EVENTBATCHRING_H
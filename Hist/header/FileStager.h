@@ -0,0 +1,119 @@
+#ifndef FILESTAGER_H
+#define FILESTAGER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Rtypes.h"
+
+// One file to stage: name as in FilesNano (/store/...), with the size and
+// adler32 checksum from DAS when known
+struct StageRequest {
+    std::string name;
+    Long64_t size = -1;    // bytes, -1 if unknown
+    std::string adler32;   // 8 hex digits, empty if unknown
+};
+
+// A file copied to the local disk and verified
+struct StagedFile {
+    std::size_t index = 0; // position in the requests
+    std::string localPath;
+};
+
+/**
+ * FileStager copies the input files of a job to a local directory on a
+ * pool of worker threads, in the background of the event loop. Files are
+ * handed out by next() in the order they arrive, so the first files are
+ * processed while the following ones are still being copied.
+ *
+ * The transfer is a shell command template in which {name} is replaced by
+ * the file name and {dst} by the local destination, e.g.
+ *     xrdcp --nopbar -f root://cms-xrd-global.cern.ch/{name} {dst}
+ *     cp /data/nano{name} {dst}
+ * A copy is accepted only if its size and adler32 checksum match the
+ * request (when known); it is retried once otherwise.
+ *
+ * The files in the staging directory are kept between runs and reused if
+ * they still verify. A disk budget bounds the directory: before a copy,
+ * files that are not in use (released, or left over from earlier runs)
+ * are deleted, least recently used first. Files being copied or read are
+ * never deleted, so a copy waits for the event loop to release a file
+ * when the budget is full.
+ */
+class FileStager {
+public:
+    struct Config {
+        int nWorkers = 4;
+        std::string stageDir = "stage";
+        Long64_t diskBudget = 20LL * 1024 * 1024 * 1024; // bytes
+        std::string command = "xrdcp --nopbar -f root://cms-xrd-global.cern.ch/{name} {dst}";
+        int maxAttempts = 2;
+    };
+
+    FileStager(std::vector<StageRequest> requests, Config config);
+    ~FileStager();
+
+    // Start the copy workers
+    void start();
+
+    // Block until a file is staged; false once every file was handed out or failed
+    bool next(StagedFile& file);
+
+    // The event loop is done with the file: it may be evicted
+    void release(std::size_t index);
+
+    std::size_t getNRequests() const { return requests_.size(); }
+    int getNFailed() const;
+
+    // adler32 of the file content as 8 hex digits (empty if it cannot be read)
+    static std::string adler32(const std::string& path);
+
+private:
+    enum class State {
+        Pending,   // not started
+        Copying,
+        Ready,     // staged, waiting for next()
+        InUse,     // handed out by next()
+        Released,
+        Failed
+    };
+
+    std::vector<StageRequest> requests_;
+    Config config_;
+    std::vector<State> states_;
+    std::vector<std::string> localPaths_;
+    std::vector<Long64_t> diskSizes_;  // bytes reserved or used on disk
+
+    // Files on disk that may be deleted, least recently used first
+    std::list<std::pair<std::string, Long64_t>> evictable_;
+    Long64_t usedBytes_ = 0;
+
+    std::size_t nextPending_ = 0;
+    std::deque<std::size_t> readyQueue_;
+    std::size_t nDone_ = 0; // handed out or failed
+    bool stopping_ = false;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::thread> workers_;
+
+    // Scan the staging directory: reuse verified files, others become evictable
+    void scanStageDir();
+    void worker();
+    // Make room for bytes, evicting if needed; called with the lock held
+    void reserve(std::unique_lock<std::mutex>& lock, Long64_t bytes);
+    bool copy(std::size_t index, std::string& error) const;
+    bool verify(std::size_t index, const std::string& path, std::string& error) const;
+
+    // Disable copying and assignment
+    FileStager(const FileStager&) = delete;
+    FileStager& operator=(const FileStager&) = delete;
+};
+
+#endif // FILESTAGER_H
@@ -0,0 +1,172 @@
+#ifndef FLATHIST_H
+#define FLATHIST_H
+
+#include <string>
+#include <vector>
+
+class TH1D;
+class TH2D;
+class TProfile;
+
+/**
+ * FlatAxis is the binning of a TAxis: nBins uniform bins between low and
+ * high, or variable bins given by their edges. Bin 0 and nBins+1 are the
+ * underflow and overflow, as in ROOT.
+ */
+class FlatAxis {
+public:
+    FlatAxis() = default;
+    FlatAxis(int nBins, double low, double high);
+    explicit FlatAxis(std::vector<double> edges);
+
+    int getNBins() const { return nBins_; }
+    double getLow() const { return low_; }
+    double getHigh() const { return high_; }
+    // Bin edges; empty for uniform bins
+    const std::vector<double>& getEdges() const { return edges_; }
+    // All nBins+1 edges, uniform bins too
+    std::vector<double> getBinEdges() const;
+    // Center of bin in [1, nBins]
+    double getBinCenter(int bin) const;
+
+    // Same bin as TAxis::FindFixBin
+    int findBin(double x) const {
+        if (x < low_) return 0;
+        if (!(x < high_)) return nBins_ + 1;
+        if (edges_.empty()) return 1 + static_cast<int>(nBins_ * (x - low_) / (high_ - low_));
+        return findVariableBin(x);
+    }
+
+private:
+    int nBins_ = 0;
+    double low_ = 0.0;
+    double high_ = 0.0;
+    std::vector<double> edges_;
+
+    int findVariableBin(double x) const;
+};
+
+/**
+ * FlatHist1D holds the bin contents and statistics of an unweighted TH1D in
+ * plain arrays, filled without a virtual call. The TH1D is only created at
+ * save time by toTH1D, with the contents, entries and statistics it would
+ * have had if filled directly.
+ */
+class FlatHist1D {
+public:
+    FlatHist1D() = default;
+    explicit FlatHist1D(const FlatAxis& axis);
+
+    void fill(double x) {
+        const int bin = axis_.findBin(x);
+        sumw_[bin] += 1.0;
+        entries_ += 1.0;
+        if (bin == 0 || bin > axis_.getNBins()) return; // over/underflow not in the statistics
+        tsumw_ += 1.0;
+        tsumwx_ += x;
+        tsumwx2_ += x * x;
+    }
+
+    // Add the contents of other (same axis)
+    void add(const FlatHist1D& other);
+
+    // Create the TH1D in the current directory
+    TH1D* toTH1D(const std::string& name, const std::string& title) const;
+
+private:
+    FlatAxis axis_;
+    std::vector<double> sumw_; // per bin, including under/overflow
+    double entries_ = 0.0;
+    double tsumw_ = 0.0; // == tsumw2 for unit weights
+    double tsumwx_ = 0.0;
+    double tsumwx2_ = 0.0;
+};
+
+/**
+ * FlatProfile is the same for an unweighted TProfile: per bin the entries,
+ * the sum and the sum of squares of y.
+ */
+class FlatProfile {
+public:
+    FlatProfile() = default;
+    explicit FlatProfile(const FlatAxis& axis);
+
+    void fill(double x, double y) {
+        const int bin = axis_.findBin(x);
+        sumw_[bin] += 1.0;
+        sumwy_[bin] += y;
+        sumwy2_[bin] += y * y;
+        entries_ += 1.0;
+        if (bin == 0 || bin > axis_.getNBins()) return;
+        tsumw_ += 1.0;
+        tsumwx_ += x;
+        tsumwx2_ += x * x;
+        tsumwy_ += y;
+        tsumwy2_ += y * y;
+    }
+
+    void add(const FlatProfile& other);
+
+    const FlatAxis& getAxis() const { return axis_; }
+    double getBinEntries(int bin) const { return sumw_[bin]; }
+    // Mean of y in bin, 0 if empty
+    double getBinMean(int bin) const { return sumw_[bin] > 0 ? sumwy_[bin] / sumw_[bin] : 0.0; }
+
+    // Create the TProfile in the current directory
+    TProfile* toTProfile(const std::string& name, const std::string& title) const;
+
+private:
+    FlatAxis axis_;
+    std::vector<double> sumw_;
+    std::vector<double> sumwy_;
+    std::vector<double> sumwy2_;
+    double entries_ = 0.0;
+    double tsumw_ = 0.0;
+    double tsumwx_ = 0.0;
+    double tsumwx2_ = 0.0;
+    double tsumwy_ = 0.0;
+    double tsumwy2_ = 0.0;
+};
+
+/**
+ * FlatHist2D is the same for an unweighted TH2D; bin (ix, iy) is at
+ * ix + (nx+2)*iy, as in ROOT.
+ */
+class FlatHist2D {
+public:
+    FlatHist2D() = default;
+    FlatHist2D(const FlatAxis& xAxis, const FlatAxis& yAxis);
+
+    void fill(double x, double y) {
+        const int binX = xAxis_.findBin(x);
+        const int binY = yAxis_.findBin(y);
+        sumw_[binX + (xAxis_.getNBins() + 2) * binY] += 1.0;
+        entries_ += 1.0;
+        if (binX == 0 || binX > xAxis_.getNBins() || binY == 0 || binY > yAxis_.getNBins()) return;
+        tsumw_ += 1.0;
+        tsumwx_ += x;
+        tsumwx2_ += x * x;
+        tsumwy_ += y;
+        tsumwy2_ += y * y;
+        tsumwxy_ += x * y;
+    }
+
+    void add(const FlatHist2D& other);
+
+    // Create the TH2D in the current directory
+    TH2D* toTH2D(const std::string& name, const std::string& title) const;
+
+private:
+    FlatAxis xAxis_;
+    FlatAxis yAxis_;
+    std::vector<double> sumw_;
+    double entries_ = 0.0;
+    double tsumw_ = 0.0;
+    double tsumwx_ = 0.0;
+    double tsumwx2_ = 0.0;
+    double tsumwy_ = 0.0;
+    double tsumwy2_ = 0.0;
+    double tsumwxy_ = 0.0;
+};
+
+#endif // FLATHIST_H
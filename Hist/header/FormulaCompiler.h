@@ -0,0 +1,37 @@
+#ifndef FORMULACOMPILER_H
+#define FORMULACOMPILER_H
+
+#include <string>
+#include <vector>
+
+#include "CompiledCorrection.h"
+
+/**
+ * FormulaCompiler turns the distinct formulas of a set of CompiledCorrections
+ * into one generated C++ file, builds it as a shared library with the system
+ * compiler and attaches the loaded functions to the corrections.
+ *
+ * Libraries are cached as <cacheDir>/<hash>.so, where the hash covers the
+ * caller supplied content key (correction JSON and tags) and the generated
+ * source, so later runs only dlopen. On any failure compile() returns false
+ * and leaves the corrections untouched.
+ */
+class FormulaCompiler {
+public:
+    explicit FormulaCompiler(std::string cacheDir = "cache/formula");
+    ~FormulaCompiler();
+
+    FormulaCompiler(const FormulaCompiler&) = delete;
+    FormulaCompiler& operator=(const FormulaCompiler&) = delete;
+
+    bool compile(const std::vector<CompiledCorrection*>& corrections, const std::string& contentKey);
+
+private:
+    std::string cacheDir_;
+    std::vector<void*> handles_; // dlopen handles, closed in the destructor
+
+    static std::string generateSource(const std::vector<const FormulaExpr*>& formulas);
+    bool buildLibrary(const std::string& source, const std::string& libPath) const;
+};
+
+#endif // FORMULACOMPILER_H
@@ -0,0 +1,66 @@
+#ifndef FORMULAEXPR_H
+#define FORMULAEXPR_H
+
+#include <string>
+#include <vector>
+
+// Signature of a natively compiled formula: variables (x, y, z, t) and parameters ([0], [1], ...)
+using FormulaFn = double (*)(const double* vars, const double* params);
+
+/**
+ * FormulaExpr parses the TFormula subset used by correctionlib formula
+ * nodes (numbers, x/y/z/t, [i], + - * / ^, comparisons and the usual
+ * math functions) into a postfix program. The program can be evaluated
+ * directly, or turned into a C++ expression by FormulaCompiler.
+ * Unsupported syntax throws std::runtime_error.
+ */
+class FormulaExpr {
+public:
+    explicit FormulaExpr(const std::string& expression);
+    ~FormulaExpr() = default;
+
+    const std::string& getExpression() const { return expression_; }
+    int getNVariables() const { return nVariables_; }
+    int getNParameters() const { return nParameters_; }
+
+    double evaluate(const double* vars, const double* params) const;
+
+    // C++ expression of the formula, reading v[i] and p[i]
+    std::string toCpp() const;
+
+private:
+    enum class Op : unsigned char {
+        Const, Var, Param,
+        Add, Sub, Mul, Div, Pow, Neg,
+        Lt, Gt, Le, Ge, Eq, Ne,
+        Func1, Func2
+    };
+    struct Instr {
+        Op op;
+        int index;    // variable, parameter or function id
+        double value; // constant
+    };
+
+    std::string expression_;
+    std::vector<Instr> program_;
+    int nVariables_ = 0;
+    int nParameters_ = 0;
+
+    // Recursive descent parser state
+    std::size_t pos_ = 0;
+    int depth_ = 0;
+    int maxDepth_ = 0;
+    void parseComparison();
+    void parseSum();
+    void parseProduct();
+    void parsePower();
+    void parseUnary();
+    void parsePrimary();
+    void skipSpaces();
+    bool accept(const char* token);
+    void emit(Op op, int index = 0, double value = 0.0);
+
+    static constexpr int maxStack = 64;
+};
+
+#endif // FORMULAEXPR_H
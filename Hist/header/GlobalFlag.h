@@ -61,6 +61,12 @@ public:
         Wqq
     };
 
+    // How ScaleObject evaluates corrections
+    enum class CorrectionBackend {
+        Interpreter, // correctionlib
+        Native       // CompiledCorrection with formulas compiled by FormulaCompiler
+    };
+
     // Constructor and Destructor
     explicit GlobalFlag(std::string  outName);
     virtual ~GlobalFlag() = default;  // Virtual for proper cleanup in derived classes
@@ -72,10 +78,23 @@ public:
     // Setter methods
     void setDebug(const bool& debug);
     void setNDebug(const int & nDebug);
+    void setNThreads(const int & nThreads);
+    void setCorrectionBackend(const CorrectionBackend& backend);
+    void setLutTolerance(const double& tolerance);
+    void setAsyncRead(const bool& asyncRead);
+    void setWriteEmpty(const bool& writeEmpty);
 
     // Getter methods
     bool isDebug() const { return isDebug_; }
     int getNDebug() const { return nDebug_; }
+    int getNThreads() const { return nThreads_; }
+    CorrectionBackend getCorrectionBackend() const { return correctionBackend_; }
+    // Relative tolerance of the lookup-table mode, 0 when it is off
+    double getLutTolerance() const { return lutTolerance_; }
+    // Read the events on a separate thread, overlapping I/O with the corrections
+    bool isAsyncRead() const { return isAsyncRead_; }
+    // Write the histograms never filled as empty placeholders, instead of skipping them
+    bool isWriteEmpty() const { return isWriteEmpty_; }
 
     Year getYear() const { return year_; }
     Era getEra() const { return era_; }
@@ -96,6 +115,11 @@ private:
     // Flags
     bool isDebug_ = false;
     int nDebug_ = 0;
+    int nThreads_ = 1;
+    CorrectionBackend correctionBackend_ = CorrectionBackend::Interpreter;
+    double lutTolerance_ = 0.0;
+    bool isAsyncRead_ = false;
+    bool isWriteEmpty_ = false;
 
     Year year_ = Year::NONE;
     Era  era_  = Era::NONE;
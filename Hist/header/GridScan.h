@@ -0,0 +1,67 @@
+#ifndef GRIDSCAN_H
+#define GRIDSCAN_H
+
+#include <string>
+#include <vector>
+
+#include "JetBatch.h"
+
+class TDirectory;
+class CorrectionPlan;
+class ScaleObject;
+
+/**
+ * GridScan compares the versions of every baseKey without events: the
+ * corrections are evaluated on a grid of jet inputs, and the ratio V/R and
+ * the difference V-R of each version V to the reference version R are
+ * written as maps:
+ *   GridScan/h2Ratio_<key>, h2Diff_<key>      TH2D (eta, pt) at the middle rho point
+ *   GridScan/h3Ratio_<key>, h3Diff_<key>      TH3D (eta, pt, rho), if rho is scanned
+ *   HistGivenPt/Pt_X_Y/h2Ratio_<key>, ...     TProfile2D (eta, rho) of the pt points in the bin
+ *   HistGivenEta/Eta_X_Y/h2Ratio_<key>, ...   TProfile2D (pt, rho) of the |eta| points in the bin
+ * With more than two versions the names carry the label of V, as in the
+ * event histograms (h2RatioV9M_<key>). The Pt_X_Y and Eta_X_Y directories
+ * are those of the event histograms, under <group>/ for the keys of a
+ * metadata group.
+ *
+ * The grid is a comma-separated list of axes: NAME:LOW:HIGH:N[:log] scans
+ * an input over N bins (eta, pt, rho) and NAME:VALUE fixes it (any input), e.g.
+ *     eta:-5.191:5.191:104,pt:10:4500:100:log,rho:0:60:6
+ * The points are the bin centers (geometric for log axes). Inputs that are
+ * not given keep their default: eta and pt as above, rho 20, area 0.5 and
+ * phi 0. The run has no default: it must be given (run:VALUE) when a
+ * compared correction depends on it, and a warning says when the value is
+ * outside every run category of a correction.
+ */
+class GridScan {
+public:
+    explicit GridScan(const std::string& spec = "");
+    ~GridScan() = default;
+
+    // Evaluate the plan on the grid with nThreads threads and book the maps under dir;
+    // throws if a compared correction depends on the run and the spec gives none
+    void run(const CorrectionPlan& plan, const ScaleObject& scaleObject, int nThreads, TDirectory* dir) const;
+
+    void printGrid() const;
+
+private:
+    struct Axis {
+        std::string name;
+        int nBins = 1;
+        double low = 0.0;
+        double high = 0.0;
+        bool log = false;
+        double edge(int i) const;
+        double center(int i) const;
+        std::vector<double> edges() const;
+    };
+    // One axis per JetColumn, in enum order
+    std::vector<Axis> axes_;
+    bool runGiven_ = false; // run:VALUE in the spec
+
+    const Axis& axis(JetColumn col) const { return axes_[static_cast<int>(col)]; }
+    // Append the points of eta bin iEta, pt fastest then rho, to batch
+    void fillRow(int iEta, JetBatch& batch) const;
+};
+
+#endif // GRIDSCAN_H
@@ -13,6 +13,7 @@
 #include "TFile.h"
 #include "TDirectory.h"
 #include <cmath>
+#include <cstdint>
 
 class Helper {
 public:
@@ -41,6 +42,9 @@ public:
 
     // Utility function to format numbers
     static std::string formatNumber(double num);
+
+    // 64-bit FNV-1a hash of a string, used as a content key for caches
+    static std::uint64_t fnv1aHash(const std::string& data);
 };
     
 #endif // HELPER_H
@@ -0,0 +1,314 @@
+#ifndef HISTGIVEN_H
+#define HISTGIVEN_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "ComparisonSummary.h"
+#include "FlatHist.h"
+#include "QuantileSketch.h"
+#include "JetAxis.h"
+#include "TDirectory.h"
+
+// Count, mean and RMS of a stream of values
+struct RunningStats {
+    double n = 0.0;
+    double sum = 0.0;
+    double sum2 = 0.0;
+
+    void add(double x) { n += 1.0; sum += x; sum2 += x * x; }
+    void merge(const RunningStats& other) { n += other.n; sum += other.sum; sum2 += other.sum2; }
+    double mean() const { return n > 0 ? sum / n : 0.0; }
+    double rms() const { return n > 0 ? std::sqrt(std::max(0.0, sum2 / n - mean() * mean())) : 0.0; }
+};
+
+// A booked baseKey: the labels of its versions and the one the others are compared to
+struct HistGivenKey {
+    std::string baseKey;
+    std::vector<std::string> labels;
+    std::size_t reference = 0;
+    std::string group; // top-level directory of its metadata file, none if empty
+};
+
+// Histograms of one version
+struct HistGivenVersion {
+    FlatHist1D hCorr;
+    FlatProfile pCorr;
+    QuantileSketch qCorr;
+};
+
+// Comparison of one version (V) to the reference version (R)
+struct HistGivenComparison {
+    std::size_t version = 0;
+    FlatProfile pRatio;
+    FlatProfile pDiff;
+    FlatHist2D h2Corr;
+    QuantileSketch qRatio;
+    RunningStats ratio; // per-jet V/R over the whole directory, for the summary
+    RunningStats diff;  // per-jet V-R
+};
+
+/**
+ * HistGivenSet groups the histograms we want per baseKey and directory:
+ *   - per version: TH1D of the correction, TProfile vs the profile axis (if
+ *     any) and a quantile sketch
+ *   - per version other than the reference: TProfile of the per-jet V/R and
+ *     V-R vs the profile axis (if any), TH2D of V vs R and a sketch of V/R
+ * They are kept as flat arrays and written as TH1D/TProfile/TH2D by save();
+ * the sketches as TVectorD (QuantileSketch::toVector), and the sums of the
+ * summary as a TVectorD (ComparisonSummary::nSums). All the versions are
+ * filled from the same jets, so N versions need one event loop, not N-1.
+ */
+struct HistGivenSet {
+    std::vector<HistGivenVersion> versions;
+    std::vector<HistGivenComparison> comparisons;
+};
+
+// The non-template parts of HistGiven
+class HistGivenBase {
+protected:
+    // Correction factor binning of baseKey: around 1 for the JEC levels, around 0 otherwise
+    static FlatAxis corrAxis(const std::string& baseKey, int nBins = 100);
+    // baseKey with the characters ROOT does not like in names replaced
+    static std::string safeKey(const std::string& baseKey);
+    // Empty set of key, with the profiles binned in profileEdges if not empty
+    static std::unique_ptr<HistGivenSet> makeSet(const HistGivenKey& key, const std::vector<double>& profileEdges);
+    // Add other (same key) to hset
+    static void mergeSet(HistGivenSet& hset, const HistGivenSet& other);
+    // Write the histograms of key in the current directory; the profiles
+    // only if profileSymbol is given
+    static void saveSet(const HistGivenSet& hset, const HistGivenKey& key,
+                        const char* profileSymbol, const char* profileTitle);
+    // Summary row of a comparison of a filled set; maxDev from pRatio if hasProfile
+    static ComparisonSummary::Row summaryRow(const HistGivenComparison& comp, bool hasProfile);
+    // Name of the TVectorD of summary sums of the comparison of version v, e.g. sStats_<key>
+    static std::string statsName(const HistGivenKey& key, std::size_t version);
+};
+
+// Profile axis of the views without profiles
+struct NoAxis {};
+
+/**
+ * HistGiven<ProfileAxis, SplitAxes...> books one directory per cell of the
+ * SplitAxes (e.g. HistGivenBoth/Eta_0_1p3_Pt_15_30) with the histograms of
+ * every baseKey, and the profiles vs ProfileAxis unless it is NoAxis; under
+ * <group>/ for the keys of a metadata group. The
+ * axes are the compile-time descriptors of JetAxis.h, so a view binned in
+ * rho or area is one more alias, e.g. HistGiven<EtaAxis, RhoAxis>.
+ *
+ * The sets are stored in one vector, [cell][handle], where the handle of a
+ * baseKey is its position in the booked keys (the CorrectionPlan id).
+ * A set is only allocated by its first fill: the cells no jet reaches (high
+ * pT in the forward region, keys not evaluated in this job) cost one null
+ * pointer, and are not written unless save() is asked for empty placeholders.
+ */
+template <class ProfileAxis, class... SplitAxes>
+class HistGiven : private HistGivenBase {
+public:
+    static_assert(sizeof...(SplitAxes) > 0, "HistGiven needs at least one split axis");
+    static constexpr bool hasProfile = !std::is_same_v<ProfileAxis, NoAxis>;
+    static constexpr int nCells = (AxisBins<SplitAxes>::nBins * ...);
+
+    // Book the histograms of every baseKey of the metadata under origDir/name;
+    // the histograms themselves are only allocated when first filled
+    HistGiven(TDirectory* origDir, const std::string& name, const std::vector<HistGivenKey>& keys)
+        : origDir_(origDir), name_(name), keys_(keys),
+          sets_(static_cast<std::size_t>(nCells) * keys.size()) {
+        std::cout << "[" << name_ << "] Booked " << keys_.size() << " baseKeys in "
+                  << nCells << " directories" << '\n';
+    }
+
+    // Handle of baseKey for fill(): its position in the booked keys, -1 if not booked
+    int getHandle(const std::string& baseKey) const {
+        for (std::size_t i = 0; i < keys_.size(); ++i) {
+            if (keys_[i].baseKey == baseKey) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // Cell of jet j of batch, -1 if it is outside one of the split axes
+    static int findCell(const JetBatch& batch, std::size_t j) {
+        int cell = 0;
+        const bool inside = (appendBin<SplitAxes>(cell, jetValue<SplitAxes::var>(batch, j)) && ...);
+        return inside ? cell : -1;
+    }
+
+    // Directory name of cell, e.g. Eta_0_1p3_Pt_15_30
+    static std::string cellName(int cell) {
+        constexpr std::size_t nAxes = sizeof...(SplitAxes);
+        constexpr std::array<int, nAxes> nBins = {AxisBins<SplitAxes>::nBins...};
+        constexpr std::array<std::string (*)(int), nAxes> rangeNames = {&AxisBins<SplitAxes>::rangeName...};
+        std::array<int, nAxes> bins{};
+        for (std::size_t a = nAxes; a-- > 0;) {
+            bins[a] = cell % nBins[a];
+            cell /= nBins[a];
+        }
+        std::string name;
+        for (std::size_t a = 0; a < nAxes; ++a) {
+            if (a > 0) name += "_";
+            name += rangeNames[a](bins[a]);
+        }
+        return name;
+    }
+
+    // Fill the histograms of a handle with jet j of batch in cell, given the
+    // corrections of every version (corrFactors[v], in metadata order)
+    void fill(int handle, int cell, const JetBatch& batch, std::size_t j, const std::vector<double>& corrFactors) {
+        const HistGivenKey& key = keys_[handle];
+        if (cell < 0 || corrFactors.size() < key.labels.size()) return;
+        auto& slot = sets_[static_cast<std::size_t>(cell) * keys_.size() + handle];
+        if (!slot) slot = makeSet(key, profileEdges());
+        HistGivenSet& hset = *slot;
+        double x = 0.0;
+        if constexpr (hasProfile) x = jetValue<ProfileAxis::var>(batch, j);
+
+        for (std::size_t v = 0; v < hset.versions.size(); ++v) {
+            hset.versions[v].hCorr.fill(corrFactors[v]);
+            hset.versions[v].qCorr.add(corrFactors[v]);
+            if constexpr (hasProfile) hset.versions[v].pCorr.fill(x, corrFactors[v]);
+        }
+
+        const double ref = corrFactors[key.reference];
+        for (auto& comp : hset.comparisons) {
+            const double value = corrFactors[comp.version];
+            comp.h2Corr.fill(ref, value);
+            const double diff = value - ref;
+            comp.diff.add(diff);
+            const bool hasRatio = ref != 0.0;
+            const double ratio = hasRatio ? value / ref : 0.0;
+            if (hasRatio) {
+                comp.qRatio.add(ratio);
+                comp.ratio.add(ratio);
+            }
+            if constexpr (hasProfile) {
+                if (hasRatio) comp.pRatio.fill(x, ratio);
+                comp.pDiff.fill(x, diff);
+            }
+        }
+    }
+
+    // Add the histograms of another instance booked from the same metadata
+    void merge(const HistGiven& other) {
+        if (other.sets_.size() != sets_.size()) {
+            throw std::runtime_error(name_ + ": cannot merge histograms booked from different metadata");
+        }
+        for (std::size_t i = 0; i < sets_.size(); ++i) {
+            if (!other.sets_[i]) continue;
+            if (!sets_[i]) {
+                sets_[i] = std::make_unique<HistGivenSet>(*other.sets_[i]);
+                continue;
+            }
+            mergeSet(*sets_[i], *other.sets_[i]);
+        }
+    }
+
+    // Release every set, as just booked
+    void clear() {
+        for (auto& hset : sets_) {
+            hset.reset();
+        }
+    }
+
+    // Number of sets filled at least once
+    std::size_t getNFilled() const {
+        std::size_t n = 0;
+        for (const auto& hset : sets_) {
+            if (hset) n++;
+        }
+        return n;
+    }
+
+    // Create the TH1D/TProfile of the filled sets in their directories, to be written
+    // with the TFile; with writeEmpty, also empty ones for the sets never filled
+    void save(bool writeEmpty) const {
+        for (int cell = 0; cell < nCells; ++cell) {
+            const std::size_t first = static_cast<std::size_t>(cell) * keys_.size();
+            TDirectory* dir = nullptr;
+            const std::string* dirGroup = nullptr;
+            for (std::size_t k = 0; k < keys_.size(); ++k) {
+                const HistGivenSet* hset = sets_[first + k].get();
+                std::unique_ptr<HistGivenSet> empty;
+                if (!hset) {
+                    if (!writeEmpty) continue;
+                    empty = makeSet(keys_[k], profileEdges());
+                    hset = empty.get();
+                }
+                // The directory only if something goes in it; the keys of a group are contiguous
+                if (!dir || *dirGroup != keys_[k].group) {
+                    dirGroup = &keys_[k].group;
+                    dir = Helper::createTDirectory(origDir_, viewPath(keys_[k]) + "/" + cellName(cell));
+                }
+                dir->cd();
+                if constexpr (hasProfile) {
+                    saveSet(*hset, keys_[k], ProfileAxis::symbol, ProfileAxis::title);
+                } else {
+                    saveSet(*hset, keys_[k], nullptr, nullptr);
+                }
+            }
+        }
+        origDir_->cd();
+        std::cout << "[" << name_ << "] Saved " << getNFilled() << " of " << sets_.size() << " histogram sets"
+                  << (writeEmpty ? ", and the others empty" : "") << '\n';
+    }
+
+    // Add the summary row of every comparison of every filled set to summary
+    void summarize(ComparisonSummary& summary) const {
+        for (int cell = 0; cell < nCells; ++cell) {
+            for (std::size_t k = 0; k < keys_.size(); ++k) {
+                const HistGivenSet* hset = sets_[cell * keys_.size() + k].get();
+                if (!hset) continue;
+                for (const auto& comp : hset->comparisons) {
+                    ComparisonSummary::Row row = summaryRow(comp, hasProfile);
+                    row.view = viewPath(keys_[k]);
+                    row.cell = cellName(cell);
+                    row.baseKey = keys_[k].baseKey;
+                    row.version = keys_[k].labels[comp.version];
+                    row.reference = keys_[k].labels[keys_[k].reference];
+                    row.stats = row.view + "/" + row.cell + "/" + statsName(keys_[k], comp.version);
+                    summary.add(std::move(row));
+                }
+            }
+        }
+    }
+
+private:
+    TDirectory* origDir_ = nullptr;
+    std::string name_;
+    std::vector<HistGivenKey> keys_;
+    std::vector<std::unique_ptr<HistGivenSet>> sets_; // [cell][handle], null until filled
+
+    // Directory of the view for key, e.g. HistGivenPt or metadata_2025/HistGivenPt
+    std::string viewPath(const HistGivenKey& key) const {
+        return key.group.empty() ? name_ : key.group + "/" + name_;
+    }
+
+    // Edges of the profiles, empty without profile axis
+    static std::vector<double> profileEdges() {
+        if constexpr (hasProfile) {
+            return std::vector<double>(ProfileAxis::edges.begin(), ProfileAxis::edges.end());
+        } else {
+            return {};
+        }
+    }
+
+    template <class Axis>
+    static bool appendBin(int& cell, double x) {
+        const int bin = AxisBins<Axis>::find(x);
+        cell = cell * AxisBins<Axis>::nBins + bin;
+        return bin >= 0;
+    }
+};
+
+// The views of the output file; plotGivenVar.py reads HistGivenPt and HistGivenEta
+using HistGivenPt   = HistGiven<EtaAxis, PtRegionAxis>;
+using HistGivenEta  = HistGiven<PtAxis, AbsEtaRegionAxis>;
+using HistGivenBoth = HistGiven<NoAxis, AbsEtaRegionAxis, PtRegionAxis>;
+
+#endif // HISTGIVEN_H
@@ -0,0 +1,42 @@
+#ifndef INPUTBRANCHMAP_H
+#define INPUTBRANCHMAP_H
+
+#include <string>
+#include <unordered_map>
+
+#include "JetBatch.h"
+
+/**
+ * InputBranchMap tells how a correctionlib input is fed from NanoAOD: the
+ * JetBatch column passed to the correction and the branch to read. It is
+ * loaded from a JSON table, one entry per input name:
+ *     "JetPt": {"column": "Pt", "branch": "Jet_pt"}
+ * The branch "Rho" stands for the rho branch of the year
+ * (Rho_fixedGridRhoFastjetAll in Run 3, fixedGridRhoFastjetAll in Run 2).
+ * Each column is filled from one fixed branch (Pt from Jet_pt, ...), so
+ * an entry naming any other branch is rejected when the table is loaded.
+ */
+class InputBranchMap {
+public:
+    explicit InputBranchMap(const std::string& jsonPath = "input/jerc/inputBranches.json");
+    ~InputBranchMap() = default;
+
+    bool has(const std::string& inputName) const { return entries_.count(inputName) > 0; }
+    // Both throw std::runtime_error for an unknown input
+    JetColumn getColumn(const std::string& inputName) const;
+    const std::string& getBranch(const std::string& inputName) const;
+
+    const std::string& getPath() const { return jsonPath_; }
+
+private:
+    struct Entry {
+        JetColumn column;
+        std::string branch;
+    };
+    std::string jsonPath_;
+    std::unordered_map<std::string, Entry> entries_;
+
+    const Entry& at(const std::string& inputName) const;
+};
+
+#endif // INPUTBRANCHMAP_H
@@ -0,0 +1,70 @@
+#ifndef INPUTFILEINDEX_H
+#define INPUTFILEINDEX_H
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Rtypes.h"
+
+// Result of validating one input file
+struct InputFileInfo {
+    std::string path;
+    Long64_t size = -1;    // bytes, -1 if the file could not be stat'ed
+    Long_t mtime = 0;
+    Long64_t entries = 0;  // entries of the "Events" tree
+    bool valid = false;    // opened, has "Events" with entries
+    std::string error;     // why the file is not valid
+};
+
+/**
+ * InputFileIndex validates the input files of a job concurrently: each
+ * file is opened once with TFile::Open on a bounded pool of threads, and
+ * its "Events" entries are recorded so that the TChain never reopens it.
+ *
+ * Results are kept in a JSON cache (path, size, mtime, entries, valid).
+ * A file whose size and modification time are unchanged is not opened
+ * again. Files that failed to open are not cached, so transient xrootd
+ * errors are retried on the next run.
+ *
+ * One index can be shared by the jobs of a process (SliceDriver): validate()
+ * is thread-safe, the files of all the concurrent calls are opened by at
+ * most nOpeners threads at a time, and a file already checked by the process
+ * is not checked again.
+ */
+class InputFileIndex {
+public:
+    explicit InputFileIndex(std::string cachePath = "cache/input_files.json", int nOpeners = 8);
+    ~InputFileIndex() = default;
+
+    // Validate paths with at most nWorkers threads, each opening a file only while it
+    // holds one of the nOpeners slots of the index; results are in the order of paths.
+    // With nWorkers > 1, ROOT::EnableThreadSafety() must have been called (main does)
+    std::vector<InputFileInfo> validate(const std::vector<std::string>& paths, int nWorkers);
+
+    // Merge the results into the cache file (written atomically, under an flock of
+    // cachePath.lock so that concurrent jobs do not lose each other's files)
+    void save() const;
+
+    // Cached result for path, if any
+    std::optional<InputFileInfo> find(const std::string& path) const;
+
+private:
+    std::string cachePath_;
+    std::unordered_map<std::string, InputFileInfo> cached_;
+    std::unordered_set<std::string> checkedHere_; // validated by this process
+
+    // Guards cached_, checkedHere_ and the opener slots
+    mutable std::mutex mutex_;
+    mutable std::condition_variable openerFreed_;
+    mutable int freeOpeners_;
+
+    void load();
+    InputFileInfo inspect(const std::string& path) const;
+};
+
+#endif // INPUTFILEINDEX_H
@@ -0,0 +1,129 @@
+#ifndef JETAXIS_H
+#define JETAXIS_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+#include "Helper.h"
+#include "JetBatch.h"
+
+// Jet quantities a histogram axis can be binned in
+enum class JetVar {
+    Eta,
+    AbsEta,
+    Pt,
+    Rho,
+    Area,
+    Run
+};
+
+// Value of var for jet j of batch
+template <JetVar Var>
+inline double jetValue(const JetBatch& batch, std::size_t j) {
+    if constexpr (Var == JetVar::Eta) return batch.eta[j];
+    else if constexpr (Var == JetVar::AbsEta) return std::abs(batch.eta[j]);
+    else if constexpr (Var == JetVar::Pt) return batch.pt[j];
+    else if constexpr (Var == JetVar::Rho) return batch.rho[j];
+    else if constexpr (Var == JetVar::Area) return batch.area[j];
+    else return batch.run[j];
+}
+
+/**
+ * Compile-time axis descriptors of the HistGiven histograms. Each gives the
+ * jet quantity, the bin edges, the name used in the directory names
+ * (Pt_15_30) and the titles of the profiles binned in it. A new binning is a
+ * new descriptor; AxisBins does the bin search for all of them.
+ */
+
+// The 36 eta bins of the JEC
+struct EtaAxis {
+    static constexpr JetVar var = JetVar::Eta;
+    static constexpr const char* name = "Eta";
+    static constexpr const char* symbol = "#eta";
+    static constexpr const char* title = "Jet #eta";
+    static constexpr std::array<double, 37> edges = {
+        -5.191, -3.839, -3.489, -3.139, -2.964, -2.853,
+        -2.650, -2.500, -2.322, -2.172, -1.930, -1.653,
+        -1.479, -1.305, -1.044, -0.783, -0.522, -0.261,
+        0.000, 0.261, 0.522, 0.783, 1.044, 1.305, 1.479,
+        1.653, 1.930, 2.172, 2.322, 2.500, 2.650, 2.853,
+        2.964, 3.139, 3.489, 3.839, 5.191
+    };
+};
+
+// Detector regions in |eta|: barrel, endcap with and without tracker, forward
+struct AbsEtaRegionAxis {
+    static constexpr JetVar var = JetVar::AbsEta;
+    static constexpr const char* name = "Eta";
+    static constexpr const char* symbol = "|#eta|";
+    static constexpr const char* title = "Jet |#eta|";
+    static constexpr std::array<double, 5> edges = {0.0, 1.3, 2.5, 3.0, 5.0};
+};
+
+struct PtAxis {
+    static constexpr JetVar var = JetVar::Pt;
+    static constexpr const char* name = "Pt";
+    static constexpr const char* symbol = "p_{T}";
+    static constexpr const char* title = "Jet p_{T} (GeV)";
+    static constexpr std::array<double, 13> edges = {
+        15, 25, 35, 50, 75, 100, 130, 170, 230, 300, 500, 1000, 4500
+    };
+};
+
+// Coarse pT ranges of the HistGivenPt and HistGivenBoth directories
+struct PtRegionAxis {
+    static constexpr JetVar var = JetVar::Pt;
+    static constexpr const char* name = "Pt";
+    static constexpr const char* symbol = "p_{T}";
+    static constexpr const char* title = "Jet p_{T} (GeV)";
+    static constexpr std::array<double, 7> edges = {15, 30, 50, 110, 500, 1000, 4500};
+};
+
+struct RhoAxis {
+    static constexpr JetVar var = JetVar::Rho;
+    static constexpr const char* name = "Rho";
+    static constexpr const char* symbol = "#rho";
+    static constexpr const char* title = "#rho (GeV)";
+    static constexpr std::array<double, 8> edges = {0, 5, 10, 15, 20, 30, 40, 70};
+};
+
+struct AreaAxis {
+    static constexpr JetVar var = JetVar::Area;
+    static constexpr const char* name = "Area";
+    static constexpr const char* symbol = "A";
+    static constexpr const char* title = "Jet area";
+    static constexpr std::array<double, 6> edges = {0.0, 0.4, 0.45, 0.5, 0.55, 1.0};
+};
+
+// Run 3 data taking years
+struct RunAxis {
+    static constexpr JetVar var = JetVar::Run;
+    static constexpr const char* name = "Run";
+    static constexpr const char* symbol = "run";
+    static constexpr const char* title = "Run number";
+    static constexpr std::array<double, 4> edges = {355100, 366403, 378981, 387000};
+};
+
+template <class Axis>
+struct AxisBins {
+    static constexpr int nBins = static_cast<int>(Axis::edges.size()) - 1;
+
+    // Bin of x in [0, nBins), -1 outside; the last edge belongs to the last bin
+    static int find(double x) {
+        const auto& edges = Axis::edges;
+        if (!(x >= edges.front()) || x > edges.back()) return -1;
+        const int bin = static_cast<int>(std::upper_bound(edges.begin(), edges.end(), x) - edges.begin()) - 1;
+        return std::min(bin, nBins - 1);
+    }
+
+    // e.g. Pt_15_30
+    static std::string rangeName(int bin) {
+        return std::string(Axis::name) + "_" + Helper::formatNumber(Axis::edges[bin]) +
+               "_" + Helper::formatNumber(Axis::edges[bin + 1]);
+    }
+};
+
+#endif // JETAXIS_H
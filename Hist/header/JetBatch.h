@@ -0,0 +1,69 @@
+#ifndef JETBATCH_H
+#define JETBATCH_H
+
+#include <cstddef>
+#include <vector>
+
+// Jet quantities that can be passed to correctionlib as inputs
+enum class JetColumn {
+    Area,
+    Eta,
+    Phi,
+    Pt,
+    Rho,
+    Run
+};
+
+/**
+ * JetBatch collects the selected jets of one or more events as
+ * structure-of-arrays columns, so that each correction is evaluated
+ * over all of them with a single ScaleObject::evaluateBatch call.
+ * The buffers are reused between batches: clear() keeps the capacity.
+ */
+struct JetBatch {
+    std::vector<double> area;
+    std::vector<double> eta;
+    std::vector<double> phi;
+    std::vector<double> pt;
+    std::vector<double> rho;  // per-event value, repeated for each jet
+    std::vector<double> run;  // per-event value, repeated for each jet
+
+    std::size_t size() const { return pt.size(); }
+
+    void clear() {
+        area.clear(); eta.clear(); phi.clear(); pt.clear(); rho.clear(); run.clear();
+    }
+
+    void reserve(std::size_t n) {
+        area.reserve(n); eta.reserve(n); phi.reserve(n); pt.reserve(n); rho.reserve(n); run.reserve(n);
+    }
+
+    void push(double jetArea, double jetEta, double jetPhi, double jetPt,
+              double eventRho, double eventRun) {
+        area.push_back(jetArea);
+        eta.push_back(jetEta);
+        phi.push_back(jetPhi);
+        pt.push_back(jetPt);
+        rho.push_back(eventRho);
+        run.push_back(eventRun);
+    }
+
+    // Drop the last jet pushed
+    void pop() {
+        area.pop_back(); eta.pop_back(); phi.pop_back(); pt.pop_back(); rho.pop_back(); run.pop_back();
+    }
+
+    const double* column(JetColumn col) const {
+        switch (col) {
+            case JetColumn::Area: return area.data();
+            case JetColumn::Eta:  return eta.data();
+            case JetColumn::Phi:  return phi.data();
+            case JetColumn::Pt:   return pt.data();
+            case JetColumn::Rho:  return rho.data();
+            case JetColumn::Run:  return run.data();
+        }
+        return nullptr;
+    }
+};
+
+#endif // JETBATCH_H
@@ -0,0 +1,114 @@
+#ifndef JETCOLUMNCACHE_H
+#define JETCOLUMNCACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Rtypes.h"
+
+/**
+ * JetColumnCache is a local columnar copy of the NanoAOD branches used by
+ * the event loop: run, luminosityBlock, event, Rho and the Jet_* arrays.
+ *
+ * The file is a sequence of blocks of up to blockEvents events. A block
+ * holds the per-event columns, the offsets of each event into the flat jet
+ * arrays of the block, and the jet columns. A footer lists the block
+ * offsets, the number of events and the hash of the source file list, so
+ * an incomplete or stale file is detected. The reader memory-maps the
+ * file: reading an event is a few pointer lookups, without ROOT I/O.
+ */
+class JetColumnCache {
+public:
+    // One event, pointing into the mapped file
+    struct EventView {
+        UInt_t run;
+        UInt_t luminosityBlock;
+        ULong64_t event;
+        Float_t rho;
+        UInt_t nJet;
+        const Float_t* pt;
+        const Float_t* eta;
+        const Float_t* phi;
+        const Float_t* mass;
+        const Float_t* area;
+        const Float_t* rawFactor;
+        const UChar_t* jetId;
+    };
+
+    // Streams events into a new cache file (written as path.tmp, renamed by close())
+    class Writer {
+    public:
+        Writer(const std::string& path, std::uint64_t sourceHash);
+        ~Writer();
+        void fill(UInt_t run, UInt_t luminosityBlock, ULong64_t event, Float_t rho, UInt_t nJet,
+                  const Float_t* pt, const Float_t* eta, const Float_t* phi, const Float_t* mass,
+                  const Float_t* area, const Float_t* rawFactor, const UChar_t* jetId);
+        void close();
+    private:
+        std::string path_;
+        std::uint64_t sourceHash_;
+        std::ofstream out_;
+        std::vector<std::uint64_t> blockOffsets_;
+        std::uint64_t nEvents_ = 0;
+        bool closed_ = false;
+
+        // Columns of the current block
+        std::vector<UInt_t> run_, luminosityBlock_;
+        std::vector<ULong64_t> event_;
+        std::vector<Float_t> rho_;
+        std::vector<UInt_t> jetOffset_;
+        std::vector<Float_t> pt_, eta_, phi_, mass_, area_, rawFactor_;
+        std::vector<UChar_t> jetId_;
+
+        void flushBlock();
+        template <typename T> void writeColumn(const std::vector<T>& column);
+    };
+
+    // Map an existing cache; throws std::runtime_error if it is missing or incomplete
+    explicit JetColumnCache(const std::string& path);
+    ~JetColumnCache();
+
+    JetColumnCache(const JetColumnCache&) = delete;
+    JetColumnCache& operator=(const JetColumnCache&) = delete;
+
+    // True if path is a complete cache built from the files with this hash
+    static bool isUsable(const std::string& path, std::uint64_t sourceHash);
+
+    Long64_t getNEvents() const { return nEvents_; }
+    std::uint64_t getSourceHash() const { return sourceHash_; }
+    // First event of every block, then getNEvents()
+    std::vector<Long64_t> getBlockStarts() const;
+
+    EventView getEvent(Long64_t entry) const;
+
+    static constexpr std::size_t blockEvents = 65536;
+
+private:
+    struct Block {
+        Long64_t firstEvent;
+        Long64_t nEvents;
+        const UInt_t* run;
+        const UInt_t* luminosityBlock;
+        const ULong64_t* event;
+        const Float_t* rho;
+        const UInt_t* jetOffset;
+        const Float_t* pt;
+        const Float_t* eta;
+        const Float_t* phi;
+        const Float_t* mass;
+        const Float_t* area;
+        const Float_t* rawFactor;
+        const UChar_t* jetId;
+    };
+
+    std::string path_;
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+    Long64_t nEvents_ = 0;
+    std::uint64_t sourceHash_ = 0;
+    std::vector<Block> blocks_;
+};
+
+#endif // JETCOLUMNCACHE_H
@@ -0,0 +1,112 @@
+#ifndef METADATAREGISTRY_H
+#define METADATAREGISTRY_H
+
+#include <string>
+#include <vector>
+
+#include "CorrectionImage.h"
+
+class ScaleObject;
+
+// Correction level of a baseKey, decided once from the key name
+enum class CorrectionLevel {
+    L1FastJet,
+    L2Relative,
+    L3Absolute,
+    L2L3Residual,
+    PtResolution,
+    ScaleFactor,
+    Other
+};
+
+// One version (V1, V2, ...) of a baseKey
+struct MetadataVersion {
+    std::string jsonFile;
+    std::string tag;
+    std::string label; // in the histogram names, e.g. hCorrV9M_<key>
+};
+
+// One baseKey of the metadata
+struct MetadataEntry {
+    int id = -1; // dense, in metadata order after filtering
+    std::string baseKey;
+    // Metadata file of the key, its top-level output directory; empty if only one file is read
+    std::string group;
+    CorrectionLevel level = CorrectionLevel::Other;
+    std::vector<MetadataVersion> versions;
+    // Version the others are compared to (ratios and differences)
+    std::size_t reference = 0;
+
+    std::vector<std::string> getLabels() const;
+};
+
+/**
+ * MetadataRegistry reads the metadata JSON once:
+ *     { "<baseKey>": [["<jsonFile>", "<tag>", "<label>"], ...], ... }
+ * with any number of versions per baseKey. The label is optional: two
+ * unlabeled versions are Old and New (hCorrOld_<key>, hCorrNew_<key>), more
+ * are V1, V2, ... Every version is compared to the reference version, the
+ * first one unless setReference() picks another.
+ *
+ * Several metadata files can be read into one registry, so that all their
+ * keys are evaluated in the same event loop with the correction JSONs loaded
+ * once. The keys of each file are then a group, written under a top-level
+ * directory named after the file (metadata_2024_V8MvsV9M/HistGivenPt/...);
+ * the same baseKey may be in several groups.
+ *
+ * Every baseKey gets a dense integer id and a CorrectionLevel. The keys can
+ * be filtered with regular expressions (e.g. only L2Relative), so that the
+ * other keys are neither evaluated nor booked. One registry is shared by
+ * everything that needs the metadata.
+ */
+class MetadataRegistry {
+public:
+    explicit MetadataRegistry(const std::string& metadataJsonPath);
+    // Throws std::runtime_error if two files have the same name (the same group)
+    explicit MetadataRegistry(const std::vector<std::string>& metadataJsonPaths);
+    ~MetadataRegistry() = default;
+
+    // Keep the baseKeys matching include (all if empty) and not matching exclude
+    // (none if empty); ECMAScript regular expressions matched anywhere in the key.
+    // Ids are reassigned. Throws std::runtime_error if no key is left.
+    void filter(const std::string& include, const std::string& exclude);
+
+    // Compare the versions of each baseKey to the one labeled label; the baseKeys
+    // without such a version keep their first version as reference
+    void setReference(const std::string& label);
+
+    // Load every jsonFile into scaleObject and check that it has the tag;
+    // throws std::runtime_error listing all the missing ones
+    void validate(const ScaleObject& scaleObject) const;
+
+    // The metadata files, comma separated
+    const std::string& getPath() const { return metadataJsonPath_; }
+    const std::vector<std::string>& getGroups() const { return groups_; }
+    const std::vector<MetadataEntry>& getEntries() const { return entries_; }
+    std::size_t size() const { return entries_.size(); }
+    std::vector<std::string> getBaseKeys() const;
+    // Every jsonFile with the tags used from it, for ScaleObject::preloadCorrections
+    std::vector<CorrectionImage::Source> getSources() const;
+
+    static CorrectionLevel levelFromKey(const std::string& baseKey);
+    static const char* levelName(CorrectionLevel level);
+
+    // Suffix of the histograms comparing version v to the reference: none with two
+    // versions (pRatio_<key>), the label of v otherwise (pRatioV9M_<key>)
+    static std::string comparisonSuffix(const std::vector<std::string>& labels, std::size_t v);
+
+    void print() const;
+
+private:
+    std::string metadataJsonPath_;
+    std::vector<std::string> groups_; // one per file, empty with one file
+    std::vector<MetadataEntry> entries_;
+    std::size_t nFiltered_ = 0;
+
+    // Append the keys of one metadata file, in group
+    void read(const std::string& metadataJsonPath, const std::string& group);
+    // Default labels, and check that they are unique and usable in histogram names
+    static void assignLabels(MetadataEntry& entry);
+};
+
+#endif // METADATAREGISTRY_H
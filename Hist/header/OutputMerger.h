@@ -0,0 +1,59 @@
+#ifndef OUTPUTMERGER_H
+#define OUTPUTMERGER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ComparisonSummary.h"
+#include "QuantileSketch.h"
+
+class TDirectory;
+class TH1;
+
+/**
+ * OutputMerger combines the output files of several jobs, like hadd, but
+ * also merges the quantile sketches (the q* TVectorD of HistGiven) instead
+ * of keeping the first one. Histograms are added; an object present in some
+ * files only (histograms are not written when empty) is taken from those.
+ * The Summary tree is rebuilt from the added sums (the sStats* TVectorD)
+ * and the added pRatio profiles. Other objects are skipped with a warning.
+ */
+class OutputMerger {
+public:
+    OutputMerger() = default;
+    ~OutputMerger();
+
+    // Add the content of the file at path; false if it cannot be read
+    bool add(const std::string& path);
+
+    // Write everything added so far to a new file at outPath
+    void write(const std::string& outPath) const;
+
+private:
+    struct Item {
+        std::string dir;   // path of the directory in the file, "" for the top
+        std::string name;
+        std::unique_ptr<TH1> hist;
+        std::unique_ptr<QuantileSketch> sketch;
+        std::vector<double> sums; // ComparisonSummary::nSums
+    };
+    std::vector<Item> items_; // in the order first read
+    std::unordered_map<std::string, std::size_t> index_; // dir/name -> items_
+    // Rows of the Summary trees, without their numbers, once per stats path
+    std::vector<ComparisonSummary::Row> summaryRows_;
+    std::unordered_set<std::string> summaryStats_;
+
+    void readDirectory(TDirectory* dir, const std::string& path);
+    Item& getItem(const std::string& dir, const std::string& name, bool& isNew);
+    // The Summary tree of the merged sums and profiles in dir
+    void writeSummary(TDirectory* dir) const;
+
+    // Disable copying and assignment
+    OutputMerger(const OutputMerger&) = delete;
+    OutputMerger& operator=(const OutputMerger&) = delete;
+};
+
+#endif // OUTPUTMERGER_H
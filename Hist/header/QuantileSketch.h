@@ -0,0 +1,64 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * QuantileSketch is a KLL sketch: the quantiles of a stream of values, with a
+ * rank error of about 1.7/k whatever the range of the values, in bounded
+ * memory (about 3k doubles) whatever the number of values.
+ *
+ * Level h keeps values of weight 2^h. The top level holds up to k values,
+ * and each level below 2/3 as many. When the sketch is full, the lowest full
+ * level is sorted and every other value, starting at a random offset, moves
+ * up one level with twice the weight. Two sketches of any size merge into
+ * one with the same error, so the sketches of the worker threads and of the
+ * jobs are merged with merge().
+ *
+ * The sketch is stored in the output file as the doubles of toVector().
+ */
+class QuantileSketch {
+public:
+    explicit QuantileSketch(int k = 64);
+
+    // NaN values are not added
+    void add(double x) {
+        if (x != x) return;
+        if (n_ == 0 || x < min_) min_ = x;
+        if (n_ == 0 || x > max_) max_ = x;
+        n_++;
+        levels_[0].push_back(x);
+        if (++nRetained_ >= maxRetained_) compress();
+    }
+
+    void merge(const QuantileSketch& other);
+
+    std::uint64_t getN() const { return n_; }
+    double getMin() const { return min_; }
+    double getMax() const { return max_; }
+
+    // Value of rank q in [0, 1]; 0 if the sketch is empty
+    double quantile(double q) const;
+
+    // Flat representation, and back; fromVector throws on a malformed vector
+    std::vector<double> toVector() const;
+    static QuantileSketch fromVector(const double* data, int size);
+
+private:
+    int k_;
+    std::uint64_t n_ = 0;
+    double min_ = 0.0;
+    double max_ = 0.0;
+    std::vector<std::vector<double>> levels_; // levels_[h]: values of weight 2^h
+    std::size_t nRetained_ = 0;   // values in all levels
+    std::size_t maxRetained_ = 0; // sum of the level capacities
+    std::uint64_t random_ = 0x9e3779b97f4a7c15ULL; // xorshift state for the offsets
+
+    std::size_t capacity(std::size_t level) const;
+    void addLevel();
+    void compress();
+    bool randomBit();
+};
+
+#endif // QUANTILESKETCH_H
@@ -0,0 +1,47 @@
+#ifndef REDUCEDCORRECTIONS_H
+#define REDUCEDCORRECTIONS_H
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "CompiledCorrection.h"
+
+/**
+ * ReducedCorrections caches corrections specialized to the inputs that stay
+ * constant over many jets: run (per run) and rho (per event). The binning
+ * and category nodes on these inputs are resolved once with
+ * CompiledCorrection::bindValue, so the per-jet evaluation only walks the
+ * nodes on the jet inputs.
+ *
+ * Reduced trees are cached per value of category inputs (run) and per
+ * interval between the bin edges of binned inputs (rho), so the cache stays
+ * small; inputs on uniform binnings are not bound (ScaleObject::reducibleInputs).
+ * One instance per event loop thread: it is not thread safe.
+ */
+class ReducedCorrections {
+public:
+    ReducedCorrections() = default;
+    ~ReducedCorrections() = default;
+
+    // compiled with inputs[i] fixed to values[i]; built on first use
+    const CompiledCorrection& get(const CompiledCorrection& compiled,
+                                  const std::vector<std::size_t>& inputs, const double* values);
+
+    std::size_t size() const;
+
+private:
+    struct Entry {
+        // Per bound input: sorted bin edges, or empty to key by the value itself
+        std::vector<std::vector<double>> edges;
+        std::map<std::vector<double>, std::shared_ptr<CompiledCorrection>> trees;
+        // The last tree handed out, for jets of the same run and event
+        std::vector<double> lastKey;
+        const CompiledCorrection* last = nullptr;
+    };
+    std::unordered_map<const CompiledCorrection*, Entry> entries_;
+    std::vector<double> key_; // scratch
+};
+
+#endif // REDUCEDCORRECTIONS_H
@@ -1,8 +1,9 @@
-
 #pragma once
 
 #include <iostream>
 #include <cmath>
+#include <memory>
+#include <vector>
 
 // ROOT includes
 #include <TROOT.h>
@@ -17,6 +18,32 @@
 // User-defined includes
 #include "SkimTree.h"
 #include "GlobalFlag.h"
+#include "JetBatch.h"
+#include "ReducedCorrections.h"
+#include "HistGiven.h"
+
+class ScaleObject;
+class CorrectionPlan;
+class MetadataRegistry;
+struct CorrectionPlanEntry;
+
+// All histograms filled by one event loop (the output file, or one worker thread),
+// indexed by the CorrectionPlan entry id
+struct HistBook {
+    std::unique_ptr<HistGivenPt> histGivenPt;
+    std::unique_ptr<HistGivenEta> histGivenEta;
+    std::unique_ptr<HistGivenBoth> histGivenBoth;
+};
+
+// Scratch buffers reused by every processBatch (evaluateEntry) call
+struct BatchBuffers {
+    std::vector<std::vector<double>> corrValues; // [version][jet]
+    std::vector<const double*> columns;
+    std::vector<double*> fusedOuts;
+    std::vector<double> corrFactors;
+    std::vector<int> ptCells, etaCells, bothCells; // [jet] directory in each view
+    ReducedCorrections reduced; // corrections bound to the current run and rho
+};
 
 class RunChannel{
 public:
@@ -24,13 +51,72 @@ public:
     explicit RunChannel(GlobalFlag& globalFlags);
     ~RunChannel() = default;
 
-    int Run(std::shared_ptr<SkimTree>& skimT, const std::string& metadataJsonPath, TFile* fout);
+    int Run(std::shared_ptr<SkimTree>& skimT, const MetadataRegistry& registry, TFile* fout);
+
+    // Same, with the corrections already loaded: several jobs can share plan and scaleObject
+    int Run(SkimTree& skimT, const CorrectionPlan& plan, const ScaleObject& scaleObject, TFile* fout);
+
+    // Print the progress of the event loop (default true)
+    void setShowProgress(bool showProgress) { showProgress_ = showProgress; }
+
+    // Evaluate every version of entry over the jets of batch into buffers.corrValues;
+    // the values of version v are in buffers.corrValues[entry.source(v)]
+    static void evaluateEntry(const CorrectionPlanEntry& entry, const JetBatch& batch,
+                              const ScaleObject& scaleObject, BatchBuffers& buffers);
 
 private:
     // Reference to GlobalFlag instance
     GlobalFlag& globalFlags_;
+    bool showProgress_ = true;
 
-    // Add any private member variables or methods here if needed
-};
+    // Cluster ranges a job is split into, whatever the number of threads
+    static constexpr Long64_t nRanges = 128;
 
+    // Asynchronous reading: events per batch and batches in flight between the threads
+    static constexpr std::size_t asyncBatchEvents = 256;
+    static constexpr std::size_t asyncRingSlots = 8;
 
+    // Book all histograms under dir
+    void bookHists(TDirectory* dir, const CorrectionPlan& plan, HistBook& book) const;
+
+    // Create the ROOT histograms of book in their directories, before the TFile is written;
+    // with writeEmpty, also the ones never filled. The Summary tree goes in dir
+    static void saveHists(const HistBook& book, bool writeEmpty, TDirectory* dir);
+
+    // Add the content of src to target (same metadata, same binning)
+    static void mergeHists(HistBook& target, const HistBook& src);
+
+    // Empty the histograms of book, as just booked
+    static void clearHists(HistBook& book);
+
+    // Process the job range of skimT on one or several threads (one in debug mode)
+    void processJob(SkimTree& skimT, const CorrectionPlan& plan, const ScaleObject& scaleObject,
+                    HistBook& book) const;
+
+    // Loop over entries [firstEntry, lastEntry) of skimT and fill book
+    void processRange(SkimTree& skimT, Long64_t firstEntry, Long64_t lastEntry,
+                      const CorrectionPlan& plan, const ScaleObject& scaleObject,
+                      HistBook& book, bool isMainLoop) const;
+
+    // Same as processRange, with GetEntry on a reader thread that fills an EventBatchRing
+    void processRangeAsync(SkimTree& skimT, Long64_t firstEntry, Long64_t lastEntry,
+                           const CorrectionPlan& plan, const ScaleObject& scaleObject,
+                           HistBook& book, bool isMainLoop) const;
+
+    // Append the jets of one event that fall in a directory of any booked view to batch
+    static void selectJets(int nJet, const Float_t* area, const Float_t* eta, const Float_t* phi,
+                           const Float_t* pt, double rho, double run, JetBatch& batch);
+    // Whether jet j of batch has a cell in HistGivenPt, HistGivenEta or HistGivenBoth
+    static bool isInAnyView(const JetBatch& batch, std::size_t j);
+
+    // Evaluate every plan entry over the jets of batch and fill book
+    void processBatch(const JetBatch& batch, const CorrectionPlan& plan,
+                      const ScaleObject& scaleObject, HistBook& book,
+                      BatchBuffers& buffers) const;
+
+    // Split the chain into cluster ranges and process them on nThreads workers; each range
+    // fills its own book and the books are merged in range order, so that the
+    // histograms are bit-identical for any nThreads
+    void processParallel(SkimTree& skimT, int nThreads, const CorrectionPlan& plan,
+                         const ScaleObject& scaleObject, HistBook& book) const;
+};
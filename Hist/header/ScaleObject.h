@@ -1,14 +1,21 @@
 #ifndef SCALEOBJECT_H
 #define SCALEOBJECT_H
 
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "SkimTree.h"
 #include "correction.h"         // Provided by correctionlib
 #include "GlobalFlag.h"
+#include "CompiledCorrection.h"
+#include "CorrectionImage.h"
+#include "FormulaCompiler.h"
+#include "CorrectionTable.h"
+#include "ReducedCorrections.h"
 
 #include "nlohmann/json.hpp"
 
@@ -19,6 +26,15 @@ struct CorrectionInfo {
     correction::Correction::Ref corrRef; // correctionlib reference
 };
 
+// How the versions of one baseKey relate, from the hashes of their correction trees
+struct VersionSharing {
+    // [version] earlier version with the same content (trees compared, not only hashes), or -1
+    std::vector<int> sameAs;
+    // The versions that are not copies have the same binning: one bin search for all
+    // (only with the native or lookup-table backends, it bypasses correctionlib)
+    bool fused = false;
+};
+
 class ScaleObject {
 public: 
     explicit ScaleObject(GlobalFlag& globalFlags);
@@ -35,6 +51,85 @@ public:
                                   const double& jetPt,
                                   const std::string &syst) const;
 
+    // Same as above, for a correction already resolved with getCorrectionRef
+    double evaluateCorrection(const correction::Correction::Ref& corrRef,
+                          const std::vector<double>& inputs) const;
+
+    double evaluateJerSF(const correction::Correction::Ref& corrRef,
+                                  const double& jetEta,
+                                  const double& jetPt,
+                                  const std::string &syst) const;
+
+    // Batched structure-of-arrays evaluation over nJets jets:
+    //   out[j] = correction(columns[0][j], columns[1][j], ...)
+    // The correctionlib input vector is built once per call and reused for every jet.
+    void evaluateBatch(const correction::Correction::Ref& corrRef,
+                       const std::vector<const double*>& columns,
+                       std::size_t nJets, double* out) const;
+
+    // Same for a correction with a string input (JER SF): columns are its numeric inputs
+    // in order (e.g. eta, pt), and the string input is syst for every jet
+    void evaluateJerSFBatch(const correction::Correction::Ref& corrRef,
+                            const std::vector<const double*>& columns,
+                            std::size_t nJets, const std::string& syst, double* out) const;
+
+    // Load (once) the CorrectionSet of jsonFile and return the correction for tag
+    correction::Correction::Ref getCorrectionRef(const std::string& jsonFile, const std::string& tag) const;
+
+    // Load the CorrectionSets of all sources before the event loop, on nThreads threads,
+    // from the image of their corrections in cacheDir (built first if missing or stale).
+    // Without image, the JSON files are parsed, still in parallel; the files that fail
+    // are left to getCorrectionRef.
+    void preloadCorrections(const std::vector<CorrectionImage::Source>& sources, int nThreads = 8,
+                            const std::string& cacheDir = "cache/corrections") const;
+
+    // Native backend: build a CompiledCorrection for every correction resolved so far,
+    // compile their formulas and keep the ones that agree with correctionlib.
+    // Must be called before the event loop; the others keep using correctionlib.
+    void compileNative();
+
+    // Lookup-table mode: tabulate every correction resolved so far (bound to the
+    // systematic for JER SF), with relative error below tolerance. Jets outside
+    // the tables or in cells above tolerance are evaluated exactly.
+    // Must be called before the event loop, after compileNative() if both are used.
+    void buildTables(double tolerance);
+
+    // compileNative() and/or buildTables() as selected in GlobalFlag, then hashCorrections()
+    void prepareBackends();
+
+    // Hash the tree of every correction resolved so far and, with -b native or -t, keep
+    // an exact evaluator (native if compiled, else validated against correctionlib) of
+    // those without string inputs, for fused and reduced evaluation.
+    void hashCorrections();
+
+    // Sharing between the versions of one baseKey; all -1 and not fused before hashCorrections().
+    // Copies are found in every backend (their values are reused), fusion only with -b native or -t.
+    VersionSharing shareVersions(const std::vector<correction::Correction::Ref>& refs) const;
+
+    // Versions with the same structure (shareVersions().fused): one bin search per jet,
+    // then outs[v][j] from the leaf of each correction
+    void evaluateFusedBatch(const std::vector<correction::Correction::Ref>& refs,
+                            const std::vector<const double*>& columns,
+                            std::size_t nJets, const std::vector<double*>& outs) const;
+
+    // Whether value of input falls in a category or the binning of corrRef, see
+    // CompiledCorrection::hasBranchFor(); true when the tree of corrRef is unknown
+    bool hasBranchFor(const correction::Correction::Ref& corrRef, std::size_t input, double value) const;
+
+    // The inputs among candidates on which the exact evaluator of corrRef has binning
+    // (non-uniform) or category nodes, i.e. worth binding; empty without exact evaluator
+    std::vector<std::size_t> reducibleInputs(const correction::Correction::Ref& corrRef,
+                                             const std::vector<std::size_t>& candidates) const;
+
+    // evaluateBatch with partial evaluation: the inputs listed in invariant (run, rho) are
+    // bound once for each run of consecutive jets with the same values, and the jets are
+    // evaluated by the reduced correction from reduced. Same as evaluateBatch for
+    // corrections with a lookup table or without an exact evaluator.
+    void evaluateBatchReduced(const correction::Correction::Ref& corrRef,
+                              const std::vector<const double*>& columns,
+                              const std::vector<std::size_t>& invariant,
+                              std::size_t nJets, double* out, ReducedCorrections& reduced) const;
+
 
 private:
     GlobalFlag& globalFlags_;
@@ -53,9 +148,48 @@ private:
 
     // In your private members:
     mutable std::unordered_map<std::string, std::shared_ptr<correction::CorrectionSet>> correctionSets_;
-
-    // Modify the declaration of getCorrectionRef:
-    correction::Correction::Ref getCorrectionRef(const std::string& jsonFile, const std::string& tag) const;
+    // Guards correctionSets_, so that worker threads can share one ScaleObject
+    mutable std::mutex correctionSetsMutex_;
+    // (jsonFile, tag) of every correction handed out by getCorrectionRef
+    mutable std::vector<std::pair<std::string, std::string>> resolvedCorrections_;
+    // Reduced JSON of the files loaded from a CorrectionImage, parsed again by parseResolved
+    mutable std::unordered_map<std::string, std::string> reducedJsons_;
+
+    // Native backend, filled by compileNative() and read-only afterwards.
+    // The compiler owns the loaded libraries, so it is declared first.
+    std::unique_ptr<FormulaCompiler> formulaCompiler_;
+    std::unordered_map<const correction::Correction*, std::shared_ptr<CompiledCorrection>> compiled_;
+    // Corrections with a string input (JER SF), bound to the systematic
+    std::map<std::pair<const correction::Correction*, std::string>, std::shared_ptr<CompiledCorrection>> compiledBound_;
+
+    // Lookup tables, filled by buildTables() and read-only afterwards
+    std::unordered_map<const correction::Correction*, std::unique_ptr<CorrectionTable>> tables_;
+    std::map<std::pair<const correction::Correction*, std::string>, std::unique_ptr<CorrectionTable>> tablesBound_;
+
+    // Filled by hashCorrections() and read-only afterwards: the parsed tree of every
+    // correction (for its hashes), and the exact evaluators
+    std::unordered_map<const correction::Correction*, std::shared_ptr<CompiledCorrection>> trees_;
+    std::unordered_map<const correction::Correction*, std::shared_ptr<CompiledCorrection>> exact_;
+
+    // CompiledCorrection of every resolved correction that can be parsed; contentKey
+    // gets the JSON files and tags
+    std::vector<std::pair<correction::Correction::Ref, std::shared_ptr<CompiledCorrection>>>
+        parseResolved(std::string& contentKey) const;
+
+    // -b native or -t: evaluators other than correctionlib may be used
+    bool usesOwnEvaluators() const;
+
+    // Compare compiled with correctionlib on random inputs (stringInput < 0: none)
+    bool validateCompiled(const correction::Correction& corr, const CompiledCorrection& compiled,
+                        int stringInput, const std::string& stringValue) const;
+    // Evaluate compiled, returning 1.0 (and printing with the name of the caller) on error
+    double evaluateCompiled(const CompiledCorrection& compiled, const double* inputs,
+                            const char* caller) const;
+
+    // Evaluate already formatted inputs, returning 1.0 (and printing with the name of the caller) on error
+    using CorrType = correction::Variable::Type;
+    double evaluateFormatted(const correction::Correction::Ref& corrRef,
+                             const std::vector<CorrType>& formattedInputs, const char* caller) const;
 
 };
 
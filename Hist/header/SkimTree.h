@@ -7,9 +7,14 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <memory>
+#include <utility>
 #include <nlohmann/json.hpp>
 
 #include "GlobalFlag.h"
+#include "JetColumnCache.h"
+#include "FileStager.h"
+#include "InputFileIndex.h"
 
 class SkimTree{
 public:
@@ -33,6 +38,45 @@ public:
     void loadJobFileNames();
     void loadTree();
 
+    // Entry range [first, last) of the chain (or of the jet cache) that this job processes.
+    // With per-file entry counts, job N of M gets the N-th of M equal slices of the
+    // sample's entries; otherwise all entries of its files.
+    Long64_t getJobFirstEntry() const;
+    Long64_t getJobLastEntry() const;
+
+    // Read the events from the columnar cache at cachePath instead of the chain.
+    // The cache is built first (with loadTree()) if it is missing or was built
+    // from other files.
+    void loadJetCache(const std::string& cachePath);
+    bool isCached() const { return jetCache_ != nullptr; }
+
+    // Instead of loadTree(): copy the job files to local disk in the background.
+    // nextStagedFile() then points the chain at each file as soon as it is
+    // staged, with the job range within that file; it returns false at the end.
+    void startStaging(const FileStager::Config& config);
+    bool isStaging() const { return stager_ != nullptr; }
+    bool nextStagedFile();
+
+    // Read only these branches besides run, luminosityBlock, event, nJet, Jet_pt
+    // and Jet_eta ("Rho" is the rho branch of the year); empty means all.
+    // Worker clones inherit the selection.
+    void activateBranches(const std::vector<std::string>& branches);
+
+    // Validate the input files with this index instead of one of its own, and leave
+    // saving it to the caller; slices cloned afterwards share it
+    void setFileIndex(std::shared_ptr<InputFileIndex> fileIndex) { fileIndex_ = std::move(fileIndex); }
+
+    // Job nthJob of the same sample and number of jobs, with the file list already
+    // read by loadInputJson(); call loadJobFileNames() and loadTree() on it
+    std::unique_ptr<SkimTree> cloneForSlice(int nthJob) const;
+    std::string getOutName() const { return outName_; }
+
+    // Multi-threading: a worker gets its own TChain and branch buffers over the same files
+    std::unique_ptr<SkimTree> cloneForWorker() const;
+    // Split the chain into entry ranges aligned to TTree cluster boundaries,
+    // each holding at least minEntries entries (ranges never span two files)
+    std::vector<std::pair<Long64_t, Long64_t>> getClusterRanges(Long64_t minEntries);
+
     // Accessors for tree variables (public for direct access)
     // {} in the end is to initialise
     // Event information
@@ -70,12 +114,59 @@ private:
     std::string inputJsonPath_ = "./FilesSkim_2022_GamJet.json";
     std::vector<std::string> loadedAllFileNames_;
     std::vector<std::string> loadedJobFileNames_;
+    // Entries of each file of loadedAllFileNames_, empty when unknown
+    std::vector<Long64_t> loadedAllFileEntries_;
+    // Splitting by entries: the job covers [jobFirstInFile_, end) of its first file
+    // and [0, jobLastInFile_) of its last file
+    bool splitByEntries_ = false;
+    Long64_t jobFirstInFile_ = 0;
+    Long64_t jobLastInFile_ = 0;
+    // Job range in chain coordinates, set by loadTree()
+    Long64_t jobFirstEntry_ = 0;
+    Long64_t jobLastEntry_ = -1;
+    // Files accepted by loadTree() with their number of entries
+    std::vector<std::pair<std::string, Long64_t>> loadedTreeFiles_;
 
     Int_t fCurrent_; // Current Tree number in a TChain
 
     // ROOT TChain
     std::unique_ptr<TChain> fChain_;
 
+    // Threads opening the input files in loadTree()
+    static constexpr int nValidationWorkers = 8;
+    // Shared file index, see setFileIndex(); null means a local one
+    std::shared_ptr<InputFileIndex> fileIndex_;
+    // Where the NanoAOD files are read from
+    static constexpr const char* eosPrefix = "/eos/cms/";
+    static constexpr const char* xrootdPrefix = "root://cms-xrd-global.cern.ch/";
+
+    // Fill loadedAllFileEntries_ from EntriesNano_*.json or the InputFileIndex cache
+    bool loadAllFileEntries();
+    // Select the files and the entry range of this job from loadedAllFileEntries_
+    void splitJobByEntries();
+
+    // Staging, see startStaging()
+    std::unique_ptr<FileStager> stager_;
+    bool hasStagedFile_ = false;
+    std::size_t stagedIndex_ = 0;
+    int stagedProcessed_ = 0;
+    int stagedFailed_ = 0;
+    // Job files with their size and adler32 from ChecksumsNano_*.json when available
+    std::vector<StageRequest> loadStageRequests() const;
+
+    // Optional branches to read, see activateBranches()
+    std::vector<std::string> activeBranches_;
+    bool isBranchActive(const std::string& branch) const;
+    // Enable and address the branches used in the event loop
+    void setBranches();
+    // NanoAOD name of the rho branch for year_
+    std::string getRhoBranchName() const;
+
+    // Memory-mapped jet cache, shared with the worker clones
+    std::shared_ptr<const JetColumnCache> jetCache_;
+    std::uint64_t getJobFilesHash() const;
+    void buildJetCache(const std::string& cachePath);
+
     // Disable copying and assignment
     SkimTree(const SkimTree&) = delete;
     SkimTree& operator=(const SkimTree&) = delete;
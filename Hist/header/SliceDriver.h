@@ -0,0 +1,67 @@
+#ifndef SLICEDRIVER_H
+#define SLICEDRIVER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobalFlag.h"
+
+class SkimTree;
+class InputFileIndex;
+class ScaleObject;
+class CorrectionPlan;
+class MetadataRegistry;
+
+/**
+ * SliceDriver runs several jobs (slices) of one sample in a single process:
+ * job N of M still reads the same files and writes the same
+ * output/<sampKey>_Hist_NofM.root as ./runMain -o <sampKey>_Hist_NofM.root,
+ * but the metadata, the correction sets (and the native/lookup-table
+ * backends), the input file list and the InputFileIndex (with its pool of
+ * file openers) are loaded once and shared by all slices, which run
+ * concurrently on a pool of threads. A ChunkWorker uses
+ * it the same way to run the slices handed out by a ChunkCoordinator.
+ */
+class SliceDriver {
+public:
+    SliceDriver(GlobalFlag& globalFlags, std::string sampKey, int nSlices);
+    ~SliceDriver();
+
+    // Read the file list and the corrections; needed once before runSlice()
+    void prepare(const std::string& jsonDir, const MetadataRegistry& registry);
+
+    // Process slice nthJob into outDir/<sampKey>_Hist_<nthJob>of<nSlices>.root.
+    // The file is written under a temporary name (.part<pid>) and renamed when complete.
+    // Thread-safe; returns false (and prints why) if the slice failed.
+    bool runSlice(int nthJob, const std::string& outDir) const;
+
+    // prepare(), then run slices (1-based, all if empty) with nWorkers slices at a time.
+    // Returns the number of slices that failed.
+    int run(const std::vector<int>& slices, int nWorkers, const std::string& jsonDir,
+            const MetadataRegistry& registry, const std::string& outDir);
+
+    // Merge the file checks of the slices run so far into the cache file;
+    // run() calls it once at the end
+    void saveFileIndex() const;
+
+    // Parse a list such as "1,3,5-7" of slices in [1, nSlices]
+    static std::vector<int> parseSlices(const std::string& list, int nSlices);
+
+private:
+    GlobalFlag& globalFlags_;
+    std::string sampKey_;
+    int nSlices_;
+
+    // Shared by all slices, set by prepare()
+    std::unique_ptr<SkimTree> sample_;
+    std::shared_ptr<InputFileIndex> fileIndex_;
+    std::unique_ptr<ScaleObject> scaleObject_;
+    std::unique_ptr<CorrectionPlan> plan_;
+
+    // Disable copying and assignment
+    SliceDriver(const SliceDriver&) = delete;
+    SliceDriver& operator=(const SliceDriver&) = delete;
+};
+
+#endif // SLICEDRIVER_H
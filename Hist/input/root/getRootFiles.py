@@ -37,6 +37,40 @@ def getEvents(dataset):
         print(f"Error fetching event count for dataset '{dataset}': {e}")
         return 0
 
+def getFileEntries(dataset):
+    """
+    Fetches the number of events of each file of a dataset using dasgoclient.
+    """
+    try:
+        dasquery = ["dasgoclient", "-query=file dataset=%s | grep file.name, file.nevents" % dataset]
+        output = subprocess.check_output(dasquery, stderr=subprocess.STDOUT)
+        entries = {}
+        for line in output.decode('utf-8').strip().splitlines():
+            fields = line.split()
+            if len(fields) == 2:
+                entries[fields[0]] = int(fields[1])
+        return entries
+    except (subprocess.CalledProcessError, ValueError) as e:
+        print(f"Error fetching file entries for dataset '{dataset}': {e}")
+        return {}
+
+def getFileChecksums(dataset):
+    """
+    Fetches the size and adler32 checksum of each file of a dataset using dasgoclient.
+    """
+    try:
+        dasquery = ["dasgoclient", "-query=file dataset=%s | grep file.name, file.size, file.adler32" % dataset]
+        output = subprocess.check_output(dasquery, stderr=subprocess.STDOUT)
+        checksums = {}
+        for line in output.decode('utf-8').strip().splitlines():
+            fields = line.split()
+            if len(fields) == 3:
+                checksums[fields[0]] = {"size": int(fields[1]), "adler32": fields[2]}
+        return checksums
+    except (subprocess.CalledProcessError, ValueError) as e:
+        print(f"Error fetching file checksums for dataset '{dataset}': {e}")
+        return {}
+
 def formatNum(num):
     """
     Formats a number into a human-readable string with suffixes.
@@ -66,6 +100,8 @@ def main():
 
         for year in Years:
             toNano = {}
+            toEntries = {}
+            toChecksums = {}
             toHist = {}
             toJobs = {}
             allJobsYear = 0
@@ -90,6 +126,14 @@ def main():
                     continue
 
                 toNano[sampleKey] = filesNano
+                # Entries per file, used by the C++ code to split jobs by entries
+                fileEntries = getFileEntries(dataset)
+                if all(f in fileEntries for f in filesNano):
+                    toEntries[sampleKey] = {f: fileEntries[f] for f in filesNano}
+                # Size and checksum per file, used to verify the staged copies
+                fileChecksums = getFileChecksums(dataset)
+                if fileChecksums:
+                    toChecksums[sampleKey] = {f: fileChecksums[f] for f in filesNano if f in fileChecksums}
                 nFiles = len(filesNano)
                 nEvents = getEvents(dataset)
                 evtStr = formatNum(nEvents)
@@ -119,12 +163,18 @@ def main():
             allJobsChannel += allJobsYear
             # Define output JSON file paths
             filesNanoPath = f"{jsonDir}/FilesNano_{channel}_{year}.json"
+            entriesNanoPath = f"{jsonDir}/EntriesNano_{channel}_{year}.json"
+            checksumsNanoPath = f"{jsonDir}/ChecksumsNano_{channel}_{year}.json"
             jobsHistPath = f"{jsonDir}/JobsHist_{channel}_{year}.json"
             filesHistPath = f"{jsonDir}/FilesHist_{channel}_{year}.json"
             
             # Write JSON files
             with open(filesNanoPath, 'w') as f:
                 json.dump(toNano, f, indent=4)
+            with open(entriesNanoPath, 'w') as f:
+                json.dump(toEntries, f, indent=4)
+            with open(checksumsNanoPath, 'w') as f:
+                json.dump(toChecksums, f, indent=4)
             with open(jobsHistPath, 'w') as f:
                 json.dump(toJobs, f, indent=4)
             with open(filesHistPath, 'w') as f:
@@ -1,6 +1,15 @@
 #include "RunChannel.h"
 #include "SkimTree.h"
 #include "GlobalFlag.h"
+#include "SliceDriver.h"
+#include "ChunkCoordinator.h"
+#include "ChunkWorker.h"
+#include "GridScan.h"
+#include "Helper.h"
+#include "CorrectionPlan.h"
+#include "MetadataRegistry.h"
+#include "OutputMerger.h"
+#include "ScaleObject.h"
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -20,9 +29,12 @@ int main(int argc, char* argv[]) {
     std::cerr << "Error: No arguments provided. Use -h for help." << std::endl;
     return 1;
   }
-  //const std::string& metadataJsonPath = "input/jerc/metadata_jec.json";
-  //const std::string& metadataJsonPath = "input/jerc/metadata_2025.json";
-  const std::string& metadataJsonPath = "input/jerc/metadata_2024_V8MvsV9M.json";
+  // Comma-separated: several metadata files are evaluated in one event loop, e.g.
+  // "input/jerc/metadata_2024_V8MvsV9M.json,input/jerc/metadata_2025.json,input/jerc/metadata_jec.json"
+  std::string metadataJsonPath = "input/jerc/metadata_2024_V8MvsV9M.json";
+  std::string keyInclude;
+  std::string keyExclude;
+  std::string referenceLabel;
 
 
   std::string jsonDir = "input/root/json/";
@@ -43,16 +55,97 @@ int main(int argc, char* argv[]) {
 
   nlohmann::json js;
   std::string outName;
+  int nThreads = 1;
+  GlobalFlag::CorrectionBackend backend = GlobalFlag::CorrectionBackend::Interpreter;
+  double lutTolerance = 0.0;
+  std::string jetCachePath;
+  bool asyncRead = false;
+  bool writeEmpty = false;
+  FileStager::Config stageConfig;
+  bool isStaging = false;
+  int nSlices = 0;
+  std::string sliceList;
+  std::string coordinatorSocket;
+  std::string workerSocket;
+  std::string gridSpec;
+  std::string mergeOutput;
 
   //--------------------------------
   // Parse command-line options
   //--------------------------------
   int opt;
-  while ((opt = getopt(argc, argv, "o:h")) != -1) {
+  while ((opt = getopt(argc, argv, "o:j:b:t:c:aes:d:x:n:r:q:w:g:m:k:K:R:u:h")) != -1) {
     switch (opt) {
       case 'o':
         outName = optarg;
         break;
+      case 'j':
+        nThreads = std::max(1, std::atoi(optarg));
+        break;
+      case 'b':
+        if (std::string(optarg) == "native") {
+          backend = GlobalFlag::CorrectionBackend::Native;
+        } else if (std::string(optarg) != "interpreter") {
+          std::cerr << "Unknown backend: " << optarg << " (use native or interpreter)" << std::endl;
+          return 1;
+        }
+        break;
+      case 't':
+        lutTolerance = std::atof(optarg);
+        if (lutTolerance <= 0) {
+          std::cerr << "The lookup-table tolerance must be positive: " << optarg << std::endl;
+          return 1;
+        }
+        break;
+      case 'c':
+        jetCachePath = optarg;
+        break;
+      case 'a':
+        asyncRead = true;
+        break;
+      case 'e':
+        writeEmpty = true;
+        break;
+      case 's':
+        isStaging = true;
+        stageConfig.nWorkers = std::max(1, std::atoi(optarg));
+        break;
+      case 'd':
+        stageConfig.diskBudget = static_cast<Long64_t>(std::atof(optarg) * 1024 * 1024 * 1024);
+        break;
+      case 'x':
+        stageConfig.command = optarg;
+        break;
+      case 'n':
+        nSlices = std::atoi(optarg);
+        break;
+      case 'r':
+        sliceList = optarg;
+        break;
+      case 'q':
+        coordinatorSocket = optarg;
+        break;
+      case 'w':
+        workerSocket = optarg;
+        break;
+      case 'g':
+        gridSpec = optarg;
+        break;
+      case 'm':
+        metadataJsonPath = optarg;
+        break;
+      case 'k':
+        keyInclude = optarg;
+        break;
+      case 'K':
+        keyExclude = optarg;
+        break;
+      case 'R':
+        referenceLabel = optarg;
+        break;
+      case 'u':
+        mergeOutput = optarg;
+        break;
       case 'h':
         // Loop through each JSON file and print available keys
         for (const auto& jsonFile : jsonFiles) {
@@ -75,6 +168,31 @@ int main(int argc, char* argv[]) {
             std::cout << "./runMain -o " << element.key() << "_Hist_1of100.root" << std::endl;
           }
         }
+        std::cout << "\nOptions:" << std::endl;
+        std::cout << "  -m PATH[,PATH...] : metadata JSON of the corrections to compare (default " << metadataJsonPath << ");" << std::endl;
+        std::cout << "                      several files are evaluated in the same event loop, each in its own top-level directory" << std::endl;
+        std::cout << "  -k REGEX : only the baseKeys matching REGEX, e.g. L2Relative" << std::endl;
+        std::cout << "  -K REGEX : skip the baseKeys matching REGEX" << std::endl;
+        std::cout << "  -R LABEL : compare the versions to the one labeled LABEL (default: the first version)" << std::endl;
+        std::cout << "  -j N : run the event loop on N threads (default 1)" << std::endl;
+        std::cout << "  -b native|interpreter : evaluate corrections with compiled formulas or correctionlib (default interpreter)" << std::endl;
+        std::cout << "  -t TOL : approximate corrections by lookup tables with relative error below TOL (e.g. 1e-4)" << std::endl;
+        std::cout << "  -c PATH : read the events from the jet cache PATH, building it first if needed" << std::endl;
+        std::cout << "  -a : read the events on a separate thread, overlapping I/O with the corrections" << std::endl;
+        std::cout << "  -e : also write the histograms no jet filled, empty (by default they are skipped)" << std::endl;
+        std::cout << "  -s N : copy the input files to ./stage with N parallel transfers and process each as it arrives" << std::endl;
+        std::cout << "  -d GB : disk budget of ./stage (default 20)" << std::endl;
+        std::cout << "  -x CMD : transfer command, {name} is the file name and {dst} the local path" << std::endl;
+        std::cout << "           (default: " << stageConfig.command << ")" << std::endl;
+        std::cout << "  -n M : with -o SAMPLEKEY, run the M jobs of the sample in this process, sharing the corrections;" << std::endl;
+        std::cout << "         -j is then the number of jobs run at a time (not with -c or -s)" << std::endl;
+        std::cout << "  -r LIST : with -n, run only these jobs, e.g. 1,3,5-7" << std::endl;
+        std::cout << "  -q SOCKET : with -o SAMPLEKEY -n M, hand out the M jobs to workers on the Unix socket SOCKET" << std::endl;
+        std::cout << "  -w SOCKET : worker, process the jobs handed out by the coordinator on SOCKET (not with -c or -s)" << std::endl;
+        std::cout << "  -g SPEC : no events, compare the versions on a grid of inputs, e.g." << std::endl;
+        std::cout << "            eta:-5.191:5.191:104,pt:10:4500:100:log,rho:0:60:6,area:0.5 (or 'default');" << std::endl;
+        std::cout << "            -o names the output (default GridScan_<metadata>.root), -j is the number of threads" << std::endl;
+        std::cout << "  -u OUT FILE... : merge the output files of several jobs into OUT, histograms and quantile sketches" << std::endl;
         return 0;
       default:
         std::cerr << "Use -h for help" << std::endl;
@@ -82,6 +200,63 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  // The jobs of -n and -w read their files from the chain: a jet cache or staging
+  // area of one job would be wrong for the others
+  if ((nSlices > 0 || !workerSocket.empty()) && coordinatorSocket.empty() &&
+      (!jetCachePath.empty() || isStaging)) {
+    std::cerr << "-c and -s cannot be used with -n or -w, run each job separately" << std::endl;
+    return 1;
+  }
+
+  // A jet cache is read without ROOT I/O: there would be nothing to stage
+  if (!jetCachePath.empty() && isStaging) {
+    std::cerr << "-c and -s cannot be used together, the jet cache replaces the staged input" << std::endl;
+    return 1;
+  }
+
+  // Before any TFile or TChain: the file validation, the readers (-a), the event loop
+  // (-j) and the jobs (-n) use ROOT from several threads
+  ROOT::EnableThreadSafety();
+
+  if (!mergeOutput.empty()) {
+    if (optind >= argc) {
+      std::cerr << "Nothing to merge: -u OUT FILE..." << std::endl;
+      return 1;
+    }
+    OutputMerger merger;
+    int nFailed = 0;
+    for (int i = optind; i < argc; ++i) {
+      if (!merger.add(argv[i])) nFailed++;
+    }
+    merger.write(mergeOutput);
+    return nFailed > 0 ? 1 : 0;
+  }
+
+  if (!coordinatorSocket.empty()) {
+    if (nSlices < 1) {
+      std::cerr << "The coordinator needs the number of jobs: -n M" << std::endl;
+      return 1;
+    }
+    ChunkCoordinator coordinator(coordinatorSocket, outName, nSlices);
+    return coordinator.run() > 0 ? 1 : 0;
+  }
+
+  const std::vector<std::string> metadataJsonPaths = Helper::splitString(metadataJsonPath, ",");
+  if (!gridSpec.empty() && outName.empty()) {
+    outName = "GridScan";
+    for (const auto& path : metadataJsonPaths) {
+      outName += "_" + fs::path(path).stem().string();
+    }
+    outName += ".root";
+  }
+
+  // A worker learns the sample from the coordinator
+  std::unique_ptr<ChunkWorker> chunkWorker;
+  if (!workerSocket.empty()) {
+    chunkWorker = std::make_unique<ChunkWorker>(workerSocket);
+    outName = chunkWorker->getSampKey();
+  }
+
 	std::cout << "\n--------------------------------------" << std::endl;
     std::cout << " Set GlobalFlag.cpp" << std::endl;
     std::cout << "--------------------------------------" << std::endl;
@@ -90,8 +265,64 @@ int main(int argc, char* argv[]) {
     GlobalFlag globalFlag(outName);
     globalFlag.setDebug(false);
     globalFlag.setNDebug(1000);
+    // With -n, -j counts the jobs run at a time, each on one thread
+    globalFlag.setNThreads(nSlices > 0 && workerSocket.empty() ? 1 : nThreads);
+    globalFlag.setCorrectionBackend(backend);
+    globalFlag.setLutTolerance(lutTolerance);
+    globalFlag.setAsyncRead(asyncRead);
+    globalFlag.setWriteEmpty(writeEmpty);
     globalFlag.printFlags();  
 
+    std::cout << "\n--------------------------------------" << std::endl;
+    std::cout << " Read MetadataRegistry.cpp" << std::endl;
+    std::cout << "--------------------------------------" << std::endl;
+    MetadataRegistry registry(metadataJsonPaths);
+    registry.filter(keyInclude, keyExclude);
+    registry.setReference(referenceLabel);
+    registry.print();
+
+    // Output directory setup
+    std::string outDir = "output";
+    mkdir(outDir.c_str(), S_IRWXU);
+
+    if (!gridSpec.empty()) {
+        std::cout << "\n--------------------------------------" << std::endl;
+        std::cout << " Scan the corrections with GridScan.cpp" << std::endl;
+        std::cout << "--------------------------------------" << std::endl;
+        GridScan scan(gridSpec == "default" ? "" : gridSpec);
+        scan.printGrid();
+        ScaleObject scaleObject(globalFlag);
+        CorrectionPlan plan(registry, scaleObject, InputBranchMap());
+        scaleObject.prepareBackends();
+        plan.specialize(scaleObject);
+        plan.printPlan();
+        auto fout = std::make_unique<TFile>((outDir + "/" + outName).c_str(), "RECREATE");
+        scan.run(plan, scaleObject, nThreads, fout.get());
+        fout->Write();
+        std::cout << "Output file: " << fout->GetName() << std::endl;
+        return 0;
+    }
+
+    if (chunkWorker) {
+        std::cout << "\n--------------------------------------" << std::endl;
+        std::cout << " Run the jobs of ChunkCoordinator.cpp" << std::endl;
+        std::cout << "--------------------------------------" << std::endl;
+        SliceDriver driver(globalFlag, chunkWorker->getSampKey(), chunkWorker->getNChunks());
+        driver.prepare(jsonDir, registry);
+        chunkWorker->run(driver, outDir);
+        return 0;
+    }
+
+    if (nSlices > 0) {
+        std::cout << "\n--------------------------------------" << std::endl;
+        std::cout << " Run all jobs with SliceDriver.cpp" << std::endl;
+        std::cout << "--------------------------------------" << std::endl;
+        SliceDriver driver(globalFlag, outName, nSlices);
+        const int nFailed = driver.run(SliceDriver::parseSlices(sliceList, nSlices), nThreads,
+                                       jsonDir, registry, outDir);
+        return nFailed > 0 ? 1 : 0;
+    }
+
     std::cout << "\n--------------------------------------" << std::endl;
     std::cout << " Set and load SkimTree.cpp" << std::endl;
     std::cout << "--------------------------------------" << std::endl;
@@ -102,16 +333,19 @@ int main(int argc, char* argv[]) {
     skimT->setInputJsonPath(jsonDir);
     skimT->loadInputJson();
     skimT->loadJobFileNames();
-    skimT->loadTree();
+    if (!jetCachePath.empty()) {
+        skimT->loadJetCache(jetCachePath);
+    } else if (isStaging) {
+        skimT->startStaging(stageConfig);
+    } else {
+        skimT->loadTree();
+    }
 
     std::cout << "\n--------------------------------------" << std::endl;
     std::cout << " Set and load ScaleObject.cpp" << std::endl;
     std::cout << "--------------------------------------" << std::endl;
     
     
-    // Output directory setup
-    std::string outDir = "output";
-    mkdir(outDir.c_str(), S_IRWXU);
     auto fout = std::make_unique<TFile>((outDir + "/" + outName).c_str(), "RECREATE");
 
     std::cout << "\n--------------------------------------" << std::endl;
@@ -119,7 +353,7 @@ int main(int argc, char* argv[]) {
     std::cout << "--------------------------------------" << std::endl;
     
     auto runCh = std::make_unique<RunChannel>(globalFlag);
-    runCh->Run(skimT, metadataJsonPath, fout.get());
+    runCh->Run(skimT, registry, fout.get());
   return 0;
 }
 
@@ -0,0 +1,59 @@
+#!/bin/bash
+# A job must not be lost with its worker: run a coordinator on a few jobs,
+# kill one worker (SIGKILL) and stop another (SIGSTOP) in the middle of a
+# job, finish with a third worker, and check that every job was written.
+#
+#   bash test/checkChunks.sh [SAMPLEKEY] [M] [runMain options...]
+# e.g. bash test/checkChunks.sh Data_ZeeJet_2024I_EGamma1v2 4 -k L2Relative
+set -e
+cd "$(dirname "$0")/.."
+key=${1:-Data_ZeeJet_2024I_EGamma1v2}
+nJobs=${2:-4}
+shift 2 || shift $# || true
+out=output/checkChunks
+sock=/tmp/checkChunks_$$.sock
+mkdir -p "$out"
+rm -f output/"${key}"_Hist_*of"${nJobs}".root*
+
+./runMain -o "$key" -n "$nJobs" -q "$sock" > "$out/coordinator.log" 2>&1 &
+coordinator=$!
+trap 'kill -9 $coordinator $killed $stopped $last 2> /dev/null || true' EXIT
+
+# Wait until the coordinator log has at least $2 lines matching $1
+waitFor() {
+    for _ in $(seq 600); do
+        [ "$(grep -c "$1" "$out/coordinator.log")" -ge "${2:-1}" ] && return 0
+        sleep 0.5
+    done
+    echo "Timed out waiting for '$1' in $out/coordinator.log"
+    exit 1
+}
+for _ in $(seq 100); do [ -S "$sock" ] && break; sleep 0.1; done
+
+./runMain -w "$sock" "$@" > "$out/killed.log" 2>&1 &
+killed=$!
+waitFor "to worker" 1
+sleep 2
+kill -9 "$killed"
+waitFor "lost with worker" 1
+
+./runMain -w "$sock" "$@" > "$out/stopped.log" 2>&1 &
+stopped=$!
+waitFor "to worker" 2
+sleep 2
+kill -STOP "$stopped"
+waitFor "silent for" 1
+
+./runMain -w "$sock" "$@" > "$out/last.log" 2>&1 &
+last=$!
+wait "$coordinator" || { tail -20 "$out/coordinator.log"; exit 1; }
+wait "$last"
+
+# The stopped worker only leaves its own temporary file
+kill -9 "$stopped"
+rm -f output/"${key}"_Hist_*of"${nJobs}".root.part"$stopped"
+for n in $(seq "$nJobs"); do
+    file=output/${key}_Hist_${n}of${nJobs}.root
+    [ -s "$file" ] || { echo "Missing $file"; exit 1; }
+done
+echo "All $nJobs jobs written"
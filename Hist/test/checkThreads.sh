@@ -0,0 +1,25 @@
+#!/bin/bash
+# The histograms must not depend on the number of threads: run the same job
+# with -j 1 and -j 8 (and with -a) and compare the outputs bit for bit.
+#
+#   bash test/checkThreads.sh [JOB] [runMain options...]
+# e.g. bash test/checkThreads.sh Data_ZeeJet_2024I_EGamma1v2_Hist_1of100.root -k L2Relative
+set -e
+cd "$(dirname "$0")/.."
+job=${1:-Data_ZeeJet_2024I_EGamma1v2_Hist_1of100.root}
+shift || true
+out=output/checkThreads
+mkdir -p "$out"
+
+run() {
+    local name=$1
+    shift
+    ./runMain -o "$job" "$@" > "$out/$name.log" 2>&1 || { tail -20 "$out/$name.log"; exit 1; }
+    mv "output/$job" "$out/$name.root"
+}
+
+run j1 -j 1 "$@"
+run j8 -j 8 "$@"
+run j3a -j 3 -a "$@"
+python3 test/sameOutputs.py "$out/j1.root" "$out/j8.root"
+python3 test/sameOutputs.py "$out/j1.root" "$out/j3a.root"
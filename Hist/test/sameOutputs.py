@@ -0,0 +1,86 @@
+# Exit with 0 if two output files of runMain have the same objects, bit for bit:
+# histograms (raw sums, sums of squares, entries, statistics), sketches (TVectorD)
+# and trees. The files themselves differ (creation time, compression).
+#
+#   python3 test/sameOutputs.py output/a.root output/b.root
+import ROOT
+import array
+import sys
+
+
+def hist_values(h):
+    values = [h.GetEntries()]
+    # TH1D and TProfile are TArrayD: the raw sums, not the means
+    values += [h.At(i) for i in range(h.GetNcells())]
+    sumw2 = h.GetSumw2()
+    values += [sumw2.At(i) for i in range(sumw2.GetSize())]
+    if h.InheritsFrom("TProfile"):
+        values += [h.GetBinEntries(i) for i in range(h.GetNcells())]
+        binSumw2 = h.GetBinSumw2()
+        values += [binSumw2.At(i) for i in range(binSumw2.GetSize())]
+    stats = array.array("d", [0.0] * 20)
+    h.GetStats(stats)
+    return values + list(stats)
+
+
+def tree_values(t):
+    values = []
+    leaves = [leaf.GetName() for leaf in t.GetListOfLeaves()]
+    for i in range(t.GetEntries()):
+        t.GetEntry(i)
+        for name in leaves:
+            leaf = t.GetLeaf(name)
+            if leaf.IsA().GetName() == "TLeafElement":
+                values.append(str(getattr(t, name)))
+            else:
+                values.append(leaf.GetValue())
+    return values
+
+
+def values(obj):
+    if obj.InheritsFrom("TH1"):
+        return hist_values(obj)
+    if obj.InheritsFrom("TVectorT<double>"):
+        return [obj[i] for i in range(obj.GetNrows())]
+    if obj.InheritsFrom("TTree"):
+        return tree_values(obj)
+    return None
+
+
+def compare(dir1, dir2, path, diffs):
+    names1 = sorted({k.GetName() for k in dir1.GetListOfKeys()})
+    names2 = sorted({k.GetName() for k in dir2.GetListOfKeys()})
+    for name in sorted(set(names1) ^ set(names2)):
+        diffs.append(path + name + ": only in one file")
+    for name in sorted(set(names1) & set(names2)):
+        obj1 = dir1.Get(name)
+        obj2 = dir2.Get(name)
+        if obj1.InheritsFrom("TDirectory"):
+            compare(obj1, obj2, path + name + "/", diffs)
+            continue
+        if obj1.ClassName() != obj2.ClassName():
+            diffs.append(path + name + ": " + obj1.ClassName() + " vs " + obj2.ClassName())
+            continue
+        v1 = values(obj1)
+        if v1 is None:
+            print("Not compared: " + path + name + " (" + obj1.ClassName() + ")")
+        elif v1 != values(obj2):
+            diffs.append(path + name + ": different content")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        print("Usage: python3 sameOutputs.py FILE1 FILE2")
+        sys.exit(2)
+    f1 = ROOT.TFile.Open(sys.argv[1])
+    f2 = ROOT.TFile.Open(sys.argv[2])
+    if not f1 or not f2:
+        sys.exit(2)
+    diffs = []
+    compare(f1, f2, "", diffs)
+    for d in diffs[:20]:
+        print(d)
+    if diffs:
+        print(str(len(diffs)) + " objects differ between " + sys.argv[1] + " and " + sys.argv[2])
+        sys.exit(1)
+    print("Same content: " + sys.argv[1] + " and " + sys.argv[2])
@@ -56,8 +56,41 @@ def compute_ratio_graph(pCorrOld, pCorrNew):
 
     return ratio_graph
 
-def plot_for_tag(root_file, tagName, statV1, statV2, output_file_path, HistGivenVar):
-    print(f"\nOld: {statV1}, New: {statV2}\n")
+def profile_to_graph(profile):
+    """TGraphErrors of the filled bins of a TProfile."""
+    x_vals, y_vals, x_errs, y_errs = [], [], [], []
+    for bin in range(1, profile.GetNbinsX() + 1):
+        if profile.GetBinEntries(bin) <= 0:
+            continue
+        x_vals.append(profile.GetBinCenter(bin))
+        x_errs.append(profile.GetBinWidth(bin) / 2.0)
+        y_vals.append(profile.GetBinContent(bin))
+        y_errs.append(profile.GetBinError(bin))
+
+    n_points = len(x_vals)
+    graph = ROOT.TGraphErrors(n_points, array.array('d', x_vals), array.array('d', y_vals),
+                              array.array('d', x_errs), array.array('d', y_errs))
+    return graph
+
+COLORS = [ROOT.kRed, ROOT.kBlue, ROOT.kGreen + 2, ROOT.kMagenta, ROOT.kOrange + 7, ROOT.kCyan + 2, ROOT.kBlack]
+
+def version_labels(entries):
+    """Labels of the versions of a metadata entry, as MetadataRegistry gives them to the histograms."""
+    labels = [e[2] if len(e) > 2 and isinstance(e[2], str) else "" for e in entries]
+    if len(labels) == 2 and not any(labels):
+        return ["Old", "New"]
+    return [label if label else f"V{i + 1}" for i, label in enumerate(labels)]
+
+def comparison_suffix(labels, v):
+    """Suffix of the comparison histograms of version v: none with two versions, its label otherwise."""
+    return "" if len(labels) == 2 else labels[v]
+
+def plot_for_tag(root_file, tagName, versions, reference, output_file_path, HistGivenVar):
+    # root_file: the file, or the top-level directory of the metadata in it
+    # versions: [(label, tag)], compared to versions[reference]
+    labels = [label for label, _ in versions]
+    refLabel = labels[reference]
+    print("\n" + ", ".join(f"{label}: {tag}" for label, tag in versions) + f" (reference {refLabel})\n")
     hist_var_dir = root_file.Get(HistGivenVar)
     if not hist_var_dir or not hist_var_dir.IsFolder():
         print(f"Error: {HistGivenVar} directory not found in the ROOT file.")
@@ -74,7 +107,7 @@ def plot_for_tag(root_file, tagName, statV1, statV2, output_file_path, HistGiven
     pad_height = 600
     canvas_width = rows * pad_width
     canvas_height = cols * pad_height
-    canvas = ROOT.TCanvas(f"canvas_pCorr_{tagName}_{HistGivenVar}", f"pCorrOld vs pCorrNew: {tagName}", canvas_width, canvas_height)
+    canvas = ROOT.TCanvas(f"canvas_pCorr_{tagName}_{HistGivenVar}", f"pCorr of {len(versions)} versions: {tagName}", canvas_width, canvas_height)
 
 
     canvas.Divide(rows, cols)
@@ -94,21 +127,14 @@ def plot_for_tag(root_file, tagName, statV1, statV2, output_file_path, HistGiven
             print(f"Warning: '{var_dir_name}' is not a directory. Skipping.")
             continue
 
-        pCorrOld = var_dir.Get(f"pCorrOld_{tagName}")
-        pCorrNew = var_dir.Get(f"pCorrNew_{tagName}")
-
-        if not pCorrOld:
-            print(f"Warning: 'pCorrOld' not found in '{var_dir_name}'. Skipping.")
-            continue
-        if not pCorrNew:
-            print(f"Warning: 'pCorrNew' not found in '{var_dir_name}'. Skipping.")
-            continue
-
-        if not pCorrOld.InheritsFrom("TProfile"):
-            print(f"Warning: 'pCorrOld' in '{var_dir_name}' is not a TProfile. Skipping.")
-            continue
-        if not pCorrNew.InheritsFrom("TProfile"):
-            print(f"Warning: 'pCorrNew' in '{var_dir_name}' is not a TProfile. Skipping.")
+        pCorrs = []
+        for label in labels:
+            pCorr = var_dir.Get(f"pCorr{label}_{tagName}")
+            if not pCorr or not pCorr.InheritsFrom("TProfile"):
+                print(f"Warning: 'pCorr{label}' not found in '{var_dir_name}' or not a TProfile. Skipping.")
+                break
+            pCorrs.append(pCorr)
+        if len(pCorrs) != len(labels):
             continue
 
         pad_number = i + 1
@@ -129,40 +155,19 @@ def plot_for_tag(root_file, tagName, statV1, statV2, output_file_path, HistGiven
         pad_overlay.Draw()
         pad_overlay.cd()
 
-        # Clone histograms
-        h1 = pCorrOld.Clone(f"h1_{i}")
-        h2 = pCorrNew.Clone(f"h2_{i}")
-
-        h1.SetTitle("")
-        h2.SetTitle("")
-        h1.GetYaxis().SetTitle("Mean of Correction")
-
-        h1.GetXaxis().SetTitle("Jet #eta")
-        h2.GetXaxis().SetTitle("Jet #eta")
-        h1.SetLineColor(ROOT.kRed)
-        h2.SetLineColor(ROOT.kBlue)
-        h1.SetLineWidth(2)
-        h2.SetLineWidth(2)
-        h1.GetYaxis().SetTitleOffset(1.5)
-        h2.GetYaxis().SetTitleOffset(1.5)
-
-        # Draw histograms
-        h1.Draw("EP")
-        h2.Draw("EP SAME")
-
-        # Store histograms
-        hist_list.extend([h1, h2])
-
-        # Add stats to the overlay as a title or via TLatex
-        mean1 = pCorrOld.GetMean()
-        error1 = pCorrOld.GetMeanError()
-        entries1 = pCorrOld.GetEntries()
-
-        mean2 = pCorrNew.GetMean()
-        error2 = pCorrNew.GetMeanError()
-        entries2 = pCorrNew.GetEntries()
-
-        # Add TLatex to show stats in the overlay pad
+        # Clone and draw the profiles of all versions
+        for v, pCorr in enumerate(pCorrs):
+            h = pCorr.Clone(f"h{v + 1}_{i}")
+            h.SetTitle("")
+            h.GetYaxis().SetTitle("Mean of Correction")
+            h.GetXaxis().SetTitle("Jet #eta")
+            h.SetLineColor(COLORS[v % len(COLORS)])
+            h.SetLineWidth(2)
+            h.GetYaxis().SetTitleOffset(1.5)
+            h.Draw("EP" if v == 0 else "EP SAME")
+            hist_list.append(h)
+
+        # Add TLatex to show the versions in the overlay pad
         latexTit = ROOT.TLatex()
         latexTit.SetNDC()
         latexTit.SetTextFont(43)
@@ -170,19 +175,13 @@ def plot_for_tag(root_file, tagName, statV1, statV2, output_file_path, HistGiven
         latexTit.SetTextColor(ROOT.kBlack)
         latexTit.DrawLatex(0.15, 0.95, var_dir_name)
 
-        latexV1 = ROOT.TLatex()
-        latexV1.SetNDC()
-        latexV1.SetTextFont(43)
-        latexV1.SetTextSize(16)
-        latexV1.SetTextColor(ROOT.kRed)
-        latexV1.DrawLatex(0.15, 0.90, statV1)
-
-        latexV2 = ROOT.TLatex()
-        latexV2.SetNDC()
-        latexV2.SetTextFont(43)
-        latexV2.SetTextSize(16)
-        latexV2.SetTextColor(ROOT.kBlue)
-        latexV2.DrawLatex(0.15, 0.85, statV2)
+        for v, (label, tag) in enumerate(versions):
+            latexV = ROOT.TLatex()
+            latexV.SetNDC()
+            latexV.SetTextFont(43)
+            latexV.SetTextSize(16)
+            latexV.SetTextColor(COLORS[v % len(COLORS)])
+            latexV.DrawLatex(0.15, 0.90 - 0.05 * v, tag if len(versions) == 2 else f"{label}: {tag}")
 
 
         # Create ratio pad
@@ -197,50 +196,71 @@ def plot_for_tag(root_file, tagName, statV1, statV2, output_file_path, HistGiven
         pad_ratio.Draw()
         pad_ratio.cd()
 
-        # Compute ratio graph
-        ratio_graph = compute_ratio_graph(pCorrOld, pCorrNew)
-        ROOT.SetOwnership(ratio_graph, False)
-        # force the ratio axis to match the overlay axis
-        xmin = pCorrOld.GetXaxis().GetXmin()
-        xmax = pCorrOld.GetXaxis().GetXmax()
-        ratio_graph.GetXaxis().SetLimits(xmin, xmax)        # for TGraphAsymmErrors
-        ratio_graph.GetXaxis().SetRangeUser(xmin, xmax)      # just in case
-        ratio_graph.SetTitle("")
-        ratio_graph.GetYaxis().SetTitle("pCorrOld / pCorrNew")
-        ratio_graph.GetYaxis().SetNdivisions(505)
-        ratio_graph.GetYaxis().SetTitleSize(0.12)
-        ratio_graph.GetYaxis().SetTitleFont(43)
-        ratio_graph.GetYaxis().SetTitleOffset(1.0)
-        ratio_graph.GetYaxis().SetLabelSize(0.1)
-        ratio_graph.GetXaxis().SetTitleSize(0.12)
-        ratio_graph.GetXaxis().SetTitleFont(43)
-        ratio_graph.GetXaxis().SetTitleOffset(1.0)
-        ratio_graph.GetXaxis().SetLabelSize(0.1)
-        ratio_graph.SetMarkerStyle(21)
-        ratio_graph.SetMarkerSize(0.8)
-        ratio_graph.SetLineColor(ROOT.kBlack)
-        ratio_graph.Draw("AP")
-        ratio_graphs.append(ratio_graph)
+        # One ratio graph per version compared to the reference
+        xmin = pCorrs[reference].GetXaxis().GetXmin()
+        xmax = pCorrs[reference].GetXaxis().GetXmax()
+        first_graph = None
+        for v, label in enumerate(labels):
+            if v == reference:
+                continue
+            # Per-jet ratio profile if the file has it, else the ratio of the profiles
+            pRatio = var_dir.Get(f"pRatio{comparison_suffix(labels, v)}_{tagName}")
+            if pRatio and pRatio.InheritsFrom("TProfile"):
+                ratio_graph = profile_to_graph(pRatio)
+                ratio_title = f"#LT {label}/{refLabel} #GT"
+            else:
+                ratio_graph = compute_ratio_graph(pCorrs[v], pCorrs[reference])
+                ratio_title = f"pCorr{label} / pCorr{refLabel}"
+            if len(labels) > 2:
+                ratio_title = f"Ratio to {refLabel}"
+            ROOT.SetOwnership(ratio_graph, False)
+            ratio_graph.SetMarkerStyle(21)
+            ratio_graph.SetMarkerSize(0.8)
+            ratio_graph.SetMarkerColor(COLORS[v % len(COLORS)] if len(labels) > 2 else ROOT.kBlack)
+            ratio_graph.SetLineColor(COLORS[v % len(COLORS)] if len(labels) > 2 else ROOT.kBlack)
+            ratio_graphs.append(ratio_graph)
+            if first_graph:
+                ratio_graph.Draw("P SAME")
+                continue
+
+            first_graph = ratio_graph
+            # force the ratio axis to match the overlay axis
+            ratio_graph.GetXaxis().SetLimits(xmin, xmax)        # for TGraphAsymmErrors
+            ratio_graph.GetXaxis().SetRangeUser(xmin, xmax)      # just in case
+            ratio_graph.SetTitle("")
+            ratio_graph.GetYaxis().SetTitle(ratio_title)
+            ratio_graph.GetYaxis().SetNdivisions(505)
+            ratio_graph.GetYaxis().SetTitleSize(0.12)
+            ratio_graph.GetYaxis().SetTitleFont(43)
+            ratio_graph.GetYaxis().SetTitleOffset(1.0)
+            ratio_graph.GetYaxis().SetLabelSize(0.1)
+            ratio_graph.GetXaxis().SetTitleSize(0.12)
+            ratio_graph.GetXaxis().SetTitleFont(43)
+            ratio_graph.GetXaxis().SetTitleOffset(1.0)
+            ratio_graph.GetXaxis().SetLabelSize(0.1)
+            ratio_graph.Draw("AP")
 
         # Add horizontal line at y=1
-        line = ROOT.TLine(ratio_graph.GetXaxis().GetXmin(), 1, ratio_graph.GetXaxis().GetXmax(), 1)
-        line.SetLineColor(ROOT.kGray)
-        line.SetLineStyle(2)
-        line.Draw("same")
-        line_list.append(line)
+        if first_graph:
+            line = ROOT.TLine(first_graph.GetXaxis().GetXmin(), 1, first_graph.GetXaxis().GetXmax(), 1)
+            line.SetLineColor(ROOT.kGray)
+            line.SetLineStyle(2)
+            line.Draw("same")
+            line_list.append(line)
 
         canvas.cd()
     return canvas
 
 
 def main():
-    if len(sys.argv) != 4:
-        print("Usage: python plotGivenPt.py <input_root_file> <output_file> <metadata_json>")
+    if len(sys.argv) not in (4, 5):
+        print("Usage: python plotGivenPt.py <input_root_file> <output_file> <metadata_json> [reference_label]")
         sys.exit(1)
 
     input_root = sys.argv[1]
     output_file = sys.argv[2]
     metadata_file = sys.argv[3]
+    reference_label = sys.argv[4] if len(sys.argv) == 5 else None
 
     if not os.path.isfile(input_root):
         print(f"ERROR: {input_root} not found.")
@@ -262,15 +282,27 @@ def main():
         print(f"ERROR: failed to read metadata JSON: {e}")
         sys.exit(1)
 
+    # With several metadata files (runMain -m a.json,b.json) each has its own top-level directory
+    group = os.path.splitext(os.path.basename(metadata_file))[0]
+    base_dir = root_file.Get(group)
+    if base_dir and base_dir.IsFolder():
+        print(f"Reading the histograms of {group}/")
+    else:
+        base_dir = root_file
+
     HistGivenVars = ["HistGivenPt", "HistGivenEta"]
     # build one canvas per tag
     canvases = []
     for HistGivenVar in HistGivenVars:
         for tag, entries in meta.items():
+            entries = [e for e in entries if len(e) >= 2 and isinstance(e[0], str) and isinstance(e[1], str)]
             if len(entries) < 2:
                 continue
-            statV1, statV2 = entries[0][1], entries[1][1]
-            c = plot_for_tag(root_file, tag, statV1, statV2, output_file, HistGivenVar)
+            labels = version_labels(entries)
+            # Same reference as runMain -R: the version with that label, else the first
+            reference = labels.index(reference_label) if reference_label in labels else 0
+            versions = [(label, e[1]) for label, e in zip(labels, entries)]
+            c = plot_for_tag(base_dir, tag, versions, reference, output_file, HistGivenVar)
             canvases.append(c)
 
     # now write them into a single multi‐page PDF